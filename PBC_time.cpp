@@ -1,408 +1,511 @@
-/*  USAGE: ./<object_name> <param_file> <mode> <n>
-    where, mode = 1 for printing the time in 'ms' mode = 0 for priting in no. of CPU-Cycles.
-    For eaxmple:   ./PBC_time a.param 1 1000
-    or, ./PBC_time a.param 0 1000
+/*  USAGE: ./<object_name> [-n <samples>] [-b <batch>] [-o <report file>] <param_file> [<param_file> ...]
+    Every operation is timed in batches of <batch> calls (auto-calibrated when omitted) and
+    <samples> batches are collected. Per-call cost is reported as min/median/p99 in both
+    nanoseconds (monotonic clock) and CPU cycles (time-stamp counter where available).
+    For example:   ./PBC_time a.param
+    or, ./PBC_time -n 200 a.param a1.param
+    Built with FP512=1, the fp512 backend is timed as well and ./PBC_time --check a.param
+    compares its G1 exponentiations and hashes with PBC's byte for byte instead of timing.
 */
 
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstring>
 #include <stdint.h> // for intptr_t
+#include <time.h>
 #include <pbc/pbc.h>
 #include <pbc/pbc_test.h>
+#include "file_utils.h"
+#ifdef AUDIT_FP512
+#include "fp512_utils.h"
+#endif
 
-#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 using namespace std;
 
-int main(int argc, char **argv) {
-	if(argc < 3){
-		cerr << "Error! Incorrect Usage: ./<object_name> <a.param> <mode>" << endl;
-		exit(1);
+// Target duration of one timed batch when the batch size is auto-calibrated
+#define TARGET_BATCH_NS 200000.0
+
+static inline uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Reference cycles from the time-stamp counter; falls back to ns elsewhere
+static inline uint64_t now_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_lfence();
+	uint64_t c = __rdtsc();
+	_mm_lfence();
+	return c;
+#else
+	return now_ns();
+#endif
+}
+
+struct Stats {
+	double min, median, p99;
+};
+
+struct Result {
+	string group;
+	string name;
+	size_t batch;
+	Stats ns;
+	Stats cycles;
+	string note;
+};
+
+static Stats summarize(vector<double> v) {
+	sort(v.begin(), v.end());
+	Stats s;
+	s.min = v.front();
+	s.median = v[v.size() / 2];
+	size_t rank = (size_t)(0.99 * v.size() + 0.999999);
+	s.p99 = v[min(max(rank, (size_t)1), v.size()) - 1];
+	return s;
+}
+
+// Times op() in batches; setup() runs untimed before every batch to refresh inputs
+static Result measure(const string &group, const string &name, size_t samples, size_t batch,
+                      const function<void()> &setup, const function<void()> &op) {
+	Result r;
+	r.group = group;
+	r.name = name;
+
+	setup();
+	op();  // warm-up
+	if (batch == 0) {
+		uint64_t t0 = now_ns();
+		op();
+		double once = (double)(now_ns() - t0);
+		batch = once > 0 ? (size_t)(TARGET_BATCH_NS / once) : 1000;
+		batch = max(min(batch, (size_t)100000), (size_t)1);
 	}
-	size_t mode;
-	mode = stoi(argv[2]);
-	
-	bool debug = false;
-	
+	r.batch = batch;
+
+	vector<double> ns, cycles;
+	for (size_t s = 0; s < samples; s++) {
+		setup();
+		uint64_t t0 = now_ns();
+		uint64_t c0 = now_cycles();
+		for (size_t i = 0; i < batch; i++) {
+			op();
+		}
+		uint64_t c1 = now_cycles();
+		uint64_t t1 = now_ns();
+		ns.push_back((double)(t1 - t0) / batch);
+		cycles.push_back((double)(c1 - c0) / batch);
+	}
+	r.ns = summarize(ns);
+	r.cycles = summarize(cycles);
+	return r;
+}
+
+#ifdef AUDIT_FP512
+// Enables the fp512 backend for param_file; false when the parameters are not type A
+static bool load_fp512(const char *param_file, pairing_t params) {
+	ifstream in(param_file);
+	string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	return fp512_init_param(text.data(), text.size(), params);
+}
+
+// Compares fp512 exponentiations, single and batched, with element_pow_mpz on random G1 points,
+// and the batched hash to G1 with element_from_hash
+// and exponents, including the edge exponents 0, 1, -1 and the group order; returns the mismatches
+static int check_fp512(char *param_file, int count) {
 	pairing_t params;
-	pbc_demo_pairing_init(params, argc, argv);
-	size_t n; 
-	if(debug) n = 1;
-	else n = stoi(argv[3]);; // accuracy vs. cost
-	
-	
-	clock_t startTime1, endTime1;
-    	double elapsed_time1;
-    	double avgTimeTaken1, totalTimeTaken1 = 0.0;
-    	
-    	clock_t startTime2, endTime2;
-    	double elapsed_time2;
-    	double avgTimeTaken2, totalTimeTaken2 = 0.0;
-    	
-    	clock_t startTime3, endTime3;
-    	double elapsed_time3;
-    	double avgTimeTaken3, totalTimeTaken3 = 0.0;
-
-	clock_t startTime4, endTime4, startTime5, endTime5, startTime6, endTime6, startTime7, endTime7, startTime8, endTime8, startTime9, endTime9, startTime10, endTime10, startTime11, endTime11;
-	double elapsed_time4, elapsed_time5, elapsed_time6, elapsed_time7, elapsed_time8, elapsed_time9, elapsed_time10, elapsed_time11;
-	double avgTimeTaken4, avgTimeTaken5, avgTimeTaken6, avgTimeTaken7, totalTimeTaken4 = 0.0, totalTimeTaken5 = 0.0, totalTimeTaken6 = 0.0, totalTimeTaken7 = 0.0;
-	double avgTimeTaken8, avgTimeTaken9, avgTimeTaken10, avgTimeTaken11, totalTimeTaken8 = 0.0, totalTimeTaken9 = 0.0, totalTimeTaken10 = 0.0, totalTimeTaken11 = 0.0;
-	
-	clock_t startTime12, endTime12, startTime13, endTime13, startTime14, endTime14, startTime15, endTime15, startTime16, endTime16, startTime17, endTime17, startTime18, endTime18;
-    	double elapsed_time12, elapsed_time13, elapsed_time14, elapsed_time15, elapsed_time16, elapsed_time17, elapsed_time18;
-    	double avgTimeTaken12, avgTimeTaken13, avgTimeTaken14, avgTimeTaken15, avgTimeTaken16, avgTimeTaken17, avgTimeTaken18;
-    	double totalTimeTaken12 = 0.0, totalTimeTaken13 = 0.0, totalTimeTaken14 = 0.0, totalTimeTaken15 = 0.0, totalTimeTaken16 = 0.0, totalTimeTaken17 = 0.0, totalTimeTaken18 = 0.0;
-    	
-    	
-	element_t P1, P2, P3, P4, P5, P6, X1, X2, X3, d1, d2, d3;
-  
+	char *arr[2] = {(char *)" ", param_file};
+	pbc_demo_pairing_init(params, 2, arr);
+	if (!load_fp512(param_file, params)) {
+		cout << param_file << ": not a type A parameter file, fp512 backend not used" << endl;
+		pairing_clear(params);
+		return 0;
+	}
+
+	vector<element_s> base(count), expect(count), single(count), batched(count);
+	vector<element_ptr> base_ptr(count), batched_ptr(count);
+	mpz_t *e = new mpz_t[count];
+	for (int i = 0; i < count; i++) {
+		element_init_G1(&base[i], params);
+		element_init_G1(&expect[i], params);
+		element_init_G1(&single[i], params);
+		element_init_G1(&batched[i], params);
+		base_ptr[i] = &base[i];
+		batched_ptr[i] = &batched[i];
+		mpz_init(e[i]);
+
+		element_random(&base[i]);
+		element_t d;
+		element_init_Zr(d, params);
+		element_random(d);
+		element_to_mpz(e[i], d);
+		element_clear(d);
+		switch (i) {
+		case 0: mpz_set_ui(e[i], 0); break;
+		case 1: mpz_set_ui(e[i], 1); break;
+		case 2: mpz_set_si(e[i], -1); break;
+		case 3: mpz_set(e[i], params->r); break;
+		case 4: mpz_neg(e[i], e[i]); break;
+		}
+		element_pow_mpz(&expect[i], &base[i], e[i]);
+		fp512_element_pow_mpz(&single[i], &base[i], e[i]);
+	}
+	fp512_element_pow_batch(batched_ptr.data(), base_ptr.data(), e, count);
+
+	int mismatches = 0;
+	for (int i = 0; i < count; i++) {
+		if (element_cmp(&expect[i], &single[i]) || element_cmp(&expect[i], &batched[i])) {
+			cout << param_file << ": fp512 mismatch for exponentiation " << i << endl;
+			mismatches++;
+		}
+		element_clear(&base[i]);
+		element_clear(&expect[i]);
+		element_clear(&single[i]);
+		element_clear(&batched[i]);
+		mpz_clear(e[i]);
+	}
+	delete[] e;
+	cout << param_file << ": " << count - mismatches << "/" << count << " fp512 exponentiations match PBC" << endl;
+
+	if (fp512_field.hash_ready) {
+		vector<string> text(count);
+		vector<char *> data(count);
+		vector<int> len(count);
+		vector<element_s> expect_hash(count), hashed(count);
+		vector<element_ptr> hashed_ptr(count);
+		for (int i = 0; i < count; i++) {
+			text[i] = "block" + to_string(i);
+			data[i] = &text[i][0];
+			len[i] = (int)text[i].size();
+			element_init_G1(&expect_hash[i], params);
+			element_init_G1(&hashed[i], params);
+			hashed_ptr[i] = &hashed[i];
+			element_from_hash(&expect_hash[i], data[i], len[i]);
+		}
+		fp512_element_from_hash_batch(hashed_ptr.data(), data.data(), len.data(), count);
+
+		int hash_mismatches = 0;
+		for (int i = 0; i < count; i++) {
+			if (element_cmp(&expect_hash[i], &hashed[i])) {
+				cout << param_file << ": fp512 mismatch for hash of " << text[i] << endl;
+				hash_mismatches++;
+			}
+			element_clear(&expect_hash[i]);
+			element_clear(&hashed[i]);
+		}
+		cout << param_file << ": " << count - hash_mismatches << "/" << count << " fp512 hashes to G1 match PBC" << endl;
+		mismatches += hash_mismatches;
+	}
+	else {
+		cout << param_file << ": fp512 hash to G1 disabled, element_from_hash used" << endl;
+	}
+	pairing_clear(params);
+	return mismatches;
+}
+#endif
+
+static vector<Result> run_param_file(char *param_file, size_t samples, size_t batch) {
+	pairing_t params;
+	char *arr[2] = {(char *)" ", param_file};
+	pbc_demo_pairing_init(params, 2, arr);
+
+	vector<Result> results;
+	bool symmetric = pairing_is_symmetric(params);
+
+	element_t P1, P2, P3, Q1, Q2, Q3, X1, X2, X3, d1, d2, d3, d4;
 	element_init_G1(P1, params);
 	element_init_G1(P2, params);
 	element_init_G1(P3, params);
-  
-	element_init_G2(P4, params);
-	element_init_G2(P5, params);
-	element_init_G2(P6, params);
-	
+	element_init_G2(Q1, params);
+	element_init_G2(Q2, params);
+	element_init_G2(Q3, params);
 	element_init_GT(X1, params);
 	element_init_GT(X2, params);
 	element_init_GT(X3, params);
-	
 	element_init_Zr(d1, params);
 	element_init_Zr(d2, params);
 	element_init_Zr(d3, params);
-	
-    	for(size_t i = 0; i < n; i++){
-    	        cout << endl << "Processing for : " << i << endl;
-    	
-    		element_random(P1);
+	element_init_Zr(d4, params);
+
+	auto randomize = [&]() {
+		element_random(P1);
 		element_random(P2);
+		element_random(Q1);
+		element_random(Q2);
+		element_random(X1);
+		element_random(X2);
 		element_random(d1);
 		element_random(d2);
-		element_random(P4);
-		element_random(P5);
-    		element_random(X1);
-		element_random(X2);
-		
-		/////////////////                      Calculations in G1        /////////////////////////////////////////
-		
-		
-    		startTime1 = clock();
-    		
-      		element_add(P3, P1, P2);
-      		
-    		endTime1 = clock();
-    		if(mode) elapsed_time1 = static_cast<double>(endTime1 - startTime1)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time1 = static_cast<double>(endTime1 - startTime1);
-    		totalTimeTaken1 = (totalTimeTaken1 + elapsed_time1);
-    		
-    		startTime2 = clock();
-    		
-      		element_sub(P3, P1, P2);
-      		
-    		endTime2 = clock();
-    		if(mode) elapsed_time2 = static_cast<double>(endTime2 - startTime2)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time2 = static_cast<double>(endTime2 - startTime2);
-    		totalTimeTaken2 = (totalTimeTaken2 + elapsed_time2);
-    		
-    		startTime3 = clock();
-    		
-      		element_mul_zn(P2, P1, d1);
-      		
-    		endTime3 = clock();
-    		if(mode) elapsed_time3 = static_cast<double>(endTime3 - startTime3)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time3 = static_cast<double>(endTime3 - startTime3);
-    		totalTimeTaken3 = (totalTimeTaken3 + elapsed_time3);
-    		
-    		startTime4 = clock();
-    		
-      		element_invert(P2, P1);
-      		
-    		endTime4 = clock();
-    		if(mode) elapsed_time4 = static_cast<double>(endTime4 - startTime4)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time4 = static_cast<double>(endTime4 - startTime4);
-    		totalTimeTaken4 = (totalTimeTaken4 + elapsed_time4);
-    		
-    		
-    		/////////////////                      Calculations in G2        /////////////////////////////////////////
-    		
-    		
-    		startTime5 = clock();
-    		
-      		element_add(P6, P4, P5);
-      		
-    		endTime5 = clock();
-    		if(mode) elapsed_time5 = static_cast<double>(endTime5 - startTime5)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time5 = static_cast<double>(endTime5 - startTime5);
-    		totalTimeTaken5 = (totalTimeTaken5 + elapsed_time5);
-    		
-    		startTime6 = clock();
-    		
-      		element_sub(P6, P4, P5);
-      		
-    		endTime6 = clock();
-    		if(mode) elapsed_time6 = static_cast<double>(endTime6 - startTime6)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time6 = static_cast<double>(endTime6 - startTime6);
-    		totalTimeTaken6 = (totalTimeTaken6 + elapsed_time6);
-    		
-    		startTime7 = clock();
-    		
-      		element_mul_zn(P5, P4, d1);
-      		
-    		endTime7 = clock();
-    		if(mode) elapsed_time7 = static_cast<double>(endTime7 - startTime7)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time7 = static_cast<double>(endTime7 - startTime7);
-    		totalTimeTaken7 = (totalTimeTaken7 + elapsed_time7);
-    		
-    		startTime8 = clock();
-    		
-      		element_invert(P5, P4);
-      		
-    		endTime8 = clock();
-    		if(mode) elapsed_time8 = static_cast<double>(endTime8 - startTime8)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time8 = static_cast<double>(endTime8 - startTime8);
-    		totalTimeTaken8 = (totalTimeTaken8 + elapsed_time8);
-    		
-    		/////////////////                      Calculations in GT        /////////////////////////////////////////
-    		
-    	
-    		startTime9 = clock();
-    		
-      		element_mul(X3, X1, X2);
-      		
-    		endTime9 = clock();
-    		if(mode) elapsed_time9 = static_cast<double>(endTime9 - startTime9)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time9 = static_cast<double>(endTime9 - startTime9);
-    		totalTimeTaken9 = (totalTimeTaken9 + elapsed_time9);
-    		
-    		startTime10 = clock();
-    		
-      		element_invert(X2, X1);
-      		
-    		endTime10 = clock();
-    		if(mode) elapsed_time10 = static_cast<double>(endTime10 - startTime10)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time10 = static_cast<double>(endTime10 - startTime10);
-    		totalTimeTaken10 = (totalTimeTaken10 + elapsed_time10);
-    		
-    		startTime11 = clock();
-    		
-      		element_pow_zn(X2, X1, d1);
-      		
-    		endTime11 = clock();
-    		if(mode) elapsed_time11 = static_cast<double>(endTime11 - startTime11)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time11 = static_cast<double>(endTime11 - startTime11);
-    		totalTimeTaken11 = (totalTimeTaken11 + elapsed_time11);
-    		
-    		/////////////////                      Calculations in Zr        /////////////////////////////////////////
-    		
-    		
-    		if(debug){
-    			element_set_si(d1, 5);
-    			element_set_si(d2, 2);
-    			element_printf("d1= %B\n", d1);
-    			element_printf("d2= %B\n", d2);
-    		}
-    		
-    		startTime12 = clock();
-    		
-      		element_add(d3, d1, d2);
-      		
-    		endTime12 = clock();
-    		if(mode) elapsed_time12 = static_cast<double>(endTime12 - startTime12)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time12 = static_cast<double>(endTime12 - startTime12);
-    		totalTimeTaken12 = (totalTimeTaken12 + elapsed_time12);
-    		if(debug) element_printf("Result of addition: %B\n", d3);
-    		
-    		startTime13 = clock();
-    		
-      		element_sub(d3, d1, d2);
-      		
-    		endTime13 = clock();
-    		if(mode) elapsed_time13 = static_cast<double>(endTime13 - startTime13)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time13 = static_cast<double>(endTime13 - startTime13);
-    		totalTimeTaken13 = (totalTimeTaken13 + elapsed_time13);
-    		if(debug) element_printf("Result of subtraction: %B\n", d3);
-    		
-    		
-    		startTime14 = clock();
-    		
-      		element_mul(d3, d1, d2);
-      		
-    		endTime14 = clock();
-    		if(mode) elapsed_time14 = static_cast<double>(endTime14 - startTime14)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time14 = static_cast<double>(endTime14 - startTime14);
-    		totalTimeTaken14 = (totalTimeTaken14 + elapsed_time14);
-    		if(debug) element_printf("Result of multiplication: %B\n", d3);
-    		
-    		startTime15 = clock();
-    		
-      		element_div(d3, d1, d2);
-      		
-    		endTime15 = clock();
-    		if(mode) elapsed_time15 = static_cast<double>(endTime15 - startTime15)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time15 = static_cast<double>(endTime15 - startTime15);
-    		totalTimeTaken15 = (totalTimeTaken15 + elapsed_time15);
-    		if(debug) element_printf("Result of division: %B\n", d3);
-    		
-    		startTime16 = clock();
-    		
-      		element_invert(d3, d2);
-      		
-    		endTime16 = clock();
-    		if(mode) elapsed_time16 = static_cast<double>(endTime16 - startTime16)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time16 = static_cast<double>(endTime16 - startTime16);
-    		totalTimeTaken16 = (totalTimeTaken16 + elapsed_time16);
-    		if(debug){
-    			element_printf("Result of d2-inverse: %B\n", d3);
-    			element_mul(d3, d1, d3);
-    			element_printf("Result of d1*d2inverse: %B\n", d3);
-    		}
-    		
-    		startTime17 = clock();
-    		
-      		element_pow_zn(d3, d1, d2); 
-      		
-    		endTime17 = clock();
-    		if(mode) elapsed_time17 = static_cast<double>(endTime17 - startTime17)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time17 = static_cast<double>(endTime17 - startTime17);
-    		totalTimeTaken17 = (totalTimeTaken17 + elapsed_time17);
-    		if(debug) element_printf("Result of exponentiation: %B\n", d3);
-    		
-    		
-    		/////////////////                      BILINEAR PAIRING OPERATION       /////////////////////////////////////////
-    		
-    		
-    		startTime18 = clock();
-    		
-      		element_pairing(X3, P1, P2);
-      		
-    		endTime18 = clock();
-    		if(mode) elapsed_time18 = static_cast<double>(endTime18 - startTime18)/CLOCKS_PER_SEC*1000;
-    		else elapsed_time18 = static_cast<double>(endTime18 - startTime18);
-    		totalTimeTaken18 = (totalTimeTaken18 + elapsed_time18);
-    	}
-    	
-    	 
-    	avgTimeTaken1 = (totalTimeTaken1 / n);
-    	avgTimeTaken2 = (totalTimeTaken2 / n);
-    	avgTimeTaken3 = (totalTimeTaken3 / n);
-    	avgTimeTaken4 = (totalTimeTaken4 / n);
-    	avgTimeTaken5 = (totalTimeTaken5 / n);
-    	avgTimeTaken6 = (totalTimeTaken6 / n);
-    	avgTimeTaken7 = (totalTimeTaken7 / n);
-    	avgTimeTaken8 = (totalTimeTaken8 / n);
-    	avgTimeTaken9 = (totalTimeTaken9 / n);
-    	avgTimeTaken10 = (totalTimeTaken10 / n);
-    	avgTimeTaken11 = (totalTimeTaken11 / n);
-    	avgTimeTaken12 = (totalTimeTaken12 / n);
-    	avgTimeTaken13 = (totalTimeTaken13 / n);
-    	avgTimeTaken14 = (totalTimeTaken14 / n);
-    	avgTimeTaken15 = (totalTimeTaken15 / n);
-    	avgTimeTaken16 = (totalTimeTaken16 / n);
-    	avgTimeTaken17 = (totalTimeTaken17 / n);
-    	avgTimeTaken18 = (totalTimeTaken18 / n);
-    	
-    	ofstream file("Time.txt");
-    	
-    	// Check if the file opened successfully
-        if (!file) {
-          cerr << "Error opening file!" << std::endl;
-          return 1;
-        }
-    	
-    	cout << endl << "CLOCKS_PER_SEC = " << CLOCKS_PER_SEC << endl;
-    	file << endl << "CLOCKS_PER_SEC = " << CLOCKS_PER_SEC << endl;
-    	
-    	cout << endl << "n = " << n << endl;
-    	file << endl << "n = " << n << endl;
-    	
-	if(mode){
-		cout << endl << "TIME REPORT IN G1 ............." << endl;
-		file << endl << "TIME REPORT IN G1 ............." << endl;
-		cout << endl << "Cost of Addition in G1 = " << avgTimeTaken1 << " ms" << endl;
-		file << endl << "Cost of Addition in G1 = " << avgTimeTaken1 << " ms" << endl;
-		cout << endl << "Cost of Subtraction in G1 = " << avgTimeTaken2 << " ms" << endl;
-		file << endl << "Cost of Subtraction in G1 = " << avgTimeTaken2 << " ms" << endl;
-		cout << endl << "Cost of scalar-Multiplication in G1 = " << avgTimeTaken3 << " ms" << endl;
-		file << endl << "Cost of scalar-Multiplication in G1 = " << avgTimeTaken3 << " ms" << endl;
-		cout << endl << "Cost of Point Negation in G1 = " << avgTimeTaken4 << " ms" << endl;
-		file << endl << "Cost of Point Negation in G1 = " << avgTimeTaken4 << " ms" << endl;
-		
-		cout << endl << "TIME REPORT IN G2 ............." << endl;
-		file << endl << "TIME REPORT IN G2 ............." << endl;
-		cout << endl << "Cost of Addition in G2 = " << avgTimeTaken5 << " ms" << endl;
-		file << endl << "Cost of Addition in G2 = " << avgTimeTaken5 << " ms" << endl;
-		cout << endl << "Cost of Subtraction in G2 = " << avgTimeTaken6 << " ms" << endl;
-		file << endl << "Cost of Subtraction in G2 = " << avgTimeTaken6 << " ms" << endl;
-		cout << endl << "Cost of scalar-Multiplication in G2 = " << avgTimeTaken7 << " ms" << endl;
-		file << endl << "Cost of scalar-Multiplication in G2 = " << avgTimeTaken7 << " ms" << endl;
-		cout << endl << "Cost of Point Negation in G2 = " << avgTimeTaken8 << " ms" << endl;
-		file << endl << "Cost of Point Negation in G2 = " << avgTimeTaken8 << " ms" << endl;
-		
-		cout << endl << "TIME REPORT IN GT ............." << endl;
-		file << endl << "TIME REPORT IN GT ............." << endl;
-		cout << endl << "Cost of Multiplication in GT = " << avgTimeTaken9 << " ms" << endl;
-		file << endl << "Cost of Multiplication in GT = " << avgTimeTaken9 << " ms" << endl;
-		cout << endl << "Cost of Inverse in GT = " << avgTimeTaken10 << " ms" << endl;
-		file << endl << "Cost of Inverse in GT = " << avgTimeTaken10 << " ms" << endl;
-		cout << endl << "Cost of Exponentiation in GT = " << avgTimeTaken11 << " ms" << endl;
-		file << endl << "Cost of Exponentiation in GT = " << avgTimeTaken11 << " ms" << endl;
-		
-		cout << endl << "TIME REPORT IN Zr ............." << endl;
-		file << endl << "TIME REPORT IN Zr ............." << endl;
-		cout << endl << "Cost of Addition in Zr = " << avgTimeTaken12 << " ms" << endl;
-		file << endl << "Cost of Addition in Zr = " << avgTimeTaken12 << " ms" << endl;
-		cout << endl << "Cost of Subtraction in Zr = " << avgTimeTaken13 << " ms" << endl;
-		file << endl << "Cost of Subtraction in Zr = " << avgTimeTaken13 << " ms" << endl;
-		cout << endl << "Cost of Multiplication in Zr = " << avgTimeTaken14 << " ms" << endl;
-		file << endl << "Cost of Multiplication in Zr = " << avgTimeTaken14 << " ms" << endl;
-		cout << endl << "Cost of Division in Zr = " << avgTimeTaken15 << " ms" << endl;
-		file << endl << "Cost of Division in Zr = " << avgTimeTaken15 << " ms" << endl;
-		cout << endl << "Cost of Multiplicative-Inverse in Zr = " << avgTimeTaken16 << " ms" << endl;
-		file << endl << "Cost of Multiplicative-Inverse in Zr = " << avgTimeTaken16 << " ms" << endl;
-		cout << endl << "Cost of Exponentiation in Zr = " << avgTimeTaken17 << " ms" << endl;
-		file << endl << "Cost of Exponentiation in Zr = " << avgTimeTaken17 << " ms" << endl;
-		
-		cout << endl << "BILINEAR PAIRING....." << endl;
-		file << endl << "BILINEAR PAIRING....." << endl;
-		cout << "Pairing Cost = " << avgTimeTaken18 << " ms"<< endl;
-		file << "Pairing Cost = " << avgTimeTaken18 << " ms"<< endl;
-		
+		element_random(d3);
+	};
+	randomize();
+
+	// Message shaped like the protocol's H2 input: file identifier || block index
+	char message[64];
+	snprintf(message, sizeof(message), "input.jpeg%d", 123456);
+	unsigned char block[1000];
+	for (size_t i = 0; i < sizeof(block); i++) block[i] = (unsigned char)(i * 131 + 7);
+
+	element_pp_t g1_pp, g2_pp;
+	element_pp_init(g1_pp, P1);
+	element_pp_init(g2_pp, Q1);
+	pairing_pp_t pair_pp;
+	pairing_pp_init(pair_pp, P1, params);
+
+	vector<unsigned char> buf(max({element_length_in_bytes(P1), element_length_in_bytes(Q1),
+	                               element_length_in_bytes(X1), element_length_in_bytes(d1)}));
+
+	auto add = [&](const string &group, const string &name, const function<void()> &op) {
+		results.push_back(measure(group, name, samples, batch, randomize, op));
+	};
+
+	/////////////////                      Calculations in G1        /////////////////////////////////////////
+
+	add("G1", "Addition", [&]() { element_add(P3, P1, P2); });
+	add("G1", "Subtraction", [&]() { element_sub(P3, P1, P2); });
+	add("G1", "Point Negation", [&]() { element_invert(P3, P1); });
+	add("G1", "scalar-Multiplication", [&]() { element_mul_zn(P3, P1, d1); });
+	add("G1", "fixed-base scalar-Multiplication", [&]() { element_pp_pow_zn(P3, d1, g1_pp); });
+	add("G1", "multi-exponentiation (2 terms)", [&]() { element_pow2_zn(P3, P1, d1, P2, d2); });
+	add("G1", "multi-exponentiation (3 terms)", [&]() { element_pow3_zn(P3, P1, d1, P2, d2, P1, d3); });
+	add("G1", "hash-to-G1", [&]() { element_from_hash(P3, message, strlen(message)); });
+	add("G1", "serialization", [&]() { element_to_bytes(buf.data(), P1); });
+	add("G1", "deserialization", [&]() { element_from_bytes(P3, buf.data()); });
+
+#ifdef AUDIT_FP512
+	if (load_fp512(param_file, params)) {
+		mpz_t e[FP512_LANES];
+		element_ptr outs[FP512_LANES], bases[FP512_LANES];
+		vector<element_s> lanes(FP512_LANES);
+		for (int i = 0; i < FP512_LANES; i++) {
+			mpz_init(e[i]);
+			element_init_G1(&lanes[i], params);
+			outs[i] = &lanes[i];
+			bases[i] = i % 2 ? P2 : P1;
+		}
+		auto exponents = [&]() {
+			randomize();
+			for (int i = 0; i < FP512_LANES; i++) element_to_mpz(e[i], i % 2 ? d2 : d1);
+		};
+		results.push_back(measure("G1", "scalar-Multiplication (fp512)", samples, batch, exponents,
+		                          [&]() { fp512_element_pow_mpz(P3, P1, e[0]); }));
+		results.push_back(measure("G1", "scalar-Multiplication (fp512, 8 per batch)", samples, batch, exponents,
+		                          [&]() { fp512_element_pow_batch(outs, bases, e, FP512_LANES); }));
+#ifdef FP512_IFMA
+		results.back().note = "AVX-512 IFMA, cost is per 8 exponentiations";
+#else
+		results.back().note = "scalar fallback, cost is per 8 exponentiations";
+#endif
+		for (int i = 0; i < FP512_LANES; i++) {
+			mpz_clear(e[i]);
+			element_clear(&lanes[i]);
+		}
+
+		if (fp512_field.hash_ready) {
+			const int hashes = 64;
+			vector<string> text(hashes);
+			vector<char *> data(hashes);
+			vector<int> len(hashes);
+			vector<element_s> points(hashes);
+			vector<element_ptr> points_ptr(hashes);
+			for (int i = 0; i < hashes; i++) {
+				text[i] = string(message) + to_string(i);
+				data[i] = &text[i][0];
+				len[i] = (int)text[i].size();
+				element_init_G1(&points[i], params);
+				points_ptr[i] = &points[i];
+			}
+			results.push_back(measure("G1", "hash-to-G1 (fp512, 64 per batch)", samples, batch, []() {},
+			                          [&]() { fp512_element_from_hash_batch(points_ptr.data(), data.data(), len.data(), hashes); }));
+			results.back().note = "cost is per 64 hashes";
+			for (int i = 0; i < hashes; i++) element_clear(&points[i]);
+		}
 	}
-	else{
-		cout << "TIME REPORT IN G1 ............." << endl;
-		cout << endl << "Cost of Addition in G1 = " << avgTimeTaken1 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Subtraction in G1 = " << avgTimeTaken2 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of scalar-Multiplication in G1 = " << avgTimeTaken3 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Point Negation in G1 = " << avgTimeTaken4 << " CPU-Cycles" << endl;
-		
-		cout << endl << "TIME REPORT IN G2 ............." << endl;
-		cout << endl << "Cost of Addition in G2 = " << avgTimeTaken5 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Subtraction in G2 = " << avgTimeTaken6 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of scalar-Multiplication in G2 = " << avgTimeTaken7 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Point Negation in G2 = " << avgTimeTaken8 << " CPU-Cycles" << endl;
-		
-		cout << endl << "TIME REPORT IN GT ............." << endl;
-		cout << endl << "Cost of Multiplication in GT = " << avgTimeTaken9 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Inverse in GT = " << avgTimeTaken10 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Exponentiation in GT = " << avgTimeTaken11 << " CPU-Cycles" << endl;
-		
-		cout << endl << "TIME REPORT IN Zr ............." << endl;
-		cout << endl << "Cost of Addition in Zr = " << avgTimeTaken12 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Subtraction in Zr = " << avgTimeTaken13 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Multiplication in Zr = " << avgTimeTaken14 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Division in Zr = " << avgTimeTaken15 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Multiplicative-Inverse in Zr = " << avgTimeTaken16 << " CPU-Cycles" << endl;
-		cout << endl << "Cost of Exponentiation in Zr = " << avgTimeTaken17 << " CPU-Cycles" << endl;
-		
-		cout << endl << "BILINEAR PAIRING....." << endl;
-		cout << "Pairing Cost = " << avgTimeTaken18 << " CPU-Cycles"<< endl;
-		
+#endif
+
+	/////////////////                      Calculations in G2        /////////////////////////////////////////
+
+	if (!symmetric) {
+		add("G2", "Addition", [&]() { element_add(Q3, Q1, Q2); });
+		add("G2", "Subtraction", [&]() { element_sub(Q3, Q1, Q2); });
+		add("G2", "Point Negation", [&]() { element_invert(Q3, Q1); });
+		add("G2", "scalar-Multiplication", [&]() { element_mul_zn(Q3, Q1, d1); });
+		add("G2", "fixed-base scalar-Multiplication", [&]() { element_pp_pow_zn(Q3, d1, g2_pp); });
+		add("G2", "serialization", [&]() { element_to_bytes(buf.data(), Q1); });
+		add("G2", "deserialization", [&]() { element_from_bytes(Q3, buf.data()); });
+	}
+
+	/////////////////                      Calculations in GT        /////////////////////////////////////////
+
+	add("GT", "Multiplication", [&]() { element_mul(X3, X1, X2); });
+	add("GT", "Inverse", [&]() { element_invert(X3, X1); });
+	add("GT", "Exponentiation", [&]() { element_pow_zn(X3, X1, d1); });
+	add("GT", "serialization", [&]() { element_to_bytes(buf.data(), X1); });
+	add("GT", "deserialization", [&]() { element_from_bytes(X3, buf.data()); });
+
+	/////////////////                      Calculations in Zr        /////////////////////////////////////////
+
+	add("Zr", "Addition", [&]() { element_add(d4, d1, d2); });
+	add("Zr", "Subtraction", [&]() { element_sub(d4, d1, d2); });
+	add("Zr", "Multiplication", [&]() { element_mul(d4, d1, d2); });
+	add("Zr", "Division", [&]() { element_div(d4, d1, d2); });
+	add("Zr", "Multiplicative-Inverse", [&]() { element_invert(d4, d2); });
+	add("Zr", "Exponentiation", [&]() { element_pow_zn(d4, d1, d2); });
+	add("Zr", "hash-to-Zr (1000-byte block)", [&]() { element_from_hash(d4, block, sizeof(block)); });
+	add("Zr", "serialization", [&]() { element_to_bytes(buf.data(), d1); });
+	add("Zr", "deserialization", [&]() { element_from_bytes(d4, buf.data()); });
+
+	/////////////////                      BILINEAR PAIRING OPERATION       /////////////////////////////////////////
+
+	add("Pairing", "Pairing", [&]() { element_pairing(X3, P1, Q1); });
+	add("Pairing", "preprocessed Pairing", [&]() { pairing_pp_apply(X3, Q1, pair_pp); });
+
+	/////////////////                      FILE SERIALIZATION OF G1 TAGS       /////////////////////////////////////////
+
+	const int N = 1024;
+	size_t len = element_length_in_bytes(P1);
+	FILE *tmp = tmpfile();
+	vector<element_s> tags(N);
+	for (int i = 0; i < N; i++) {
+		element_init_G1(&tags[i], params);
+		element_random(&tags[i]);
 	}
-	
+	ELEMBUF ebuf;
+	elembuf_init(&ebuf, len * N);
+
+	// save_element_to_file()/read_element_from_file() round trip, one call per element
+	auto per_element = [&]() {
+		rewind(tmp);
+		for (int i = 0; i < N; i++) save_element_to_file(&tags[i], tmp);
+		fflush(tmp);
+		rewind(tmp);
+		for (int i = 0; i < N; i++) read_element_from_file(&tags[i], tmp);
+	};
+	// Same round trip through one caller-owned buffer and one write/read per batch
+	auto batched = [&]() {
+		rewind(tmp);
+		for (int i = 0; i < N; i++) encode_element(&ebuf, &tags[i]);
+		flush_elements(&ebuf, tmp);
+		fflush(tmp);
+		rewind(tmp);
+		fill_elements(&ebuf, tmp, len, N);
+		for (int i = 0; i < N; i++) decode_element(&ebuf, &tags[i]);
+	};
+	auto count_calls = [&](const function<void()> &op) {
+		long long io = trace_counters[CNT_IO_CALLS], allocs = trace_counters[CNT_ALLOCS];
+		op();
+		ostringstream note;
+		note << "libc I/O calls = " << trace_counters[CNT_IO_CALLS] - io
+		     << ", allocations = " << trace_counters[CNT_ALLOCS] - allocs;
+		return note.str();
+	};
+	add("Serialization", "1024 G1 tags, per-element file round trip", per_element);
+	results.back().note = count_calls(per_element);
+	add("Serialization", "1024 G1 tags, batched file round trip", batched);
+	results.back().note = count_calls(batched);
+
+	elembuf_free(&ebuf);
+	for (int i = 0; i < N; i++) element_clear(&tags[i]);
+	fclose(tmp);
+
+	pairing_pp_clear(pair_pp);
+	element_pp_clear(g1_pp);
+	element_pp_clear(g2_pp);
+	element_clear(P1);
+	element_clear(P2);
+	element_clear(P3);
+	element_clear(Q1);
+	element_clear(Q2);
+	element_clear(Q3);
+	element_clear(X1);
+	element_clear(X2);
+	element_clear(X3);
+	element_clear(d1);
+	element_clear(d2);
+	element_clear(d3);
+	element_clear(d4);
+	pairing_clear(params);
+
+	return results;
+}
+
+static void report(ostream &out, const string &param_file, const vector<Result> &results, size_t samples) {
+	string group;
+	out << endl << "PARAM FILE = " << param_file << "    samples = " << samples << endl;
+	for (const Result &r : results) {
+		if (r.group != group) {
+			group = r.group;
+			out << endl << "TIME REPORT IN " << group << " ............." << endl;
+		}
+		ostringstream line;
+		line << fixed << setprecision(6)
+		     << "Cost of " << r.name << " in " << r.group << " = " << r.ns.median / 1e6 << " ms"
+		     << setprecision(0)
+		     << "  [ns min/median/p99 = " << r.ns.min << "/" << r.ns.median << "/" << r.ns.p99
+		     << ", cycles min/median/p99 = " << r.cycles.min << "/" << r.cycles.median << "/" << r.cycles.p99
+		     << ", batch = " << r.batch << "]";
+		if (!r.note.empty()) line << "  " << r.note;
+		out << endl << line.str() << endl;
+	}
+}
+
+int main(int argc, char **argv) {
+	size_t samples = 101;
+	size_t batch = 0;
+	string report_file = "Time.txt";
+	vector<char *> param_files;
+	bool check = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) samples = stoul(argv[++i]);
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) batch = stoul(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) report_file = argv[++i];
+		else if (strcmp(argv[i], "--check") == 0) check = true;
+		else param_files.push_back(argv[i]);
+	}
+	if (param_files.empty() || samples == 0) {
+		cerr << "Error! Incorrect Usage: ./<object_name> [-n <samples>] [-b <batch>] [-o <report file>] [--check] <param_file> [<param_file> ...]" << endl;
+		exit(1);
+	}
+
+	if (check) {
+#ifdef AUDIT_FP512
+		int mismatches = 0;
+		for (char *param_file : param_files) mismatches += check_fp512(param_file, (int)max(samples, (size_t)16));
+		return mismatches ? 1 : 0;
+#else
+		cerr << "Error! --check needs a build with FP512=1" << endl;
+		return 1;
+#endif
+	}
+
+	ofstream file(report_file);
+
+	// Check if the file opened successfully
+	if (!file) {
+		cerr << "Error opening file!" << std::endl;
+		return 1;
+	}
+
+	for (char *param_file : param_files) {
+		vector<Result> results = run_param_file(param_file, samples, batch);
+		report(cout, param_file, results, samples);
+		report(file, param_file, results, samples);
+	}
+
 	// Close the file
-        file.close();
-	
+	file.close();
+
 	return 0;
 }
@@ -0,0 +1,96 @@
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-thread arena for GMP limb storage. Every element init/clear in the protocol
+// loops allocates and frees small limb buffers; once arena_install() has routed GMP
+// through these functions, freed buffers are kept on the calling thread's
+// size-class free lists and handed back out without touching the heap.
+// Cached blocks are ordinary malloc blocks, so a stray free() on one is still safe.
+
+#define ARENA_CLASS_BYTES 16
+#define ARENA_NUM_CLASSES 64    // sizes up to 1 KB are cached
+#define ARENA_MAX_CACHED 512    // blocks kept per class and thread
+
+typedef struct ARENABLOCK {
+    struct ARENABLOCK *next;
+} ARENABLOCK;
+
+typedef struct {
+    ARENABLOCK *free_list[ARENA_NUM_CLASSES];
+    int cached[ARENA_NUM_CLASSES];
+} ARENA;
+
+static __thread ARENA thread_arena;
+
+static inline size_t arena_class(size_t size) {
+    return size ? (size + ARENA_CLASS_BYTES - 1) / ARENA_CLASS_BYTES : 1;
+}
+
+void *arena_alloc(size_t size) {
+    size_t c = arena_class(size);
+    void *ptr;
+
+    if (c < ARENA_NUM_CLASSES) {
+        ARENABLOCK *block = thread_arena.free_list[c];
+        if (block) {
+            thread_arena.free_list[c] = block->next;
+            thread_arena.cached[c]--;
+            return block;
+        }
+        ptr = malloc(c * ARENA_CLASS_BYTES);
+    }
+    else {
+        ptr = malloc(size);
+    }
+
+    if (!ptr) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+void arena_free(void *ptr, size_t size) {
+    size_t c = arena_class(size);
+
+    if (c < ARENA_NUM_CLASSES && thread_arena.cached[c] < ARENA_MAX_CACHED) {
+        ARENABLOCK *block = (ARENABLOCK *) ptr;
+        block->next = thread_arena.free_list[c];
+        thread_arena.free_list[c] = block;
+        thread_arena.cached[c]++;
+        return;
+    }
+    free(ptr);
+}
+
+void *arena_realloc(void *ptr, size_t old_size, size_t new_size) {
+    size_t c = arena_class(new_size);
+
+    if (c < ARENA_NUM_CLASSES && c == arena_class(old_size)) {
+        return ptr;
+    }
+
+    void *new_ptr = arena_alloc(new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    arena_free(ptr, old_size);
+    return new_ptr;
+}
+
+// Returns the calling thread's cached blocks to the heap; call before a worker thread exits
+void arena_release() {
+    for (int c = 0; c < ARENA_NUM_CLASSES; c++) {
+        while (thread_arena.free_list[c]) {
+            ARENABLOCK *block = thread_arena.free_list[c];
+            thread_arena.free_list[c] = block->next;
+            free(block);
+        }
+        thread_arena.cached[c] = 0;
+    }
+}
+
+// Must run before the first GMP allocation (i.e. before the pairing is initialized)
+void arena_install() {
+    mp_set_memory_functions(arena_alloc, arena_realloc, arena_free);
+}
@@ -0,0 +1,401 @@
+/*  End-to-end protocol benchmark.
+    Runs every phase of ./dataAudit as a child process over generated data files
+    and reports wall/CPU time per phase as a table, JSON and CSV.
+
+    USAGE: ./auditBench [options]
+        --bin <path>            dataAudit binary (default ./dataAudit)
+        --param <file>          pairing parameter file (default a.param)
+        --sizes <list>          data file sizes, e.g. 1M,64M,1G (default 1M)
+        --ratios <list>         challenge ratios, e.g. 0.01,0.04 (default 0.04)
+        --warmup <n>            discarded warm-up repetitions (default 1)
+        --reps <n>              measured repetitions (default 5)
+        --workdir <dir>         scratch directory (default bench_work)
+        --json <file>           write results as JSON
+        --csv <file>            write results as CSV
+        --baseline <file>       compare medians against a CSV written by --csv
+        --threshold <percent>   allowed slowdown against the baseline (default 10)
+        --startup <n>           also time n runs of each command on a one-block file, started
+                                from the text parameter file and from a contextGen context
+*/
+
+#include "bench_utils.h"
+#include <sys/stat.h>
+#include <limits.h>
+#include <math.h>
+
+#define MAX_SIZES 16
+#define MAX_RATIOS 16
+
+enum { PH_SETUP, PH_PARTIALKEYGEN, PH_FULLKEYGEN, PH_TAGGEN, PH_CHALGEN, PH_PROOFGEN, PH_VERIFYPROOF, NUM_PHASES };
+
+char *phase_names[NUM_PHASES] = {
+    "setup", "partialKeyGen", "fullKeyGen", "tagGen", "chalGen", "proofGen", "verifyProof"
+};
+
+typedef struct {
+    long long size;
+    double ratio;
+    int phase;
+    int n;
+    double wall[BENCH_MAX_SAMPLES];
+    double cpu[BENCH_MAX_SAMPLES];
+    BENCHSTATS wall_stats;
+    BENCHSTATS cpu_stats;
+} BENCHRESULT;
+
+enum { ST_TAGGEN, ST_CHALGEN, ST_PROOFGEN, ST_VERIFYPROOF, NUM_STARTUP };
+
+char *startup_names[NUM_STARTUP] = { "tagGen", "chalGen", "proofGen", "verifyProof" };
+
+// Median wall time of each command started from the text parameters [0] and from a context [1]
+typedef struct {
+    int n;
+    double wall[2][BENCH_MAX_SAMPLES];
+    BENCHSTATS stats[2];
+} STARTUPRESULT;
+
+STARTUPRESULT startup_results[NUM_STARTUP];
+int startup_reps = 0;
+
+char bin_path[PATH_MAX];
+char param_path[PATH_MAX];
+int verify_failures = 0;
+
+// Splits a comma separated list into at most max entries
+int split_list(char *str, char **items, int max) {
+    int n = 0;
+    for (char *tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ",")) {
+        items[n++] = tok;
+    }
+    return n;
+}
+
+void record(BENCHRESULT *res, BENCHSAMPLE *sample) {
+    if (res->n < BENCH_MAX_SAMPLES) {
+        res->wall[res->n] = sample->wall_ms;
+        res->cpu[res->n] = sample->cpu_ms;
+        res->n++;
+    }
+}
+
+// Runs one phase of dataAudit and records its sample into res (NULL during warm-up)
+void run_phase(BENCHRESULT *res, char **args) {
+    char *argv[16];
+    char out[4096];
+    int argc = 0;
+    BENCHSAMPLE sample;
+
+    argv[argc++] = bin_path;
+    for (int i = 0; args[i]; i++) {
+        argv[argc++] = args[i];
+    }
+    argv[argc] = NULL;
+
+    int status = run_measured(argv, &sample, out, sizeof(out));
+    if (status != 0) {
+        printf("Error: %s %s exited with status %d\n", argv[0], argv[1], status);
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(args[0], "verifyProof") == 0 && parse_verdict(out) != VERDICT_PASS) {
+        verify_failures++;
+    }
+    if (res) {
+        record(res, &sample);
+    }
+}
+
+// One pass of the whole protocol over data_file
+void run_protocol(BENCHRESULT *res, char *data_file, char *ratio) {
+    char *csp = "soumyadev@iiita.ac.in";
+    char *auditee = "junaid@iiita.ac.in";
+
+    run_phase(res ? &res[PH_SETUP] : NULL, (char *[]){"setup", param_path, NULL});
+    run_phase(res ? &res[PH_PARTIALKEYGEN] : NULL, (char *[]){"partialKeyGen", param_path, "MSK.bin", csp, NULL});
+    run_phase(res ? &res[PH_PARTIALKEYGEN] : NULL, (char *[]){"partialKeyGen", param_path, "MSK.bin", auditee, NULL});
+    run_phase(res ? &res[PH_FULLKEYGEN] : NULL, (char *[]){"fullKeyGen", param_path, "localParams.bin", "soumyadev_partial_private_key.bin", csp, NULL});
+    run_phase(res ? &res[PH_FULLKEYGEN] : NULL, (char *[]){"fullKeyGen", param_path, "localParams.bin", "junaid_partial_private_key.bin", auditee, NULL});
+    run_phase(res ? &res[PH_TAGGEN] : NULL, (char *[]){"tagGen", param_path, "soumyadev_full_private_key.bin", "junaid_public_key.bin", data_file, NULL});
+    run_phase(res ? &res[PH_CHALGEN] : NULL, (char *[]){"chalGen", param_path, ratio, NULL});
+    run_phase(res ? &res[PH_PROOFGEN] : NULL, (char *[]){"proofGen", param_path, "junaid_full_private_key.bin", "soumyadev_public_key.bin", data_file, "sigma.bin", "chal_file.txt", NULL});
+    run_phase(res ? &res[PH_VERIFYPROOF] : NULL, (char *[]){"verifyProof", param_path, "soumyadev_public_key.bin", "junaid_public_key.bin", "POP.bin", csp, "localParams.bin", "chal_file.txt", "file_info.txt", NULL});
+}
+
+// One command of the startup benchmark; param is either the text parameter file or the context
+void run_startup_command(int command, char *param, BENCHRESULT *res) {
+    char *csp = "soumyadev@iiita.ac.in";
+    char *data_file = "startup_input.bin";
+
+    switch (command) {
+        case ST_TAGGEN:
+            run_phase(res, (char *[]){"tagGen", param, "soumyadev_full_private_key.bin", "junaid_public_key.bin", data_file, NULL});
+            break;
+        case ST_CHALGEN:
+            run_phase(res, (char *[]){"chalGen", param, "1.0", NULL});
+            break;
+        case ST_PROOFGEN:
+            run_phase(res, (char *[]){"proofGen", param, "junaid_full_private_key.bin", "soumyadev_public_key.bin", data_file, "sigma.bin", "chal_file.txt", NULL});
+            break;
+        case ST_VERIFYPROOF:
+            run_phase(res, (char *[]){"verifyProof", param, "soumyadev_public_key.bin", "junaid_public_key.bin", "POP.bin", csp, "localParams.bin", "chal_file.txt", "file_info.txt", NULL});
+            break;
+    }
+}
+
+// Commands on a single block are dominated by process start-up, pairing initialization and key loading
+void run_startup_bench(int reps) {
+    static BENCHRESULT scratch;
+
+    generate_data_file("startup_input.bin", 1000, 1);
+    run_phase(NULL, (char *[]){"contextGen", param_path, "audit.ctx", "localParams.bin", "soumyadev_public_key.bin",
+                               "junaid_public_key.bin", "soumyadev_full_private_key.bin", "junaid_full_private_key.bin", NULL});
+
+    for (int c = 0; c < NUM_STARTUP; c++) {
+        STARTUPRESULT *st = &startup_results[c];
+        for (int mode = 0; mode < 2; mode++) {
+            char *param = mode ? "audit.ctx" : param_path;
+            run_startup_command(c, param, NULL);
+            scratch.n = 0;
+            for (int i = 0; i < reps; i++) {
+                run_startup_command(c, param, &scratch);
+            }
+            memcpy(st->wall[mode], scratch.wall, scratch.n * sizeof(double));
+            st->n = scratch.n;
+            compute_stats(st->wall[mode], st->n, &st->stats[mode]);
+        }
+    }
+    remove("startup_input.bin");
+
+    printf("\n%-14s %14s %14s %10s\n", "command", "param ms", "context ms", "saved");
+    for (int c = 0; c < NUM_STARTUP; c++) {
+        BENCHSTATS *text = &startup_results[c].stats[0], *ctx = &startup_results[c].stats[1];
+        printf("%-14s %14.3f %14.3f %9.1f%%\n", startup_names[c], text->median, ctx->median,
+               text->median > 0 ? (text->median - ctx->median) / text->median * 100.0 : 0.0);
+    }
+}
+
+double throughput_mb_s(BENCHRESULT *res) {
+    return res->wall_stats.median > 0 ? (res->size / 1048576.0) / (res->wall_stats.median / 1000.0) : 0.0;
+}
+
+void write_csv(char *filename, BENCHRESULT *results, int count) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "size_bytes,ratio,phase,reps,wall_min_ms,wall_median_ms,wall_mean_ms,wall_p90_ms,wall_p99_ms,wall_max_ms,cpu_median_ms,throughput_mb_s\n");
+    for (int i = 0; i < count; i++) {
+        BENCHRESULT *r = &results[i];
+        fprintf(file, "%lld,%f,%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                r->size, r->ratio, phase_names[r->phase], r->n,
+                r->wall_stats.min, r->wall_stats.median, r->wall_stats.mean,
+                r->wall_stats.p90, r->wall_stats.p99, r->wall_stats.max,
+                r->cpu_stats.median, throughput_mb_s(r));
+    }
+    fclose(file);
+}
+
+void write_stats_json(FILE *file, char *name, BENCHSTATS *s) {
+    fprintf(file, "\"%s\": {\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+            name, s->min, s->median, s->mean, s->p90, s->p99, s->max);
+}
+
+void write_json(char *filename, BENCHRESULT *results, int count, int warmup) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "{\n  \"param\": \"%s\",\n  \"warmup\": %d,\n  \"verify_failures\": %d,\n  \"results\": [\n",
+            param_path, warmup, verify_failures);
+    for (int i = 0; i < count; i++) {
+        BENCHRESULT *r = &results[i];
+        fprintf(file, "    {\"size_bytes\": %lld, \"ratio\": %f, \"phase\": \"%s\", \"reps\": %d, ",
+                r->size, r->ratio, phase_names[r->phase], r->n);
+        write_stats_json(file, "wall_ms", &r->wall_stats);
+        fprintf(file, ", ");
+        write_stats_json(file, "cpu_ms", &r->cpu_stats);
+        fprintf(file, ", \"throughput_mb_s\": %.3f}%s\n", throughput_mb_s(r), i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]");
+    if (startup_reps) {
+        fprintf(file, ",\n  \"startup\": [\n");
+        for (int c = 0; c < NUM_STARTUP; c++) {
+            fprintf(file, "    {\"command\": \"%s\", \"reps\": %d, ", startup_names[c], startup_results[c].n);
+            write_stats_json(file, "param_wall_ms", &startup_results[c].stats[0]);
+            fprintf(file, ", ");
+            write_stats_json(file, "context_wall_ms", &startup_results[c].stats[1]);
+            fprintf(file, "}%s\n", c + 1 < NUM_STARTUP ? "," : "");
+        }
+        fprintf(file, "  ]");
+    }
+    fprintf(file, "\n}\n");
+    fclose(file);
+}
+
+// Compares median wall times against a baseline CSV; returns the number of regressions
+int compare_baseline(char *filename, BENCHRESULT *results, int count, double threshold) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    char line[512];
+    int regressions = 0;
+
+    printf("\nBaseline comparison against %s (threshold %.1f%%)\n", filename, threshold);
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        long long size;
+        double ratio, wall_min, wall_median;
+        char phase[32];
+        int reps;
+
+        if (sscanf(line, "%lld,%lf,%31[^,],%d,%lf,%lf", &size, &ratio, phase, &reps, &wall_min, &wall_median) != 6) {
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            BENCHRESULT *r = &results[i];
+            if (r->size != size || fabs(r->ratio - ratio) > 1e-9 || strcmp(phase_names[r->phase], phase) != 0) {
+                continue;
+            }
+            double change = wall_median > 0 ? (r->wall_stats.median - wall_median) / wall_median * 100.0 : 0.0;
+            int regressed = change > threshold;
+            regressions += regressed;
+            printf("  %-14s size=%-12lld ratio=%-8.4f %10.3f -> %10.3f ms (%+6.1f%%)%s\n",
+                   phase, size, ratio, wall_median, r->wall_stats.median, change,
+                   regressed ? "  REGRESSION" : "");
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    char *bin = "./dataAudit", *param = "a.param", *workdir = "bench_work";
+    char *json_file = NULL, *csv_file = NULL, *baseline_file = NULL;
+    char sizes_arg[256] = "1M", ratios_arg[256] = "0.04";
+    int warmup = 1, reps = 5;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Error: Missing value for %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(argv[i], "--bin") == 0) bin = argv[++i];
+        else if (strcmp(argv[i], "--param") == 0) param = argv[++i];
+        else if (strcmp(argv[i], "--sizes") == 0) snprintf(sizes_arg, sizeof(sizes_arg), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--ratios") == 0) snprintf(ratios_arg, sizeof(ratios_arg), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reps") == 0) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--workdir") == 0) workdir = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0) json_file = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0) csv_file = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0) baseline_file = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--startup") == 0) startup_reps = atoi(argv[++i]);
+        else {
+            printf("Error: Unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (reps < 1 || reps > BENCH_MAX_SAMPLES / 2 || startup_reps < 0 || startup_reps > BENCH_MAX_SAMPLES) {
+        printf("Error: --reps must be between 1 and %d, --startup at most %d\n", BENCH_MAX_SAMPLES / 2, BENCH_MAX_SAMPLES);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!realpath(bin, bin_path) || !realpath(param, param_path)) {
+        printf("Error: Cannot resolve %s or %s\n", bin, param);
+        exit(EXIT_FAILURE);
+    }
+
+    // Output paths are relative to the invoking directory, not the workdir
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd");
+        exit(EXIT_FAILURE);
+    }
+    json_file = absolute_path(json_file, cwd);
+    csv_file = absolute_path(csv_file, cwd);
+    baseline_file = absolute_path(baseline_file, cwd);
+
+    char *size_items[MAX_SIZES], *ratio_items[MAX_RATIOS];
+    int num_sizes = split_list(sizes_arg, size_items, MAX_SIZES);
+    int num_ratios = split_list(ratios_arg, ratio_items, MAX_RATIOS);
+
+    mkdir(workdir, 0755);
+    if (chdir(workdir) != 0) {
+        printf("Error: Cannot enter work directory %s\n", workdir);
+        exit(EXIT_FAILURE);
+    }
+
+    int count = num_sizes * num_ratios * NUM_PHASES;
+    BENCHRESULT *results = calloc(count, sizeof(BENCHRESULT));
+    if (!results) {
+        perror("Failed to allocate memory for results");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int s = 0; s < num_sizes; s++) {
+        long long size = parse_size(size_items[s]);
+        char data_file[64];
+        snprintf(data_file, sizeof(data_file), "bench_input_%lld.bin", size);
+
+        printf("Generating %s (%lld bytes)...\n", data_file, size);
+        generate_data_file(data_file, size, (uint64_t)size);
+
+        for (int r = 0; r < num_ratios; r++) {
+            BENCHRESULT *res = &results[(s * num_ratios + r) * NUM_PHASES];
+            for (int p = 0; p < NUM_PHASES; p++) {
+                res[p].size = size;
+                res[p].ratio = atof(ratio_items[r]);
+                res[p].phase = p;
+            }
+
+            for (int i = 0; i < warmup; i++) {
+                run_protocol(NULL, data_file, ratio_items[r]);
+            }
+            for (int i = 0; i < reps; i++) {
+                printf("\rsize=%lld ratio=%s rep %d/%d", size, ratio_items[r], i + 1, reps);
+                fflush(stdout);
+                run_protocol(res, data_file, ratio_items[r]);
+            }
+            printf("\n");
+        }
+        remove(data_file);
+    }
+
+    printf("\n%-14s %12s %8s %10s %10s %10s %10s %10s %10s\n",
+           "phase", "size", "ratio", "min ms", "median ms", "p90 ms", "p99 ms", "cpu ms", "MB/s");
+    for (int i = 0; i < count; i++) {
+        BENCHRESULT *r = &results[i];
+        compute_stats(r->wall, r->n, &r->wall_stats);
+        compute_stats(r->cpu, r->n, &r->cpu_stats);
+        printf("%-14s %12lld %8.4f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+               phase_names[r->phase], r->size, r->ratio, r->wall_stats.min, r->wall_stats.median,
+               r->wall_stats.p90, r->wall_stats.p99, r->cpu_stats.median, throughput_mb_s(r));
+    }
+    if (startup_reps) {
+        run_startup_bench(startup_reps);
+    }
+    if (verify_failures) {
+        printf("\nWarning: %d verifyProof runs did not succeed\n", verify_failures);
+    }
+
+    if (json_file) write_json(json_file, results, count, warmup);
+    if (csv_file) write_csv(csv_file, results, count);
+
+    int regressions = 0;
+    if (baseline_file) {
+        regressions = compare_baseline(baseline_file, results, count, threshold);
+        printf("%d regression(s) found\n", regressions);
+    }
+
+    free(results);
+    return (regressions || verify_failures) ? 2 : 0;
+}
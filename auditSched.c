@@ -0,0 +1,494 @@
+/*  Audit scheduler.
+    Repeatedly picks the file that has waited longest for an audit, issues a challenge and runs
+    proofGen and verifyProof for it in a bounded pool of worker processes, while holding CPU
+    time and data read per hour under the configured budgets. Every outcome is appended to a
+    log, which is also read back on start so audits continue where the last run stopped.
+
+    USAGE: ./auditSched --manifest <file> [options]
+        --manifest <file>       "<input file> <metadata file> <file info file>" per line (see runTagGenFiles)
+        --bin <path>            dataAudit binary (default ./dataAudit)
+        --param <file>          pairing parameter file (default a.param)
+        --workers <n>           concurrent audits (default 4)
+        --ratio <r>             challenge ratio passed to chalGen (default 0.04)
+        --detect <p>,<rate>     challenge sized for detection probability p at corruption rate instead
+        --cpu-budget <s>        CPU seconds per hour for audits, 0 = unlimited (default 0)
+        --io-budget <size>      data read per hour, e.g. 10G, 0 = unlimited (default 0)
+        --interval <s>          minimum time between two audits of one file (default 0)
+        --passes <n>            audits per file in this run (default 1)
+        --duration <s>          stop starting audits after this long, 0 = no limit (default 0)
+        --log <file>            outcome log (default audit_log.txt)
+        --workdir <dir>         per-worker scratch directories (default sched_work)
+        --prover-key <file>     auditee full private key (default junaid_full_private_key.bin)
+        --csp-pub <file>        CSP public key (default soumyadev_public_key.bin)
+        --auditee-pub <file>    auditee public key (default junaid_public_key.bin)
+        --csp-id <id>           CSP identity (default soumyadev@iiita.ac.in)
+        --local-params <file>   local parameters (default localParams.bin)
+*/
+
+#include "bench_utils.h"
+#include <limits.h>
+
+typedef struct {
+    char *input;
+    char *sigma;
+    char *info;
+    double due_ms;      // monotonic time from which the file may be audited again
+    int audits;
+} SCHEDFILE;
+
+// Min-heap of file indices ordered by due time
+typedef struct {
+    int *items;
+    int size;
+} SCHEDQUEUE;
+
+// Token bucket refilled at per_hour / 3600 per second with one minute of burst.
+// Jobs are charged their measured cost on completion, so the balance may go negative.
+typedef struct {
+    double per_hour;
+    double tokens;
+    double capacity;
+    double last_ms;
+} BUDGET;
+
+typedef struct {
+    int file;
+    double start_ms;
+    double latency_ms;
+} SCHEDJOB;
+
+char bin_path[PATH_MAX];
+char *param_path, *prover_key, *csp_pub, *auditee_pub, *csp_id, *local_params;
+char chal_args[2][64];
+int chal_argc = 1;
+SCHEDFILE *files;
+int num_files = 0;
+
+void budget_init(BUDGET *b, double per_hour) {
+    b->per_hour = per_hour;
+    b->capacity = per_hour / 60.0;
+    b->tokens = b->capacity;
+    b->last_ms = now_ms();
+}
+
+int budget_available(BUDGET *b) {
+    if (b->per_hour <= 0) {
+        return 1;
+    }
+    double now = now_ms();
+    b->tokens += (now - b->last_ms) * b->per_hour / 3600000.0;
+    if (b->tokens > b->capacity) {
+        b->tokens = b->capacity;
+    }
+    b->last_ms = now;
+    return b->tokens > 0;
+}
+
+void budget_charge(BUDGET *b, double amount) {
+    b->tokens -= amount;
+}
+
+int queue_less(SCHEDQUEUE *q, int a, int b) {
+    return files[q->items[a]].due_ms < files[q->items[b]].due_ms;
+}
+
+void queue_swap(SCHEDQUEUE *q, int a, int b) {
+    int tmp = q->items[a];
+    q->items[a] = q->items[b];
+    q->items[b] = tmp;
+}
+
+void queue_push(SCHEDQUEUE *q, int file) {
+    int i = q->size++;
+    q->items[i] = file;
+    while (i > 0 && queue_less(q, i, (i - 1) / 2)) {
+        queue_swap(q, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+int queue_pop(SCHEDQUEUE *q) {
+    int top = q->items[0];
+    q->items[0] = q->items[--q->size];
+    int i = 0;
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < q->size && queue_less(q, l, m)) m = l;
+        if (r < q->size && queue_less(q, r, m)) m = r;
+        if (m == i) break;
+        queue_swap(q, i, m);
+        i = m;
+    }
+    return top;
+}
+
+void load_manifest(char *filename, char *cwd) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    int capacity = 1024;
+    char input[PATH_MAX], sigma[PATH_MAX], info[PATH_MAX];
+    files = malloc(capacity * sizeof(SCHEDFILE));
+    while (files && fscanf(file, "%4095s %4095s %4095s", input, sigma, info) == 3) {
+        if (num_files == capacity) {
+            capacity *= 2;
+            files = realloc(files, capacity * sizeof(SCHEDFILE));
+            if (!files) {
+                break;
+            }
+        }
+        SCHEDFILE *f = &files[num_files++];
+        f->input = absolute_path(strdup(input), cwd);
+        f->sigma = absolute_path(strdup(sigma), cwd);
+        f->info = absolute_path(strdup(info), cwd);
+        f->due_ms = 0;
+        f->audits = 0;
+    }
+    if (!files) {
+        perror("Failed to allocate memory for manifest");
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+}
+
+int compare_file_input(const void *a, const void *b) {
+    return strcmp(files[*(const int *)a].input, files[*(const int *)b].input);
+}
+
+// Files audited in an earlier run become due interval seconds after their last logged audit
+void load_log(char *filename, double interval_s) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return;
+    }
+
+    int *order = malloc(num_files * sizeof(int));
+    double *last = malloc(num_files * sizeof(double));
+    if (!order || !last) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_files; i++) {
+        order[i] = i;
+        last[i] = -1;
+    }
+    qsort(order, num_files, sizeof(int), compare_file_input);
+
+    char line[PATH_MAX + 256], path[PATH_MAX];
+    double when;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%lf %4095s", &when, path) != 2) {
+            continue;
+        }
+        int lo = 0, hi = num_files - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            int cmp = strcmp(path, files[order[mid]].input);
+            if (cmp == 0) {
+                if (when > last[order[mid]]) {
+                    last[order[mid]] = when;
+                }
+                break;
+            }
+            if (cmp < 0) hi = mid - 1;
+            else lo = mid + 1;
+        }
+    }
+    fclose(file);
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    double now_wall = wall.tv_sec + wall.tv_nsec / 1e9, now = now_ms();
+    for (int i = 0; i < num_files; i++) {
+        if (last[i] >= 0) {
+            files[i].due_ms = now + (last[i] + interval_s - now_wall) * 1000.0;
+        }
+    }
+    free(order);
+    free(last);
+}
+
+// Sums bytes_read over the counter records dataAudit appended to its trace file
+long long trace_bytes_read(char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    char line[4096];
+    long long total = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char *field = strstr(line, "\"bytes_read\":");
+        if (field && strstr(line, "\"type\":\"counters\"")) {
+            total += atoll(field + strlen("\"bytes_read\":"));
+        }
+    }
+    fclose(file);
+    return total;
+}
+
+int run_step(char **argv, char *out, size_t out_size) {
+    BENCHSAMPLE sample;
+    return run_measured(argv, &sample, out, out_size);
+}
+
+// Body of a worker process: one chalGen/proofGen/verifyProof round in its own directory.
+// The verdict is the exit status; the data read is left in bytes.txt.
+void audit_job(SCHEDFILE *f, char *workdir) {
+    if (chdir(workdir) != 0) {
+        _exit(VERDICT_ERROR);
+    }
+    setenv("AUDIT_TRACE", "trace.jsonl", 1);
+    remove("trace.jsonl");
+
+    char out[4096];
+    char *chalGen[] = { bin_path, "chalGen", param_path, chal_args[0], chal_args[1], NULL };
+    char *proofGen[] = { bin_path, "proofGen", param_path, prover_key, csp_pub, f->input, f->sigma, "chal_file.txt", NULL };
+    char *verifyProof[] = { bin_path, "verifyProof", param_path, csp_pub, auditee_pub, "POP.bin", csp_id,
+                            local_params, "chal_file.txt", f->info, NULL };
+    if (chal_argc == 1) {
+        chalGen[4] = NULL;
+    }
+
+    int verdict = VERDICT_ERROR;
+    if (run_step(chalGen, NULL, 0) == 0 && run_step(proofGen, NULL, 0) == 0 &&
+        run_step(verifyProof, out, sizeof(out)) == 0) {
+        verdict = parse_verdict(out);
+    }
+
+    FILE *bytes_file = fopen("bytes.txt", "w");
+    if (bytes_file) {
+        fprintf(bytes_file, "%lld\n", trace_bytes_read("trace.jsonl"));
+        fclose(bytes_file);
+    }
+    _exit(verdict);
+}
+
+long long read_job_bytes(char *workdir) {
+    char path[PATH_MAX + 16];
+    long long bytes = 0;
+    snprintf(path, sizeof(path), "%s/bytes.txt", workdir);
+    FILE *file = fopen(path, "r");
+    if (file) {
+        if (fscanf(file, "%lld", &bytes) != 1) {
+            bytes = 0;
+        }
+        fclose(file);
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv) {
+    char *bin = "./dataAudit", *param = "a.param", *manifest = NULL, *log_name = "audit_log.txt", *workdir = "sched_work";
+    char *ratio = "0.04", *detect = NULL;
+    int workers = 4, passes = 1;
+    double cpu_budget = 0, io_budget = 0, interval_s = 0, duration_s = 0;
+
+    prover_key = "junaid_full_private_key.bin";
+    csp_pub = "soumyadev_public_key.bin";
+    auditee_pub = "junaid_public_key.bin";
+    csp_id = "soumyadev@iiita.ac.in";
+    local_params = "localParams.bin";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Error: Missing value for %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(argv[i], "--manifest") == 0) manifest = argv[++i];
+        else if (strcmp(argv[i], "--bin") == 0) bin = argv[++i];
+        else if (strcmp(argv[i], "--param") == 0) param = argv[++i];
+        else if (strcmp(argv[i], "--workers") == 0) workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ratio") == 0) ratio = argv[++i];
+        else if (strcmp(argv[i], "--detect") == 0) detect = argv[++i];
+        else if (strcmp(argv[i], "--cpu-budget") == 0) cpu_budget = atof(argv[++i]);
+        else if (strcmp(argv[i], "--io-budget") == 0) io_budget = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--interval") == 0) interval_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--passes") == 0) passes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0) duration_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--log") == 0) log_name = argv[++i];
+        else if (strcmp(argv[i], "--workdir") == 0) workdir = argv[++i];
+        else if (strcmp(argv[i], "--prover-key") == 0) prover_key = argv[++i];
+        else if (strcmp(argv[i], "--csp-pub") == 0) csp_pub = argv[++i];
+        else if (strcmp(argv[i], "--auditee-pub") == 0) auditee_pub = argv[++i];
+        else if (strcmp(argv[i], "--csp-id") == 0) csp_id = argv[++i];
+        else if (strcmp(argv[i], "--local-params") == 0) local_params = argv[++i];
+        else {
+            printf("Error: Unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (manifest == NULL) {
+        printf("Error: --manifest is required\n");
+        exit(EXIT_FAILURE);
+    }
+    if (workers < 1 || workers > MAX_WORKERS || passes < 1) {
+        printf("Error: --workers must be between 1 and %d and --passes at least 1\n", MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+    if (detect) {
+        char *comma = strchr(detect, ',');
+        if (!comma) {
+            printf("Error: --detect expects <probability>,<corruption rate>\n");
+            exit(EXIT_FAILURE);
+        }
+        snprintf(chal_args[0], sizeof(chal_args[0]), "%.*s", (int)(comma - detect), detect);
+        snprintf(chal_args[1], sizeof(chal_args[1]), "%s", comma + 1);
+        chal_argc = 2;
+    }
+    else {
+        snprintf(chal_args[0], sizeof(chal_args[0]), "%s", ratio);
+    }
+
+    if (!realpath(bin, bin_path)) {
+        printf("Error: Cannot resolve %s\n", bin);
+        exit(EXIT_FAILURE);
+    }
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd");
+        exit(EXIT_FAILURE);
+    }
+    param_path = absolute_path(param, cwd);
+    prover_key = absolute_path(prover_key, cwd);
+    csp_pub = absolute_path(csp_pub, cwd);
+    auditee_pub = absolute_path(auditee_pub, cwd);
+    local_params = absolute_path(local_params, cwd);
+
+    load_manifest(manifest, cwd);
+    if (num_files == 0) {
+        printf("Error: Manifest %s lists no files\n", manifest);
+        exit(EXIT_FAILURE);
+    }
+    double start_ms = now_ms();
+    for (int i = 0; i < num_files; i++) {
+        files[i].due_ms = start_ms;
+    }
+    load_log(log_name, interval_s);
+
+    FILE *log_file = fopen(log_name, "a");
+    if (log_file == NULL) {
+        printf("Error opening file: %s\n", log_name);
+        exit(EXIT_FAILURE);
+    }
+
+    SCHEDQUEUE queue;
+    queue.items = malloc(num_files * sizeof(int));
+    queue.size = 0;
+    if (!queue.items) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_files; i++) {
+        queue_push(&queue, i);
+    }
+
+    WORKERPOOL pool;
+    SCHEDJOB jobs[MAX_WORKERS];
+    pool_init(&pool, absolute_path(workdir, cwd), workers);
+
+    BUDGET cpu, io;
+    budget_init(&cpu, cpu_budget * 1000.0);
+    budget_init(&io, io_budget);
+
+    int capacity = 1024, done = 0;
+    int counts[3] = {0, 0, 0};
+    double *latencies = malloc(capacity * sizeof(double));
+    double cpu_used_ms = 0;
+    long long bytes_used = 0;
+
+    while (pool.running > 0 || queue.size > 0) {
+        double now = now_ms();
+        int stopping = duration_s > 0 && now - start_ms >= duration_s * 1000.0;
+        if (stopping && pool.running == 0) {
+            break;
+        }
+
+        // Start as many due audits as there are idle workers and budget left
+        while (!stopping && pool.running < workers && queue.size > 0 && files[queue.items[0]].due_ms <= now &&
+               budget_available(&cpu) && budget_available(&io)) {
+            int f = queue_pop(&queue);
+            int w;
+            if (pool_fork(&pool, &w) == 0) {
+                fclose(log_file);
+                audit_job(&files[f], pool.dir[w]);
+            }
+            jobs[w].file = f;
+            jobs[w].start_ms = now;
+            jobs[w].latency_ms = now - files[f].due_ms;
+        }
+
+        if (pool.running == 0) {
+            // Nothing to reap: wait for the next due file or for the budgets to refill
+            usleep(10000);
+            continue;
+        }
+
+        int verdict;
+        struct rusage usage;
+        int w = pool_wait(&pool, &verdict, &usage);
+        if (w < 0) {
+            continue;
+        }
+        SCHEDJOB *job = &jobs[w];
+        SCHEDFILE *f = &files[job->file];
+        double end = now_ms();
+        double job_cpu_ms = timeval_ms(usage.ru_utime) + timeval_ms(usage.ru_stime);
+        long long job_bytes = read_job_bytes(pool.dir[w]);
+
+        budget_charge(&cpu, job_cpu_ms);
+        budget_charge(&io, job_bytes);
+        cpu_used_ms += job_cpu_ms;
+        bytes_used += job_bytes;
+        counts[verdict]++;
+        if (done == capacity) {
+            capacity *= 2;
+            latencies = realloc(latencies, capacity * sizeof(double));
+        }
+        if (!latencies) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        latencies[done++] = job->latency_ms;
+
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        fprintf(log_file, "%.3f %s %s %.3f %.3f %lld %.3f\n", wall.tv_sec + wall.tv_nsec / 1e9, f->input,
+                verdict_names[verdict], end - job->start_ms, job_cpu_ms, job_bytes, job->latency_ms);
+        fflush(log_file);
+
+        if (++f->audits < passes) {
+            f->due_ms = end + interval_s * 1000.0;
+            queue_push(&queue, job->file);
+        }
+    }
+    fclose(log_file);
+
+    double elapsed_s = (now_ms() - start_ms) / 1000.0;
+    BENCHSTATS latency;
+    compute_stats(latencies, done, &latency);
+
+    printf("\nAudits: %d (%d passed, %d failed, %d errors), %d still queued\n",
+           done, counts[VERDICT_PASS], counts[VERDICT_FAIL], counts[VERDICT_ERROR], queue.size);
+    printf("Elapsed %.1f s, audit rate %.2f/s (%.0f/hour) with %d workers\n",
+           elapsed_s, elapsed_s > 0 ? done / elapsed_s : 0, elapsed_s > 0 ? done / elapsed_s * 3600 : 0, workers);
+    printf("CPU %.1f s (%.1f s/hour%s), data read %lld bytes (%.0f bytes/hour%s)\n",
+           cpu_used_ms / 1000.0, elapsed_s > 0 ? cpu_used_ms / 1000.0 / elapsed_s * 3600 : 0,
+           cpu_budget > 0 ? " budgeted" : "", bytes_used,
+           elapsed_s > 0 ? bytes_used / elapsed_s * 3600 : 0, io_budget > 0 ? " budgeted" : "");
+    printf("Queue latency ms: median %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+           latency.median, latency.p90, latency.p99, latency.max);
+
+    FILE *stat_file = fopen("statistics.txt", "a");
+    if (stat_file) {
+        fprintf(stat_file, "Scheduler Audit Rate = %.2f audits/s, Queue Latency(median) = %.2f ms\n",
+                elapsed_s > 0 ? done / elapsed_s : 0, latency.median);
+        fclose(stat_file);
+    }
+
+    free(latencies);
+    free(queue.items);
+    return counts[VERDICT_FAIL] || counts[VERDICT_ERROR] ? 2 : 0;
+}
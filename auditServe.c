@@ -0,0 +1,240 @@
+/*  Stand-in blob store for the HTTP storage backend (storage_utils.h).
+    Serves the files under a directory over HTTP/1.1 with keep-alive, HEAD and single byte-range
+    GETs, the part of a blob store or web server that remote inputs and tag files rely on, so the
+    remote read path can be exercised without one. Each connection is served by its own process.
+    With --log every request is appended to a file as "<method> <path> <range> <status> <bytes>",
+    so a run can be checked for how much it fetched.
+
+    USAGE: ./auditServe [options]
+        --port <n>          port to listen on (default 8000)
+        --root <dir>        directory served (default .)
+        --log <file>        request log (default none)
+        --pidfile <file>    run in the background once listening, writing the server's pid here
+        --ignore-range      answer ranged GETs with the whole object, as a server without Range support
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define SERVE_BUF 65536
+
+char *root = ".";
+char *log_name = NULL;
+int ignore_range = 0;
+
+// Reads one CRLF-terminated header line from fd; returns 0 on EOF or an oversized line
+int read_line(int fd, char *line, size_t size) {
+    size_t n = 0;
+    char c;
+    while (read(fd, &c, 1) == 1) {
+        if (c == '\n') {
+            if (n > 0 && line[n - 1] == '\r') {
+                n--;
+            }
+            line[n] = '\0';
+            return 1;
+        }
+        if (n + 1 >= size) {
+            return 0;
+        }
+        line[n++] = c;
+    }
+    return 0;
+}
+
+int send_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t sent = send(fd, p, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return 0;
+        }
+        p += sent;
+        len -= sent;
+    }
+    return 1;
+}
+
+void log_request(const char *method, const char *path, const char *range, int status, long long bytes) {
+    if (log_name == NULL) {
+        return;
+    }
+    FILE *log = fopen(log_name, "a");
+    if (log) {
+        fprintf(log, "%s %s %s %d %lld\n", method, path, range[0] ? range : "-", status, bytes);
+        fclose(log);
+    }
+}
+
+// Answers one request; returns 0 when the connection should be closed
+int serve_request(int fd) {
+    char line[8192], method[16], target[4096], range[128] = "";
+    if (!read_line(fd, line, sizeof(line)) || sscanf(line, "%15s %4095s", method, target) != 2) {
+        return 0;
+    }
+    int keep_alive = 1;
+    while (read_line(fd, line, sizeof(line)) && line[0] != '\0') {
+        if (strncasecmp(line, "Range:", 6) == 0) {
+            snprintf(range, sizeof(range), "%s", line + 6 + strspn(line + 6, " "));
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+            keep_alive = 0;
+        }
+    }
+
+    int head = strcmp(method, "HEAD") == 0;
+    char path[PATH_MAX + 4096];
+    struct stat st;
+    int file = -1;
+    // Objects are files directly under the root, nothing above it
+    if (strstr(target, "..") == NULL && target[0] == '/') {
+        snprintf(path, sizeof(path), "%s%s", root, target);
+        file = open(path, O_RDONLY);
+    }
+    if ((!head && strcmp(method, "GET") != 0) || file < 0 || fstat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+        int status = file < 0 ? 404 : 405;
+        char reply[128];
+        int n = snprintf(reply, sizeof(reply), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", status,
+                         status == 404 ? "Not Found" : "Method Not Allowed");
+        if (file >= 0) {
+            close(file);
+        }
+        log_request(method, target, range, status, 0);
+        return send_all(fd, reply, n) && keep_alive;
+    }
+
+    long long size = st.st_size, first = 0, last = size - 1;
+    int status = 200;
+    if (!head && range[0] && !ignore_range) {
+        long long a, b;
+        if (sscanf(range, "bytes=%lld-%lld", &a, &b) == 2 && a >= 0 && b >= a) {
+            if (a >= size) {
+                status = 416;
+            }
+            else {
+                status = 206;
+                first = a;
+                last = b < size ? b : size - 1;
+            }
+        }
+    }
+
+    char header[512];
+    long long length = status == 416 ? 0 : last - first + 1;
+    int n;
+    if (status == 206) {
+        n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%lld\r\nContent-Length: %lld\r\n\r\n",
+                     first, last, size, length);
+    }
+    else if (status == 416) {
+        n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%lld\r\nContent-Length: 0\r\n\r\n", size);
+    }
+    else {
+        n = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Length: %lld\r\n\r\n", length);
+    }
+    int ok = send_all(fd, header, n);
+
+    long long sent = 0;
+    if (!head && status != 416 && ok) {
+        static char buf[SERVE_BUF];
+        while (sent < length) {
+            size_t want = length - sent < SERVE_BUF ? (size_t)(length - sent) : SERVE_BUF;
+            ssize_t got = pread(file, buf, want, first + sent);
+            if (got <= 0 || !send_all(fd, buf, got)) {
+                ok = 0;
+                break;
+            }
+            sent += got;
+        }
+    }
+    close(file);
+    log_request(method, target, range, status, sent);
+    return ok && keep_alive;
+}
+
+int main(int argc, char **argv) {
+    int port = 8000;
+    char *pidfile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ignore-range") == 0) {
+            ignore_range = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printf("Error: Missing value for %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(argv[i], "--port") == 0) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--root") == 0) root = argv[++i];
+        else if (strcmp(argv[i], "--log") == 0) log_name = argv[++i];
+        else if (strcmp(argv[i], "--pidfile") == 0) pidfile = argv[++i];
+        else {
+            printf("Error: Unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (server < 0 || bind(server, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(server, 64) != 0) {
+        perror("Error listening");
+        exit(EXIT_FAILURE);
+    }
+
+    // Detach only once the socket is listening, so whoever started the server can connect right away
+    if (pidfile) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid > 0) {
+            FILE *file = fopen(pidfile, "w");
+            if (file == NULL) {
+                printf("Error opening file: %s\n", pidfile);
+                kill(pid, SIGTERM);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(file, "%d\n", (int) pid);
+            fclose(file);
+            return 0;
+        }
+        setsid();
+    }
+
+    signal(SIGCHLD, SIG_IGN);
+    for (;;) {
+        int conn = accept(server, NULL, NULL);
+        if (conn < 0) {
+            continue;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(server);
+            while (serve_request(conn)) {
+            }
+            close(conn);
+            _exit(0);
+        }
+        close(conn);
+    }
+}
@@ -0,0 +1,694 @@
+/*  Synthetic workload generator and multi-tenant soak driver.
+    Generates a workload in the work directory: one CSP and many tenants (auditees), each with
+    its own key set, and data files of mixed sizes, random or sparse, tagged for their tenant.
+    Some files are then damaged in known ways (flipped bytes, a zeroed range, truncation) and the
+    ground truth is written to soak_truth.txt. A pool of worker processes then runs a sustained,
+    randomly weighted mix of tagGen and audit (chalGen, proofGen, verifyProof) operations across
+    the files. Every --report seconds, and again at the end, the driver reports throughput,
+    latency percentiles, the peak memory of the dataAudit processes, and how often audits of
+    damaged files fail. That detection rate is compared with the probability that the challenge
+    hits a damaged block.
+
+    USAGE: ./auditSoak [options]
+        --bin <path>            dataAudit binary (default ./dataAudit)
+        --param <file>          pairing parameter file (default a.param)
+        --tenants <n>           auditee identities, each with its own keys (default 4)
+        --files <n>             data files, assigned to tenants round-robin (default 16)
+        --sizes <list>          file sizes drawn from, e.g. 64K,1M,16M (default 64K,1M)
+        --sparse <fraction>     share of files written sparse, mostly holes (default 0.25)
+        --corrupt <fraction>    share of files damaged after tagging (default 0.25)
+        --patterns <list>       damage patterns taken in turn: flip, zero, truncate (default all three)
+        --damage <fraction>     share of the blocks of a damaged file that are hit (default 0.01)
+        --ratio <r>             challenge ratio passed to chalGen (default 0.04)
+        --mix <tag>:<audit>     relative weights of tagGen and audit operations (default 1:9)
+        --workers <n>           concurrent operations (default 4)
+        --duration <s>          stop starting operations after this long (default 60)
+        --ops <n>               or after this many operations, 0 = no limit (default 0)
+        --report <s>            reporting interval (default 10)
+        --seed <n>              workload and operation mix seed (default 1)
+        --workdir <dir>         workload and per-worker scratch directories (default soak_work)
+        --csv <file>            per-interval timeline as CSV
+*/
+
+#include "bench_utils.h"
+#include <limits.h>
+#include <math.h>
+
+#define SOAK_BLOCK_SIZE 1000        // BLOCK_SIZE of audit_utils.h
+#define SPARSE_EXTENT (64 * 1024)   // sparse files hold data in one extent out of SPARSE_EVERY
+#define SPARSE_EVERY 4
+#define MAX_SIZES 16
+
+enum { OP_TAGGEN, OP_CHALGEN, OP_PROOFGEN, OP_VERIFYPROOF, OP_AUDIT, NUM_OPS };
+
+char *op_names[NUM_OPS] = { "tagGen", "chalGen", "proofGen", "verifyProof", "audit" };
+
+enum { DAMAGE_NONE, DAMAGE_FLIP, DAMAGE_ZERO, DAMAGE_TRUNCATE, NUM_DAMAGE };
+
+char *damage_names[NUM_DAMAGE] = { "none", "flip", "zero", "truncate" };
+
+typedef struct {
+    char *path;             // absolute, and so also the identifier the tags are bound to
+    char *sigma;
+    char *info;
+    int tenant;
+    int sparse;
+    long long size;         // as tagged
+    long long blocks;
+    int damage;
+    long long damaged;      // blocks that no longer match their tags
+    double expected;        // probability that one audit challenges a damaged block
+} SOAKFILE;
+
+// Latency samples of one operation or step, over the run; interval_start marks the last report
+typedef struct {
+    double *wall;
+    int n;
+    int capacity;
+    int interval_start;
+    long peak_rss_kb;
+} OPSTATS;
+
+// Audit outcomes, split by whether the audited file was damaged
+typedef struct {
+    int damaged_audits;
+    int detected;
+    double expected;        // sum of the detection probabilities of the damaged audits
+    int intact_audits;
+    int false_alarms;
+    int errors;             // audits of intact files that could not run
+} DETECTION;
+
+typedef struct {
+    int file;
+    int kind;               // OP_TAGGEN or OP_AUDIT
+} SOAKJOB;
+
+char bin_path[PATH_MAX];
+char *param_path, *csp_full_key, *csp_pub, *local_params;
+char *csp_id = "csp@soak.test";
+char **tenant_pub, **tenant_key;
+char ratio_arg[64] = "0.04";
+SOAKFILE *files;
+int num_files = 16;
+uint64_t rng_state = 1;
+
+uint64_t soak_rand() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Uniform in [0, 1)
+double soak_uniform() {
+    return (soak_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Runs one step of the workload generation; any failure ends the run
+void run_or_die(char **args) {
+    char *argv[16];
+    int argc = 0;
+    BENCHSAMPLE sample;
+
+    argv[argc++] = bin_path;
+    for (int i = 0; args[i]; i++) {
+        argv[argc++] = args[i];
+    }
+    argv[argc] = NULL;
+    int status = run_measured(argv, &sample, NULL, 0);
+    if (status != 0) {
+        printf("Error: %s %s exited with status %d\n", argv[0], argv[1], status);
+        exit(EXIT_FAILURE);
+    }
+}
+
+char *key_file(char *id, char *suffix) {
+    char name[256];
+    snprintf(name, sizeof(name), "%.*s%s", (int)strcspn(id, "@"), id, suffix);
+    return strdup(name);
+}
+
+// Sparse file of size bytes: holes, with random data in one SPARSE_EXTENT out of SPARSE_EVERY
+void generate_sparse_file(char *filename, long long size) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    static uint64_t extent[SPARSE_EXTENT / sizeof(uint64_t)];
+    for (long long off = 0; off < size; off += SPARSE_EXTENT) {
+        if (soak_rand() % SPARSE_EVERY) {
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(extent) / sizeof(extent[0]); i++) {
+            extent[i] = soak_rand();
+        }
+        size_t take = size - off < SPARSE_EXTENT ? (size_t)(size - off) : SPARSE_EXTENT;
+        if (pwrite(fd, extent, take, off) != (ssize_t)take) {
+            perror("Error writing data file");
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+}
+
+// Damages count blocks of f with the given pattern; returns the blocks whose contents changed
+long long damage_file(SOAKFILE *f, int pattern, long long count) {
+    unsigned char block[SOAK_BLOCK_SIZE];
+    long long changed = 0;
+    int fd = open(f->path, O_RDWR);
+    if (fd < 0) {
+        printf("Error opening file: %s\n", f->path);
+        exit(EXIT_FAILURE);
+    }
+
+    if (pattern == DAMAGE_FLIP) {
+        // One byte in each of count distinct blocks, always to a different value
+        char *hit = calloc(f->blocks, 1);
+        while (changed < count) {
+            long long b = soak_rand() % f->blocks;
+            if (hit[b]) {
+                continue;
+            }
+            hit[b] = 1;
+            long long len = f->size - b * SOAK_BLOCK_SIZE < SOAK_BLOCK_SIZE ? f->size - b * SOAK_BLOCK_SIZE : SOAK_BLOCK_SIZE;
+            off_t pos = b * SOAK_BLOCK_SIZE + soak_rand() % len;
+            unsigned char byte;
+            if (pread(fd, &byte, 1, pos) != 1) {
+                break;
+            }
+            byte ^= 1 + soak_rand() % 255;
+            if (pwrite(fd, &byte, 1, pos) != 1) {
+                break;
+            }
+            changed++;
+        }
+        free(hit);
+    }
+    else if (pattern == DAMAGE_ZERO) {
+        // count consecutive blocks; those already zero (holes of a sparse file) are not damaged
+        long long first = soak_rand() % (f->blocks - count + 1);
+        for (long long b = first; b < first + count; b++) {
+            ssize_t got = pread(fd, block, SOAK_BLOCK_SIZE, b * SOAK_BLOCK_SIZE);
+            int nonzero = 0;
+            for (ssize_t i = 0; i < got && !nonzero; i++) {
+                nonzero = block[i] != 0;
+            }
+            if (nonzero) {
+                memset(block, 0, got);
+                if (pwrite(fd, block, got, b * SOAK_BLOCK_SIZE) != got) {
+                    break;
+                }
+                changed++;
+            }
+        }
+    }
+    else if (pattern == DAMAGE_TRUNCATE) {
+        // The last count blocks are lost; a one-block file loses its second half
+        off_t cut = f->blocks > count ? (f->blocks - count) * SOAK_BLOCK_SIZE : f->size / 2;
+        if (ftruncate(fd, cut) == 0) {
+            changed = f->blocks - cut / SOAK_BLOCK_SIZE;
+        }
+    }
+    close(fd);
+    return changed;
+}
+
+// Probability that a challenge of k distinct blocks out of n hits one of c damaged blocks.
+// A truncated file also changes the block count the prover derives its challenge from, so
+// for truncation this is a lower bound.
+double detection_probability(long long n, long long k, long long c) {
+    if (c <= 0 || k <= 0) {
+        return 0.0;
+    }
+    if (k > n - c) {
+        return 1.0;
+    }
+    double miss = 1.0;
+    for (long long j = 0; j < k; j++) {
+        miss *= (double)(n - c - j) / (double)(n - j);
+    }
+    return 1.0 - miss;
+}
+
+// Keys for the CSP and every tenant, then the data files, tagged by the CSP for their tenant
+void generate_workload(int tenants, long long *sizes, int num_sizes, double sparse, double corrupt, int *patterns,
+                       int num_patterns, double damage, char *cwd) {
+    printf("Generating %d tenants and %d files...\n", tenants, num_files);
+    run_or_die((char *[]){"setup", param_path, NULL});
+    run_or_die((char *[]){"partialKeyGen", param_path, "MSK.bin", csp_id, NULL});
+    char *csp_partial = key_file(csp_id, "_partial_private_key.bin");
+    run_or_die((char *[]){"fullKeyGen", param_path, "localParams.bin", csp_partial, csp_id, NULL});
+    csp_full_key = absolute_path(key_file(csp_id, "_full_private_key.bin"), cwd);
+    csp_pub = absolute_path(key_file(csp_id, "_public_key.bin"), cwd);
+    local_params = absolute_path("localParams.bin", cwd);
+
+    tenant_pub = malloc(tenants * sizeof(char *));
+    tenant_key = malloc(tenants * sizeof(char *));
+    if (!tenant_pub || !tenant_key) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < tenants; t++) {
+        char id[64];
+        snprintf(id, sizeof(id), "tenant%d@soak.test", t);
+        run_or_die((char *[]){"partialKeyGen", param_path, "MSK.bin", id, NULL});
+        char *partial = key_file(id, "_partial_private_key.bin");
+        run_or_die((char *[]){"fullKeyGen", param_path, "localParams.bin", partial, id, NULL});
+        tenant_pub[t] = absolute_path(key_file(id, "_public_key.bin"), cwd);
+        tenant_key[t] = absolute_path(key_file(id, "_full_private_key.bin"), cwd);
+    }
+
+    files = calloc(num_files, sizeof(SOAKFILE));
+    if (!files) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_files; i++) {
+        SOAKFILE *f = &files[i];
+        char name[64];
+        f->tenant = i % tenants;
+        f->size = sizes[soak_rand() % num_sizes];
+        f->blocks = (f->size + SOAK_BLOCK_SIZE - 1) / SOAK_BLOCK_SIZE;
+        f->sparse = soak_uniform() < sparse;
+        snprintf(name, sizeof(name), "data_%d.bin", i);
+        f->path = absolute_path(strdup(name), cwd);
+        snprintf(name, sizeof(name), "sigma_%d.bin", i);
+        f->sigma = absolute_path(strdup(name), cwd);
+        snprintf(name, sizeof(name), "info_%d.txt", i);
+        f->info = absolute_path(strdup(name), cwd);
+
+        if (f->sparse) {
+            generate_sparse_file(f->path, f->size);
+        }
+        else {
+            generate_data_file(f->path, f->size, soak_rand());
+        }
+        run_or_die((char *[]){"tagGen", param_path, csp_full_key, tenant_pub[f->tenant], f->path, f->sigma, f->info, NULL});
+        printf("\rTagged %d/%d", i + 1, num_files);
+        fflush(stdout);
+    }
+    printf("\n");
+
+    // Damage the first share of files in a shuffled order, taking the patterns in turn
+    int *order = malloc(num_files * sizeof(int));
+    for (int i = 0; i < num_files; i++) {
+        order[i] = i;
+    }
+    for (int i = num_files - 1; i > 0; i--) {
+        int j = soak_rand() % (i + 1), tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    int num_damaged = (int)(num_files * corrupt + 0.5);
+    for (int i = 0; i < num_damaged; i++) {
+        SOAKFILE *f = &files[order[i]];
+        long long count = (long long)(f->blocks * damage + 0.5);
+        count = count < 1 ? 1 : count > f->blocks ? f->blocks : count;
+        f->damage = patterns[i % num_patterns];
+        f->damaged = damage_file(f, f->damage, count);
+    }
+    free(order);
+
+    FILE *truth = fopen("soak_truth.txt", "w");
+    if (truth == NULL) {
+        printf("Error opening file: soak_truth.txt\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(truth, "# file tenant size blocks sparse damage damaged_blocks detection_probability\n");
+    for (int i = 0; i < num_files; i++) {
+        SOAKFILE *f = &files[i];
+        long long challenged = (long long)(f->blocks * atof(ratio_arg));   // as challenge_size() does for a ratio
+        f->expected = detection_probability(f->blocks, challenged, f->damaged);
+        fprintf(truth, "%s %d %lld %lld %d %s %lld %.6f\n", f->path, f->tenant, f->size, f->blocks, f->sparse,
+                damage_names[f->damage], f->damaged, f->expected);
+    }
+    fclose(truth);
+}
+
+void record_op(OPSTATS *op, double wall_ms, long rss_kb) {
+    if (op->n == op->capacity) {
+        op->capacity = op->capacity ? op->capacity * 2 : 1024;
+        op->wall = realloc(op->wall, op->capacity * sizeof(double));
+        if (!op->wall) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    op->wall[op->n++] = wall_ms;
+    if (rss_kb > op->peak_rss_kb) {
+        op->peak_rss_kb = rss_kb;
+    }
+}
+
+// Body of a worker process: one operation in its own directory. The verdict is the exit status;
+// every step run is left in op.txt as "<step> <wall ms> <peak RSS kB>".
+void soak_job(SOAKFILE *f, int kind, char *workdir) {
+    if (chdir(workdir) != 0) {
+        _exit(VERDICT_ERROR);
+    }
+    FILE *steps = fopen("op.txt", "w");
+    if (steps == NULL) {
+        _exit(VERDICT_ERROR);
+    }
+
+    char out[4096];
+    BENCHSAMPLE sample;
+    int verdict = VERDICT_ERROR;
+    if (kind == OP_TAGGEN) {
+        // Re-tagging into scratch files leaves the tags the audits rely on untouched
+        char *tagGen[] = { bin_path, "tagGen", param_path, csp_full_key, tenant_pub[f->tenant], f->path, "sigma.bin",
+                           "file_info.txt", NULL };
+        if (run_measured(tagGen, &sample, NULL, 0) == 0) {
+            fprintf(steps, "%d %.3f %ld\n", OP_TAGGEN, sample.wall_ms, sample.maxrss_kb);
+            verdict = VERDICT_PASS;
+        }
+    }
+    else {
+        char *chalGen[] = { bin_path, "chalGen", param_path, ratio_arg, NULL };
+        char *proofGen[] = { bin_path, "proofGen", param_path, tenant_key[f->tenant], csp_pub, f->path, f->sigma,
+                             "chal_file.txt", NULL };
+        char *verifyProof[] = { bin_path, "verifyProof", param_path, csp_pub, tenant_pub[f->tenant], "POP.bin", csp_id,
+                                local_params, "chal_file.txt", f->info, NULL };
+        char **step_argv[3] = { chalGen, proofGen, verifyProof };
+        int step_kind[3] = { OP_CHALGEN, OP_PROOFGEN, OP_VERIFYPROOF };
+        int s;
+        for (s = 0; s < 3; s++) {
+            if (run_measured(step_argv[s], &sample, out, sizeof(out)) != 0) {
+                break;
+            }
+            fprintf(steps, "%d %.3f %ld\n", step_kind[s], sample.wall_ms, sample.maxrss_kb);
+        }
+        if (s == 3) {
+            verdict = parse_verdict(out);
+        }
+    }
+    fclose(steps);
+    _exit(verdict);
+}
+
+// Adds the steps a finished worker left in op.txt
+void read_job_steps(char *workdir, OPSTATS *ops) {
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/op.txt", workdir);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    int kind;
+    double wall_ms;
+    long rss_kb;
+    while (fscanf(file, "%d %lf %ld", &kind, &wall_ms, &rss_kb) == 3) {
+        if (kind >= 0 && kind < NUM_OPS) {
+            record_op(&ops[kind], wall_ms, rss_kb);
+        }
+    }
+    fclose(file);
+}
+
+// A damaged file is detected when its audit does not pass, including when the proof cannot be made
+void count_audit(DETECTION *d, SOAKFILE *f, int verdict) {
+    if (f->damaged > 0) {
+        d->damaged_audits++;
+        d->detected += verdict != VERDICT_PASS;
+        d->expected += f->expected;
+    }
+    else {
+        d->intact_audits++;
+        d->false_alarms += verdict == VERDICT_FAIL;
+        d->errors += verdict == VERDICT_ERROR;
+    }
+}
+
+double percent(double part, double whole) {
+    return whole > 0 ? part / whole * 100.0 : 0.0;
+}
+
+// One line per interval on stdout and, with a CSV file, one row
+void report_interval(double elapsed_s, double interval_s, OPSTATS *ops, DETECTION *total, FILE *csv) {
+    BENCHSTATS stats[NUM_OPS];
+    long peak_rss_kb = 0;
+    for (int k = 0; k < NUM_OPS; k++) {
+        compute_stats(ops[k].wall + ops[k].interval_start, ops[k].n - ops[k].interval_start, &stats[k]);
+        if (ops[k].peak_rss_kb > peak_rss_kb) {
+            peak_rss_kb = ops[k].peak_rss_kb;
+        }
+    }
+    int done = stats[OP_TAGGEN].n + stats[OP_AUDIT].n;
+
+    printf("[%8.1f s] %5d ops %8.2f/s | audit p50 %9.3f p99 %9.3f ms | tagGen p50 %9.3f p99 %9.3f ms | "
+           "peak RSS %7.1f MB | detected %d/%d (%.1f%%, expected %.1f%%) | false alarms %d, errors %d\n",
+           elapsed_s, done, interval_s > 0 ? done / interval_s : 0.0, stats[OP_AUDIT].median, stats[OP_AUDIT].p99,
+           stats[OP_TAGGEN].median, stats[OP_TAGGEN].p99, peak_rss_kb / 1024.0, total->detected,
+           total->damaged_audits, percent(total->detected, total->damaged_audits),
+           percent(total->expected, total->damaged_audits), total->false_alarms, total->errors);
+    if (csv) {
+        fprintf(csv, "%.3f,%d,%.3f", elapsed_s, done, interval_s > 0 ? done / interval_s : 0.0);
+        for (int k = 0; k < NUM_OPS; k++) {
+            fprintf(csv, ",%d,%.3f,%.3f", stats[k].n, stats[k].median, stats[k].p99);
+        }
+        fprintf(csv, ",%ld,%d,%d,%.4f,%.4f,%d,%d,%d\n", peak_rss_kb, total->damaged_audits, total->detected,
+                percent(total->detected, total->damaged_audits) / 100.0,
+                percent(total->expected, total->damaged_audits) / 100.0, total->intact_audits, total->false_alarms,
+                total->errors);
+        fflush(csv);
+    }
+    for (int k = 0; k < NUM_OPS; k++) {
+        ops[k].interval_start = ops[k].n;
+    }
+}
+
+int main(int argc, char **argv) {
+    char *bin = "./dataAudit", *param = "a.param", *workdir = "soak_work", *csv_file = NULL;
+    char sizes_arg[256] = "64K,1M", patterns_arg[256] = "flip,zero,truncate";
+    int tenants = 4, workers = 4, tag_weight = 1, audit_weight = 9;
+    long long max_ops = 0;
+    double sparse = 0.25, corrupt = 0.25, damage = 0.01, duration_s = 60, report_s = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Error: Missing value for %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+        if (strcmp(argv[i], "--bin") == 0) bin = argv[++i];
+        else if (strcmp(argv[i], "--param") == 0) param = argv[++i];
+        else if (strcmp(argv[i], "--tenants") == 0) tenants = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--files") == 0) num_files = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sizes") == 0) snprintf(sizes_arg, sizeof(sizes_arg), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--sparse") == 0) sparse = atof(argv[++i]);
+        else if (strcmp(argv[i], "--corrupt") == 0) corrupt = atof(argv[++i]);
+        else if (strcmp(argv[i], "--patterns") == 0) snprintf(patterns_arg, sizeof(patterns_arg), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--damage") == 0) damage = atof(argv[++i]);
+        else if (strcmp(argv[i], "--ratio") == 0) snprintf(ratio_arg, sizeof(ratio_arg), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--mix") == 0) {
+            if (sscanf(argv[++i], "%d:%d", &tag_weight, &audit_weight) != 2) {
+                printf("Error: --mix expects <tag weight>:<audit weight>\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[i], "--workers") == 0) workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0) duration_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--ops") == 0) max_ops = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--report") == 0) report_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0) rng_state = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--workdir") == 0) workdir = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0) csv_file = argv[++i];
+        else {
+            printf("Error: Unknown option %s\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (tenants < 1 || num_files < 1 || workers < 1 || workers > MAX_WORKERS || tag_weight < 0 || audit_weight < 0 ||
+        tag_weight + audit_weight == 0 || report_s <= 0) {
+        printf("Error: --tenants and --files must be positive, --workers between 1 and %d, --mix not 0:0 and --report positive\n",
+               MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+    if (rng_state == 0) {
+        rng_state = 0x9E3779B97F4A7C15ULL;
+    }
+
+    long long sizes[MAX_SIZES];
+    int num_sizes = 0, patterns[NUM_DAMAGE], num_patterns = 0;
+    for (char *tok = strtok(sizes_arg, ","); tok && num_sizes < MAX_SIZES; tok = strtok(NULL, ",")) {
+        sizes[num_sizes] = parse_size(tok);
+        if (sizes[num_sizes++] < 1) {
+            printf("Error: File sizes must be positive\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (char *tok = strtok(patterns_arg, ","); tok && num_patterns < NUM_DAMAGE; tok = strtok(NULL, ",")) {
+        int p;
+        for (p = DAMAGE_FLIP; p < NUM_DAMAGE && strcmp(tok, damage_names[p]) != 0; p++);
+        if (p == NUM_DAMAGE) {
+            printf("Error: Unknown damage pattern %s (flip, zero or truncate)\n", tok);
+            exit(EXIT_FAILURE);
+        }
+        patterns[num_patterns++] = p;
+    }
+    if (num_sizes == 0 || num_patterns == 0) {
+        printf("Error: --sizes and --patterns need at least one entry\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!realpath(bin, bin_path)) {
+        printf("Error: Cannot resolve %s\n", bin);
+        exit(EXIT_FAILURE);
+    }
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd");
+        exit(EXIT_FAILURE);
+    }
+    param_path = absolute_path(param, cwd);
+    csv_file = absolute_path(csv_file, cwd);
+    char *base = absolute_path(workdir, cwd);
+    mkdir(base, 0755);
+    if (chdir(base) != 0) {
+        printf("Error: Cannot enter work directory %s\n", workdir);
+        exit(EXIT_FAILURE);
+    }
+
+    generate_workload(tenants, sizes, num_sizes, sparse, corrupt, patterns, num_patterns, damage, base);
+
+    FILE *csv = NULL;
+    if (csv_file) {
+        csv = fopen(csv_file, "w");
+        if (csv == NULL) {
+            printf("Error opening file: %s\n", csv_file);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(csv, "elapsed_s,ops,ops_per_s");
+        for (int k = 0; k < NUM_OPS; k++) {
+            fprintf(csv, ",%s_n,%s_p50_ms,%s_p99_ms", op_names[k], op_names[k], op_names[k]);
+        }
+        fprintf(csv, ",peak_rss_kb,damaged_audits,detected,detection_rate,expected_rate,intact_audits,false_alarms,errors\n");
+        fflush(csv);    // or the forked workers write the header again
+    }
+
+    WORKERPOOL pool;
+    SOAKJOB jobs[MAX_WORKERS];
+    pool_init(&pool, base, workers);
+
+    OPSTATS ops[NUM_OPS];
+    DETECTION total, by_damage[NUM_DAMAGE];
+    memset(ops, 0, sizeof(ops));
+    memset(&total, 0, sizeof(total));
+    memset(by_damage, 0, sizeof(by_damage));
+    int tag_errors = 0;
+    long long started = 0;
+
+    printf("Soaking with %d workers for %.0f s (mix %d:%d tagGen:audit)...\n", workers, duration_s, tag_weight, audit_weight);
+    double start_ms = now_ms(), last_report_ms = start_ms;
+    while (1) {
+        double now = now_ms();
+        int stopping = now - start_ms >= duration_s * 1000.0 || (max_ops > 0 && started >= max_ops);
+        if (stopping && pool.running == 0) {
+            break;
+        }
+
+        while (!stopping && pool.running < workers && (max_ops == 0 || started < max_ops)) {
+            int f = soak_rand() % num_files;
+            int kind = (int)(soak_rand() % (tag_weight + audit_weight)) < tag_weight ? OP_TAGGEN : OP_AUDIT;
+            int w;
+            if (pool_fork(&pool, &w) == 0) {
+                if (csv) {
+                    fclose(csv);
+                }
+                soak_job(&files[f], kind, pool.dir[w]);
+            }
+            jobs[w].file = f;
+            jobs[w].kind = kind;
+            started++;
+        }
+
+        int verdict;
+        struct rusage usage;
+        int w = pool_wait(&pool, &verdict, &usage);
+        if (w < 0) {
+            continue;
+        }
+        SOAKJOB *job = &jobs[w];
+
+        // An audit takes the sum of its steps, and its peak memory is that of the largest step
+        int before[NUM_OPS];
+        for (int k = 0; k < NUM_OPS; k++) {
+            before[k] = ops[k].n;
+        }
+        read_job_steps(pool.dir[w], ops);
+        if (job->kind == OP_AUDIT) {
+            double wall_ms = 0;
+            long rss_kb = 0;
+            for (int k = OP_CHALGEN; k <= OP_VERIFYPROOF; k++) {
+                if (ops[k].n > before[k]) {
+                    wall_ms += ops[k].wall[ops[k].n - 1];
+                }
+                rss_kb = ops[k].peak_rss_kb > rss_kb ? ops[k].peak_rss_kb : rss_kb;
+            }
+            record_op(&ops[OP_AUDIT], wall_ms, rss_kb);
+            count_audit(&total, &files[job->file], verdict);
+            count_audit(&by_damage[files[job->file].damage], &files[job->file], verdict);
+        }
+        else if (verdict != VERDICT_PASS) {
+            tag_errors++;
+        }
+
+        now = now_ms();
+        if (now - last_report_ms >= report_s * 1000.0) {
+            report_interval((now - start_ms) / 1000.0, (now - last_report_ms) / 1000.0, ops, &total, csv);
+            last_report_ms = now;
+        }
+    }
+    double elapsed_s = (now_ms() - start_ms) / 1000.0;
+    if (ops[OP_TAGGEN].n > ops[OP_TAGGEN].interval_start || ops[OP_AUDIT].n > ops[OP_AUDIT].interval_start) {
+        report_interval(elapsed_s, (now_ms() - last_report_ms) / 1000.0, ops, &total, csv);
+    }
+    if (csv) {
+        fclose(csv);
+    }
+
+    printf("\n%-14s %8s %10s %10s %10s %10s %10s %10s %12s\n",
+           "operation", "count", "per s", "min ms", "median ms", "p90 ms", "p99 ms", "max ms", "peak RSS MB");
+    BENCHSTATS audit_stats;
+    compute_stats(ops[OP_AUDIT].wall, ops[OP_AUDIT].n, &audit_stats);
+    for (int k = 0; k < NUM_OPS; k++) {
+        BENCHSTATS s;
+        compute_stats(ops[k].wall, ops[k].n, &s);
+        printf("%-14s %8d %10.2f %10.3f %10.3f %10.3f %10.3f %10.3f %12.1f\n", op_names[k], ops[k].n,
+               elapsed_s > 0 ? ops[k].n / elapsed_s : 0.0, s.min, s.median, s.p90, s.p99, s.max,
+               ops[k].peak_rss_kb / 1024.0);
+    }
+
+    printf("\n%-10s %8s %9s %10s %10s %8s %13s %7s\n", "damage", "audits", "detected", "rate", "expected",
+           "intact", "false alarms", "errors");
+    for (int d = 0; d < NUM_DAMAGE; d++) {
+        DETECTION *dd = &by_damage[d];
+        if (dd->damaged_audits + dd->intact_audits == 0) {
+            continue;
+        }
+        printf("%-10s %8d %9d %9.1f%% %9.1f%% %8d %13d %7d\n", damage_names[d], dd->damaged_audits, dd->detected,
+               percent(dd->detected, dd->damaged_audits), percent(dd->expected, dd->damaged_audits), dd->intact_audits,
+               dd->false_alarms, dd->errors);
+    }
+    if (tag_errors) {
+        printf("\nWarning: %d tagGen operations failed\n", tag_errors);
+    }
+    printf("Ground truth of the damaged files is in %s/soak_truth.txt\n", base);
+
+    if (chdir(cwd) == 0) {
+        FILE *stat_file = fopen("statistics.txt", "a");
+        if (stat_file) {
+            fprintf(stat_file, "Soak Operation Rate = %.2f ops/s, Audit Latency(p99) = %.2f ms, Detection Rate = %.1f%% (expected %.1f%%)\n",
+                    elapsed_s > 0 ? (ops[OP_TAGGEN].n + ops[OP_AUDIT].n) / elapsed_s : 0, audit_stats.p99,
+                    percent(total.detected, total.damaged_audits), percent(total.expected, total.damaged_audits));
+            fclose(stat_file);
+        }
+    }
+
+    for (int k = 0; k < NUM_OPS; k++) {
+        free(ops[k].wall);
+    }
+    // Audits of intact files must pass; a damaged file that passes is a miss the detection rate shows
+    return total.false_alarms || total.errors || tag_errors ? 2 : 0;
+}
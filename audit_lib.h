@@ -0,0 +1,575 @@
+#include <limits.h>
+#include "libaudit.h"
+
+// Protocol core shared by the dataAudit commands and the libaudit API. Everything here works on
+// elements and caller-supplied blocks; reading key files, writing outputs and reporting timings
+// stay with the commands.
+
+_Static_assert(AUDIT_BLOCK_SIZE == BLOCK_SIZE, "libaudit.h and audit_utils.h disagree on the block size");
+_Static_assert(AUDIT_SEED_SIZE == SEED_SIZE, "libaudit.h and audit_utils.h disagree on the seed size");
+
+// Blocks tagged per call of tag_blocks(); their H2 points are hashed in one batch
+#define TAG_BATCH H2_BATCH
+
+// Keys and scratch for tagging: the caller fills block[k] and len[k], and tag_blocks() leaves
+// the tag of block k in tag[k]
+typedef struct {
+    char *file_id;
+    element_ptr Dc;
+    element_ptr Pe;
+    element_ptr Bc;
+    unsigned char block[TAG_BATCH][BLOCK_SIZE];
+    size_t len[TAG_BATCH];
+    element_t h2[TAG_BATCH];
+    element_t bl[TAG_BATCH];
+    element_t pows[2 * TAG_BATCH];
+    element_ptr h2_ptr[TAG_BATCH];
+    element_ptr bases[2 * TAG_BATCH];
+    element_ptr exps[2 * TAG_BATCH];
+    element_ptr outs[2 * TAG_BATCH];
+    element_ptr tag[TAG_BATCH];
+} TAGSTATE;
+
+void tagstate_init(TAGSTATE *ts, char *file_id, element_t Dc, element_t Pe, element_t Bc) {
+    ts->file_id = file_id;
+    ts->Dc = Dc;
+    ts->Pe = Pe;
+    ts->Bc = Bc;
+    for (int k = 0; k < TAG_BATCH; k++) {
+        element_init_G1(ts->h2[k], global_params);
+        element_init_Zr(ts->bl[k], global_params);
+        element_init_G1(ts->pows[2 * k], global_params);
+        element_init_G1(ts->pows[2 * k + 1], global_params);
+        ts->h2_ptr[k] = ts->h2[k];
+        ts->bases[2 * k] = Dc;
+        ts->exps[2 * k] = ts->bl[k];
+        ts->bases[2 * k + 1] = ts->h2[k];
+        ts->exps[2 * k + 1] = Bc;
+        ts->outs[2 * k] = ts->pows[2 * k];
+        ts->outs[2 * k + 1] = ts->pows[2 * k + 1];
+        ts->tag[k] = ts->pows[2 * k];
+    }
+}
+
+void tagstate_clear(TAGSTATE *ts) {
+    for (int k = 0; k < TAG_BATCH; k++) {
+        element_clear(ts->h2[k]);
+        element_clear(ts->bl[k]);
+        element_clear(ts->pows[2 * k]);
+        element_clear(ts->pows[2 * k + 1]);
+    }
+}
+
+// Tags blocks first..first+n-1 (n <= TAG_BATCH) held in ts->block:
+// sigma = Dc^bl * (H2 * Pe)^Bc, with the 2n exponentiations in one batch
+void tag_blocks(TAGSTATE *ts, long long first, int n) {
+    int indices[TAG_BATCH];
+    for (int k = 0; k < n; k++) {
+        indices[k] = (int)(first + k);
+    }
+    hash2_blocks(ts->h2_ptr, ts->file_id, indices, n);
+    for (int k = 0; k < n; k++) {
+        element_from_hash(ts->bl[k], ts->block[k], ts->len[k]);
+        element_mul(ts->h2[k], ts->h2[k], ts->Pe);
+    }
+    g1_pow_zn_batch(ts->outs, ts->bases, ts->exps, 2 * n);
+    for (int k = 0; k < n; k++) {
+        element_mul(ts->pows[2 * k], ts->pows[2 * k], ts->pows[2 * k + 1]);
+    }
+    TRACE_COUNT(CNT_HASH_ZR, n);
+    TRACE_COUNT(CNT_G1_EXP, 2 * n);
+}
+
+// Reads block index and its tag through read, decoding the tag into sig. Returns the length of the
+// block, or 0 if either could not be read.
+size_t read_block(audit_block_reader read, void *arg, int index, unsigned char *buffer, unsigned char *sig_bytes,
+                  size_t sig_size, element_t sig) {
+    size_t bytes_read = read(arg, index, buffer, sig_bytes, sig_size);
+    if (bytes_read == 0 || bytes_read > BLOCK_SIZE) {
+        return 0;
+    }
+    element_from_bytes(sig, sig_bytes);
+    return bytes_read;
+}
+
+// Folds one block into the running sums of a proof, given the block hashed into Zr, its tag and the
+// index its coefficient v is drawn for: add_mu += bl*v, pro_sigu *= sig^v (through sig_prod) and
+// add_Zr_points += Be*v.
+void fold_block(element_t bl, element_t sig, unsigned char *seed, int v_index, element_t Be, element_t add_mu,
+                G1PRODUCT *sig_prod, element_t pro_sigu, element_t add_Zr_points) {
+    ZR_ELEMENT(v);
+    ZR_ELEMENT(t);
+    generate_deterministic_v_with_seed(v, (char *)seed, v_index);
+    element_mul(t, bl, v);
+    element_add(add_mu, add_mu, t);
+    g1_product_add(sig_prod, pro_sigu, sig, v);
+    element_mul(t, Be, v);
+    element_add(add_Zr_points, add_Zr_points, t);
+    TRACE_COUNT(CNT_G1_EXP, 1);
+}
+
+// Folds blocks indices[0..n) into the running sums of a proof, fetching each block and its tag
+// through read. Coefficients are drawn for index + v_offset so blocks of different files never
+// share one. Returns 0, or the index of a block that could not be read.
+int fold_blocks(audit_block_reader read, void *arg, int *indices, int n, unsigned char *seed, int v_offset,
+                element_t Be, element_t add_mu, element_t pro_sigu, element_t add_Zr_points, double *totalTimeTaken) {
+    unsigned char buffer[BLOCK_SIZE];
+    ZR_ELEMENT(bl1);
+    G1_ELEMENT(sig);
+    G1PRODUCT sig_prod;
+    g1_product_init(&sig_prod);
+    size_t sig_size = element_length_in_bytes(sig);
+    unsigned char *sig_bytes = malloc(sig_size);
+    uint64_t startTime, endTime;
+    TRACEHIST *block_hist = trace_histogram("proofGen.block");
+    int failed = 0;
+
+    for (int p = 0; p < n; p++) {
+        int index = indices[p];
+        size_t bytes_read = read_block(read, arg, index, buffer, sig_bytes, sig_size, sig);
+        if (bytes_read == 0) {
+            failed = index;
+            break;
+        }
+
+        startTime = trace_now_ns();
+        element_from_hash(bl1, buffer, bytes_read);
+        TRACE_COUNT(CNT_HASH_ZR, 1);
+        fold_block(bl1, sig, seed, index + v_offset, Be, add_mu, &sig_prod, pro_sigu, add_Zr_points);
+        endTime = trace_now_ns();
+        *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+        trace_hist_add(block_hist, endTime - startTime);
+    }
+    startTime = trace_now_ns();
+    g1_product_flush(&sig_prod, pro_sigu);
+    endTime = trace_now_ns();
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+
+    g1_product_clear(&sig_prod);
+    free(sig_bytes);
+    return failed;
+}
+
+// sigu = pro_sigu * Pc^-(sum(Be*v) - Be), leaving a single Pe factor however many blocks were folded in
+void finalize_proof(element_t sigu, element_t pro_sigu, element_t add_Zr_points, element_t Be, element_t Pc, double *totalTimeTaken) {
+    ZR_ELEMENT(j2);
+    G1_ELEMENT(j3);
+    G1_ELEMENT(j4);
+
+    uint64_t startTime = trace_now_ns();
+    element_sub(j2, add_Zr_points, Be);
+    g1_pow_zn(j3, Pc, j2);
+    element_invert(j4, j3);
+    element_mul(sigu, pro_sigu, j4);
+    uint64_t endTime = trace_now_ns();
+    TRACE_COUNT(CNT_G1_EXP, 1);
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+}
+
+// Multiplies prod H2^v over the challenge positions in range into pro_wi
+void accumulate_h2(element_t pro_wi, int *indices, LOCATERANGE range, char *fileName, unsigned char *seed, int v_offset,
+                   double *totalTimeTaken) {
+    ZR_ELEMENT(Zr_point);
+    G1_ELEMENTS(wi, H2_BATCH);
+    element_ptr wi_ptr[H2_BATCH];
+    for (int k = 0; k < H2_BATCH; k++) {
+        wi_ptr[k] = wi.e[k];
+    }
+    G1PRODUCT h2_prod;
+    g1_product_init(&h2_prod);
+
+    uint64_t startTime = trace_now_ns();
+    for (int p = range.lo; p < range.hi; p += H2_BATCH) {
+        int n = range.hi - p < H2_BATCH ? range.hi - p : H2_BATCH;
+        hash2_blocks(wi_ptr, fileName, indices + p, n);
+        for (int k = 0; k < n; k++) {
+            generate_deterministic_v_with_seed(Zr_point, (char *)seed, indices[p + k] + v_offset);
+            g1_product_add(&h2_prod, pro_wi, wi.e[k], Zr_point);
+        }
+    }
+    g1_product_flush(&h2_prod, pro_wi);
+    uint64_t endTime = trace_now_ns();
+    g1_product_clear(&h2_prod);
+    TRACE_COUNT(CNT_G1_EXP, range.hi - range.lo);
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+}
+
+// The proof-dependent half of verification: e(sigu, g) == e(Qc^mu, g0) * b3
+int check_proof_online(element_t mu, element_t sigu, element_t b3, element_t Qc, element_t g, element_t g0,
+                       double *totalTimeTaken) {
+    G1_ELEMENT(x1);
+    GT_ELEMENT(b1);
+    GT_ELEMENT(b2);
+    GT_ELEMENT(b4);
+
+    uint64_t startTime = trace_now_ns();
+    element_pairing(b1, sigu, g);
+    g1_pow_zn(x1, Qc, mu);
+    element_pairing(b2, x1, g0);
+    element_mul(b4, b2, b3);
+    uint64_t endTime = trace_now_ns();
+    TRACE_COUNT(CNT_PAIRING, 2);
+    TRACE_COUNT(CNT_G1_EXP, 1);
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+
+    return !element_cmp(b1, b4);
+}
+
+// e(sigu, g) == e(Qc^mu, g0) * e(pro_wi * Pe, Pc)
+int check_proof(element_t mu, element_t sigu, element_t pro_wi, element_t Qc, element_t Pe, element_t Pc,
+                element_t g, element_t g0, double *totalTimeTaken) {
+    G1_ELEMENT(j7);
+    GT_ELEMENT(b3);
+
+    uint64_t startTime = trace_now_ns();
+    element_mul(j7, pro_wi, Pe);
+    element_pairing(b3, j7, Pc);
+    uint64_t endTime = trace_now_ns();
+    TRACE_COUNT(CNT_PAIRING, 1);
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+
+    return check_proof_online(mu, sigu, b3, Qc, g, g0, totalTimeTaken);
+}
+
+// The proof-independent half of verification: b3 = e(prod H2_i^v_i * Pe, Pc) over the challenged
+// blocks. chalGen --prepare computes it ahead of time; otherwise verifyproof runs it inline. Returns 0
+// when the challenge indices cannot be allocated.
+int verify_offline(element_t b3, CHALLENGE *chal, char *fileName, long long num_blocks, element_t Pe, element_t Pc,
+                    double *totalTimeTaken) {
+    G1_ELEMENT(j7);
+    G1_ELEMENT(pro_wi);
+
+    int challenge_blocks = challenge_size(chal, num_blocks);
+
+    int span = trace_begin("verifyProof", "challenge");
+    int *indices = draw_challenge_indices(chal->seed, challenge_blocks, num_blocks);
+    trace_end(span);
+    if (!indices) {
+        return 0;
+    }
+
+    span = trace_begin("verifyProof", "blocks");
+    element_set1(pro_wi);
+    accumulate_h2(pro_wi, indices, (LOCATERANGE){0, challenge_blocks}, fileName, chal->seed, 0, totalTimeTaken);
+
+    uint64_t startTime = trace_now_ns();
+    element_mul(j7, pro_wi, Pe);
+    element_pairing(b3, j7, Pc);
+    uint64_t endTime = trace_now_ns();
+    TRACE_COUNT(CNT_PAIRING, 1);
+    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+    trace_end(span);
+
+    free(indices);
+    return 1;
+}
+
+// libaudit API (declared in libaudit.h). The pairing is process-wide, as everything above works on
+// global_params, so contexts only count references to it, under audit_lib.lock.
+
+struct AUDITCTX {
+    size_t tag_size;
+    size_t proof_size;
+};
+
+struct {
+    pthread_mutex_t lock;
+    int refs;
+    char *params;
+    size_t params_len;
+} audit_lib = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+struct AUDITTAGGER {
+    TAGSTATE ts;
+    element_t Dc;
+    element_t Pe;
+    element_t Bc;
+    char *file_id;
+    size_t fill;            // bytes in the block being assembled
+    int pending;            // complete blocks waiting in ts.block
+    long long next_block;   // number of ts.block[0]
+    unsigned char *tag_bytes;
+    size_t tag_size;
+    audit_tag_sink sink;
+    void *arg;
+};
+
+// Reads the next element of a key, parameter or proof buffer; 0 when the buffer is too short
+int audit_read_element(element_t e, AUDITBYTES buf, size_t *pos) {
+    size_t size = element_length_in_bytes(e);
+    if (buf.data == NULL || buf.len < *pos + size) {
+        return 0;
+    }
+    element_from_bytes(e, (unsigned char *) buf.data + *pos);
+    *pos += size;
+    return 1;
+}
+
+// The G2 half of a public key buffer, as read_public_key_G2() reads it from a file
+int audit_read_public_key_G2(element_t P2, AUDITBYTES buf) {
+    size_t pos = pairing_is_symmetric(global_params) ? 0 : pairing_length_in_bytes_G1(global_params);
+    return audit_read_element(P2, buf, &pos);
+}
+
+void audit_challenge_copy(CHALLENGE *out, const AUDITCHALLENGE *chal) {
+    memset(out, 0, sizeof(*out));
+    memcpy(out->seed, chal->seed, SEED_SIZE);
+    out->ratio = chal->ratio;
+    out->count = chal->count;
+}
+
+int audit_open(AUDITCTX **ctx, const char *params, size_t len) {
+    if (ctx == NULL || params == NULL) {
+        return AUDIT_EINVAL;
+    }
+    AUDITCTX *c = malloc(sizeof(*c));
+    if (c == NULL) {
+        return AUDIT_ENOMEM;
+    }
+    int status = AUDIT_OK;
+    pthread_mutex_lock(&audit_lib.lock);
+    if (audit_lib.refs == 0) {
+        audit_lib.params = malloc(len);
+        if (audit_lib.params == NULL) {
+            status = AUDIT_ENOMEM;
+        }
+        else if (pairing_init_set_buf(global_params, params, len)) {
+            free(audit_lib.params);
+            audit_lib.params = NULL;
+            status = AUDIT_EPARAM;
+        }
+        else {
+#ifdef AUDIT_FP512
+            fp512_init_param(params, len, global_params);
+#endif
+            memcpy(audit_lib.params, params, len);
+            audit_lib.params_len = len;
+        }
+    }
+    else if (len != audit_lib.params_len || memcmp(params, audit_lib.params, len) != 0) {
+        status = AUDIT_EPARAM;
+    }
+    if (status == AUDIT_OK) {
+        audit_lib.refs++;
+        c->tag_size = pairing_length_in_bytes_G1(global_params);
+        c->proof_size = pairing_length_in_bytes_Zr(global_params) + pairing_length_in_bytes_G1(global_params);
+    }
+    pthread_mutex_unlock(&audit_lib.lock);
+    if (status != AUDIT_OK) {
+        free(c);
+        return status;
+    }
+    *ctx = c;
+    return AUDIT_OK;
+}
+
+void audit_close(AUDITCTX *ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+    free(ctx);
+    pthread_mutex_lock(&audit_lib.lock);
+    if (--audit_lib.refs == 0) {
+        pairing_clear(global_params);
+#ifdef AUDIT_FP512
+        fp512_field.ready = 0;
+        fp512_field.hash_ready = 0;
+#endif
+        free(audit_lib.params);
+        audit_lib.params = NULL;
+    }
+    pthread_mutex_unlock(&audit_lib.lock);
+}
+
+size_t audit_tag_size(AUDITCTX *ctx) {
+    return ctx->tag_size;
+}
+
+size_t audit_proof_size(AUDITCTX *ctx) {
+    return ctx->proof_size;
+}
+
+int audit_tagger_new(AUDITCTX *ctx, AUDITTAGGER **tagger, const char *file_id, AUDITBYTES csp_full_private_key,
+                     AUDITBYTES auditee_public_key, audit_tag_sink sink, void *arg) {
+    if (ctx == NULL || tagger == NULL || file_id == NULL || sink == NULL) {
+        return AUDIT_EINVAL;
+    }
+    AUDITTAGGER *t = malloc(sizeof(*t));
+    if (t == NULL) {
+        return AUDIT_ENOMEM;
+    }
+    element_init_G1(t->Dc, global_params);
+    element_init_G1(t->Pe, global_params);
+    element_init_Zr(t->Bc, global_params);
+    size_t pos = 0, pe_pos = 0;
+    if (!audit_read_element(t->Bc, csp_full_private_key, &pos) || !audit_read_element(t->Dc, csp_full_private_key, &pos) ||
+        !audit_read_element(t->Pe, auditee_public_key, &pe_pos)) {
+        element_clear(t->Dc);
+        element_clear(t->Pe);
+        element_clear(t->Bc);
+        free(t);
+        return AUDIT_EKEY;
+    }
+    t->file_id = strdup(file_id);
+    tagstate_init(&t->ts, t->file_id, t->Dc, t->Pe, t->Bc);
+    t->fill = 0;
+    t->pending = 0;
+    t->next_block = 1;
+    t->tag_size = ctx->tag_size;
+    t->tag_bytes = malloc(t->tag_size);
+    t->sink = sink;
+    t->arg = arg;
+    *tagger = t;
+    return AUDIT_OK;
+}
+
+// Tags the pending blocks and hands their tags to the sink
+int audit_tagger_flush(AUDITTAGGER *t) {
+    int n = t->pending;
+    if (n == 0) {
+        return AUDIT_OK;
+    }
+    tag_blocks(&t->ts, t->next_block, n);
+    t->pending = 0;
+    for (int k = 0; k < n; k++) {
+        element_to_bytes(t->tag_bytes, t->ts.tag[k]);
+        if (t->sink(t->arg, t->next_block++, t->tag_bytes, t->tag_size) != 0) {
+            return AUDIT_EIO;
+        }
+    }
+    return AUDIT_OK;
+}
+
+int audit_tagger_update(AUDITTAGGER *t, const void *data, size_t len) {
+    const unsigned char *in = data;
+    while (len > 0) {
+        size_t take = BLOCK_SIZE - t->fill < len ? BLOCK_SIZE - t->fill : len;
+        memcpy(t->ts.block[t->pending] + t->fill, in, take);
+        t->fill += take;
+        in += take;
+        len -= take;
+        if (t->fill == BLOCK_SIZE) {
+            t->ts.len[t->pending++] = BLOCK_SIZE;
+            t->fill = 0;
+            if (t->pending == TAG_BATCH) {
+                int rc = audit_tagger_flush(t);
+                if (rc != AUDIT_OK) {
+                    return rc;
+                }
+            }
+        }
+    }
+    return AUDIT_OK;
+}
+
+int audit_tagger_finish(AUDITTAGGER *t, long long *num_blocks) {
+    // A short final block is a block of its own, as tagGen counts them
+    if (t->fill > 0) {
+        t->ts.len[t->pending++] = t->fill;
+        t->fill = 0;
+    }
+    int rc = audit_tagger_flush(t);
+    if (num_blocks) {
+        *num_blocks = t->next_block - 1;
+    }
+    tagstate_clear(&t->ts);
+    element_clear(t->Dc);
+    element_clear(t->Pe);
+    element_clear(t->Bc);
+    free(t->file_id);
+    free(t->tag_bytes);
+    free(t);
+    return rc;
+}
+
+int audit_challenge_new(AUDITCHALLENGE *chal, double ratio, long long count) {
+    if (chal == NULL || count < 0 || (count == 0 && (ratio <= 0 || ratio > 1))) {
+        return AUDIT_EINVAL;
+    }
+    FILE *random_file = fopen("/dev/urandom", "rb");
+    if (random_file == NULL) {
+        return AUDIT_EIO;
+    }
+    size_t got = fread(chal->seed, 1, AUDIT_SEED_SIZE, random_file);
+    fclose(random_file);
+    if (got != AUDIT_SEED_SIZE) {
+        return AUDIT_EIO;
+    }
+    chal->ratio = count > 0 ? 0.0f : (float) ratio;
+    chal->count = count;
+    return AUDIT_OK;
+}
+
+int audit_prove(AUDITCTX *ctx, AUDITBYTES auditee_full_private_key, AUDITBYTES csp_public_key,
+                const AUDITCHALLENGE *chal, long long num_blocks, audit_block_reader read, void *arg,
+                unsigned char *proof) {
+    if (ctx == NULL || chal == NULL || read == NULL || proof == NULL || num_blocks < 1 || num_blocks > INT_MAX) {
+        return AUDIT_EINVAL;
+    }
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
+    ZR_ELEMENT(add_Zr_points);
+    ZR_ELEMENT(add_mu);
+    G1_ELEMENT(sigu);
+    G1_ELEMENT(pro_sigu);
+    size_t be_pos = 0, pc_pos = 0;
+    if (!audit_read_element(Be, auditee_full_private_key, &be_pos) || !audit_read_element(Pc, csp_public_key, &pc_pos)) {
+        return AUDIT_EKEY;
+    }
+
+    CHALLENGE c;
+    audit_challenge_copy(&c, chal);
+    int challenge_blocks = challenge_size(&c, num_blocks);
+    int *indices = draw_challenge_indices(c.seed, challenge_blocks, num_blocks);
+    if (!indices) {
+        return AUDIT_ENOMEM;
+    }
+
+    double totalTimeTaken = 0.0;
+    element_set0(add_Zr_points);
+    element_set0(add_mu);
+    element_set1(pro_sigu);
+    int failed = fold_blocks(read, arg, indices, challenge_blocks, c.seed, 0, Be, add_mu, pro_sigu, add_Zr_points,
+                             &totalTimeTaken);
+    free(indices);
+    if (failed) {
+        return AUDIT_EIO;
+    }
+    finalize_proof(sigu, pro_sigu, add_Zr_points, Be, Pc, &totalTimeTaken);
+
+    // POP.bin layout: mu, then sigu
+    int mu_size = element_to_bytes(proof, add_mu);
+    element_to_bytes(proof + mu_size, sigu);
+    return AUDIT_OK;
+}
+
+int audit_verify(AUDITCTX *ctx, AUDITBYTES csp_public_key, AUDITBYTES auditee_public_key, const char *csp_id,
+                 AUDITBYTES local_params, const AUDITCHALLENGE *chal, const char *file_id, long long num_blocks,
+                 AUDITBYTES proof) {
+    if (ctx == NULL || csp_id == NULL || chal == NULL || file_id == NULL || num_blocks < 1 || num_blocks > INT_MAX) {
+        return AUDIT_EINVAL;
+    }
+    G1_ELEMENT(Qc);
+    G2_ELEMENT(Pc);
+    G1_ELEMENT(Pe);
+    G1_ELEMENT(sigu);
+    G2_ELEMENT(g);
+    G2_ELEMENT(g0);
+    ZR_ELEMENT(mu);
+    GT_ELEMENT(b3);
+    size_t pe_pos = 0, params_pos = 0, proof_pos = 0;
+    if (!audit_read_public_key_G2(Pc, csp_public_key) || !audit_read_element(Pe, auditee_public_key, &pe_pos) ||
+        !audit_read_element(g, local_params, &params_pos) || !audit_read_element(g0, local_params, &params_pos) ||
+        !audit_read_element(mu, proof, &proof_pos) || !audit_read_element(sigu, proof, &proof_pos)) {
+        return AUDIT_EKEY;
+    }
+
+    H1(Qc, (char *) csp_id);
+    CHALLENGE c;
+    audit_challenge_copy(&c, chal);
+    double totalTimeTaken = 0.0;
+    if (!verify_offline(b3, &c, (char *) file_id, num_blocks, Pe, Pc, &totalTimeTaken)) {
+        return AUDIT_ENOMEM;
+    }
+    return check_proof_online(mu, sigu, b3, Qc, g, g0, &totalTimeTaken);
+}
@@ -1,18 +1,10 @@
 #include "pbc_utils.h"
+#include "storage_utils.h"
 
 #define BLOCK_SIZE 1000
 #define SEED_SIZE 32
-
-// Generate integers from 1 to iterations in a file
-void genint(char* filename, long long iterations) {
-    FILE *file = open_file(filename, "w");
-    
-    for (long long i = 1; i <= iterations; i++) {
-        fprintf(file, "%lld\n", i);
-    }
-    
-    fclose(file);
-}
+#define CHAL_MIN_BLOCKS 10       // default floor for detection-based challenges
+#define CHAL_MAX_BLOCKS 100000   // default cap for detection-based challenges
 
 // Function to read the seed from the binary file
 void read_seed(char *seed_file_name, char *seed) {
@@ -25,31 +17,26 @@ void read_seed(char *seed_file_name, char *seed) {
     fclose(seedFile);
 }
 
-// Process and hash function(H2)
-void process_and_hash2(long long iterations, char* filename, char* id_f, char* filename1, element_t Pe) {
-    element_t result;
-    element_init_G1(result, global_params);
-    char file1[50];
-    size_t offset = 0;
-    strcpy(file1 + offset, id_f);
-    offset += strlen(id_f);
-
-    char integer_str[20];
-    FILE *file = open_file(filename, "r");
-    
-    FILE *H2_write = open_file(filename1, "wb");
-    
-    for (long long i = 1; i <= iterations; i++) {
-        read_integer_from_file(file, integer_str, sizeof(integer_str));
-        strcpy(file1 + offset, integer_str);
-        element_from_hash(result, file1, strlen(file1));
-        save_element_to_file(result, H2_write);
+// H2 of n blocks at once: out[k] = H2(id_f || indices[k]) with n <= H2_BATCH
+void hash2_blocks(element_ptr *out, char *id_f, int *indices, int n) {
+    char file1[H2_BATCH][256];
+    char *data[H2_BATCH];
+    int len[H2_BATCH];
+    for (int k = 0; k < n; k++) {
+        data[k] = file1[k];
+        len[k] = snprintf(file1[k], sizeof(file1[k]), "%s%d", id_f, indices[k]);
     }
-    fclose(file);
-    fclose(H2_write);
+    g1_from_hash_batch(out, data, len, n);
+}
+
+// H2 of a single block: hash of the data file identifier followed by the block index
+void hash2_block(element_t result, char *id_f, int index) {
+    element_ptr out = result;
+    hash2_blocks(&out, id_f, &index, 1);
 }
 
 // Generates a deterministic PBC_element from Zr using a seed and index for unique randomness.
+// v must already be initialized in Zr.
 void generate_deterministic_v_with_seed(element_t v, const char* seed_str, int index) {
     unsigned long seed = strtoul(seed_str, NULL, 10) + index;  // Vary seed by index for distinct points
 
@@ -61,13 +48,12 @@ void generate_deterministic_v_with_seed(element_t v, const char* seed_str, int i
     mpz_init(rand_int);
     mpz_urandomb(rand_int, rand_state, 256); // Generate a random number of 256 bits
 
-    element_init_Zr(v, global_params);
-
     char rand_str[65];
     mpz_get_str(rand_str, 16, rand_int);  // Convert random integer to string (hex format)
     rand_str[64] = '\0';  // Ensure null-termination
 
     element_from_hash(v, rand_str, strlen(rand_str));
+    TRACE_COUNT(CNT_HASH_ZR, 1);
 
     mpz_clear(rand_int);
     gmp_randclear(rand_state);
@@ -83,11 +69,49 @@ int is_in_array(int num, int *array, int size) {
     return 0; // Number is not in the array
 }
 
+// Local state of the generator that draws challenged blocks: the additive feedback generator behind
+// glibc's rand(), so the same seed challenges the same blocks, without touching the process-wide rand()
+// state a library host may be using
+typedef struct {
+    int32_t r[31];
+    int front, rear;
+} CHALRAND;
+
+int chalrand_next(CHALRAND *rng) {
+    uint32_t val = (uint32_t) rng->r[rng->front] + (uint32_t) rng->r[rng->rear];
+    rng->r[rng->front] = (int32_t) val;
+    rng->front = (rng->front + 1) % 31;
+    rng->rear = (rng->rear + 1) % 31;
+    return (int) (val >> 1);
+}
+
+// As srand() does, from the first 4 bytes of the challenge seed
+void chalrand_seed(CHALRAND *rng, const unsigned char *seed) {
+    unsigned int seedI;
+    memcpy(&seedI, seed, sizeof(seedI));
+    int32_t word = seedI ? (int32_t) seedI : 1;
+    rng->r[0] = word;
+    for (int i = 1; i < 31; i++) {
+        // 16807 * word % 2147483647 without overflowing 31 bits
+        long hi = word / 127773, lo = word % 127773;
+        word = 16807 * lo - 2836 * hi;
+        if (word < 0) {
+            word += 2147483647;
+        }
+        rng->r[i] = word;
+    }
+    rng->front = 3;
+    rng->rear = 0;
+    for (int i = 0; i < 310; i++) {
+        chalrand_next(rng);
+    }
+}
+
 // Generate distinct random numbers
-void generate_unique_random_numbers(int lower, int upper, int num_blocks, int *numbers) {
+void generate_unique_random_numbers(CHALRAND *rng, int lower, int upper, int num_blocks, int *numbers) {
     int num_generated = 0;
     while (num_generated < num_blocks) {
-        int num = lower + rand() % (upper - lower + 1);
+        int num = lower + chalrand_next(rng) % (upper - lower + 1);
         if (!is_in_array(num, numbers, num_generated)) {
             numbers[num_generated] = num;
             num_generated++;
@@ -100,54 +124,109 @@ int compare(const void *a, const void *b) {
     return (*(int*)a - *(int*)b);
 }
 
-// Function to initialize random seed
-unsigned int initialize_random_seed(const unsigned char *seed) {
-    unsigned int seedI;
-    memcpy(&seedI, seed, sizeof(seedI)); // Copy first 4 bytes of seed into seedI
-    srand(seedI);  // Initialize the random number generator
-    return seedI;
-}
-
-// Main function or calling function to demonstrate usage
-void process_numbers(const unsigned char *seed, int num_blocks, int block_count, char *filename) {
-
-    initialize_random_seed(seed);
+// Returns the sorted challenged block indices (1-based) drawn from seed, or NULL when the array cannot
+// be allocated; the caller frees the array
+int *draw_challenge_indices(const unsigned char *seed, int num_blocks, int block_count) {
+    CHALRAND rng;
+    chalrand_seed(&rng, seed);
 
     // Define range and allocate memory for numbers array
     int lower = 1, upper = block_count;
-    int *numbers = malloc(num_blocks * sizeof(int));
+    int *numbers = malloc((num_blocks > 0 ? num_blocks : 1) * sizeof(int));
     if (!numbers) {
-        perror("Failed to allocate memory for numbers array");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
     // Generate unique random numbers
-    generate_unique_random_numbers(lower, upper, num_blocks, numbers);
+    generate_unique_random_numbers(&rng, lower, upper, num_blocks, numbers);
 
     // Sort the generated numbers
     qsort(numbers, num_blocks, sizeof(int), compare);
 
-    // Write sorted numbers to the file
-    write_numbers_to_file(filename, numbers, num_blocks);
+    return numbers;
+}
 
-    // Cleanup
-    free(numbers);
+// draw_challenge_indices() for the commands, which give up when memory runs out
+int *challenge_indices(const unsigned char *seed, int num_blocks, int block_count) {
+    int *numbers = draw_challenge_indices(seed, num_blocks, block_count);
+    if (!numbers) {
+        perror("Failed to allocate memory for numbers array");
+        exit(EXIT_FAILURE);
+    }
+    return numbers;
 }
 
-int read_challenge_file(FILE *chalFile, unsigned char *seed, float *num) {
-    if (fread(seed, 1, SEED_SIZE, chalFile) != SEED_SIZE) {
+// Contents of a challenge file: the seed followed by either a ratio of blocks or an absolute block count
+typedef struct {
+    unsigned char seed[SEED_SIZE];
+    float ratio;
+    long long count;    // 0 when the challenge is a ratio
+} CHALLENGE;
+
+int read_challenge_file(FILE *chalFile, CHALLENGE *chal) {
+    char token[64];
+    
+    if (fread(chal->seed, 1, SEED_SIZE, chalFile) != SEED_SIZE) {
         printf("Error: Could not read the seed from the challenge file.\n");
         exit(EXIT_FAILURE);
     }
     
-    if (fscanf(chalFile, "%f", num) != 1) {
-        printf("Error: Could not read the challenge percentage from the challenge file.\n");
+    if (fscanf(chalFile, "%63s", token) != 1) {
+        printf("Error: Could not read the challenge size from the challenge file.\n");
         exit(EXIT_FAILURE);
     }
     
+    // Ratios are always written with a decimal point, block counts never are
+    if (strpbrk(token, ".eE")) {
+        chal->ratio = atof(token);
+        chal->count = 0;
+    }
+    else {
+        chal->ratio = 0;
+        chal->count = atoll(token);
+    }
+    
     return 1;
 }
 
+// Pre-verification file written by chalGen --prepare: this header followed by
+// e(prod H2_i^v_i * Pe, Pc) in GT, the proof-independent factor of the verification equation
+#define PREVERIFY_MAGIC "DCAPREV1"
+
+typedef struct {
+    char magic[8];
+    uint64_t chal_hash;     // challenge it was prepared for
+    uint64_t setup_hash;    // file identifier, block count and the two public keys
+} PREVERIFYHEADER;
+
+// Fingerprint of a challenge, so answers to different challenges are never combined
+uint64_t challenge_hash(CHALLENGE *chal) {
+    uint64_t hash = fnv1a_update(FNV_OFFSET, chal->seed, SEED_SIZE);
+    hash = fnv1a_update(hash, &chal->ratio, sizeof(chal->ratio));
+    return fnv1a_update(hash, &chal->count, sizeof(chal->count));
+}
+
+// Number of blocks to challenge in a file of block_count blocks
+int challenge_size(CHALLENGE *chal, long long block_count) {
+    if (chal->count > 0) {
+        return chal->count < block_count ? chal->count : block_count;
+    }
+    return (int)(block_count * chal->ratio);
+}
+
+// Smallest c with 1 - (1 - rate)^c >= probability, clamped to [min_blocks, max_blocks].
+// Sampling with replacement is the worst case, so distinct challenged blocks detect at least as well.
+long long detection_challenge_count(double probability, double rate, long long min_blocks, long long max_blocks) {
+    long long count = rate >= 1 ? 1 : (long long)ceil(log(1 - probability) / log(1 - rate));
+    if (count < min_blocks) {
+        count = min_blocks;
+    }
+    if (count > max_blocks) {
+        count = max_blocks;
+    }
+    return count;
+}
+
 void write_to_file(char *filename, char *id_f, long long num_blocks) {
     FILE *file = open_file(filename, "w");
     fprintf(file, "%s\n", id_f);
@@ -166,3 +245,104 @@ void read_from_file(char *filename, char **fileName, long long *num_blocks) {
     fscanf(file, "%lld", num_blocks);
     fclose(file);
 }
+
+// A contiguous run [lo, hi) of positions in the sorted challenge index list
+typedef struct {
+    int lo;
+    int hi;
+} LOCATERANGE;
+
+// Reads "lo hi" lines into a malloc'd array; an empty or missing file gives no ranges
+LOCATERANGE *read_ranges(char *filename, int *count) {
+    *count = 0;
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    int capacity = 64;
+    LOCATERANGE *ranges = NULL;
+    int lo, hi;
+    while (fscanf(file, "%d %d", &lo, &hi) == 2) {
+        if (*count == capacity || ranges == NULL) {
+            capacity = ranges ? capacity * 2 : capacity;
+            ranges = realloc(ranges, capacity * sizeof(LOCATERANGE));
+            if (!ranges) {
+                perror("Failed to allocate memory for ranges");
+                exit(EXIT_FAILURE);
+            }
+        }
+        ranges[*count].lo = lo;
+        ranges[*count].hi = hi;
+        (*count)++;
+    }
+    fclose(file);
+    return ranges;
+}
+
+void write_ranges(char *filename, LOCATERANGE *ranges, int count) {
+    FILE *file = open_file(filename, "w");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%d %d\n", ranges[i].lo, ranges[i].hi);
+    }
+    fclose(file);
+}
+
+// One line of a multi-file manifest: "<input file> <metadata file> <file info file>".
+// The prover reads the first two columns, the verifier only the third.
+typedef struct {
+    char *input;
+    char *sigma;
+    char *info;
+} MANIFESTENTRY;
+
+MANIFESTENTRY *read_manifest(char *filename, int *count) {
+    FILE *file = open_file(filename, "r");
+    int capacity = 16;
+    MANIFESTENTRY *entries = malloc(capacity * sizeof(MANIFESTENTRY));
+    char input[1024], sigma[1024], info[1024];
+
+    *count = 0;
+    while (entries && fscanf(file, "%1023s %1023s %1023s", input, sigma, info) == 3) {
+        if (*count == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity * sizeof(MANIFESTENTRY));
+            if (!entries) {
+                break;
+            }
+        }
+        entries[*count].input = strdup(input);
+        entries[*count].sigma = strdup(sigma);
+        entries[*count].info = strdup(info);
+        (*count)++;
+    }
+    if (!entries) {
+        perror("Failed to allocate memory for manifest");
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+
+    if (*count == 0) {
+        printf("Error: Manifest %s lists no files\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return entries;
+}
+
+void free_manifest(MANIFESTENTRY *entries, int count) {
+    for (int i = 0; i < count; i++) {
+        free(entries[i].input);
+        free(entries[i].sigma);
+        free(entries[i].info);
+    }
+    free(entries);
+}
+
+// Challenge seed of the file at position file_index in a manifest: the bytes chalrand_seed() draws from, offset by file_index
+void file_seed(const unsigned char *seed, int file_index, unsigned char *out) {
+    unsigned int seedI;
+    memcpy(out, seed, SEED_SIZE);
+    memcpy(&seedI, out, sizeof(seedI));
+    seedI += file_index;
+    memcpy(out, &seedI, sizeof(seedI));
+}
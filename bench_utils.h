@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_MAX_SAMPLES 1024
+
+// Wall-clock and CPU time of one measured run, both in ms, and its peak resident set
+typedef struct {
+    double wall_ms;
+    double cpu_ms;
+    long maxrss_kb;
+} BENCHSAMPLE;
+
+// Summary statistics over the repetitions of one measurement
+typedef struct {
+    int n;
+    double min, median, mean, p90, p99, max;
+} BENCHSTATS;
+
+// Monotonic wall clock in ms
+double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Runs argv as a child process with stdout captured into out (may be NULL).
+// Returns the child's exit status, or -1 if it did not exit normally.
+int run_measured(char **argv, BENCHSAMPLE *sample, char *out, size_t out_size) {
+    int pipefd[2];
+    if (pipe(pipefd) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    double startTime = now_ms();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        close(pipefd[0]);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+        execv(argv[0], argv);
+        perror("execv");
+        _exit(127);
+    }
+    close(pipefd[1]);
+
+    size_t used = 0;
+    char sink[4096];
+    ssize_t got;
+    while ((got = read(pipefd[0], sink, sizeof(sink))) > 0) {
+        if (out && used + 1 < out_size) {
+            size_t take = (size_t)got < out_size - used - 1 ? (size_t)got : out_size - used - 1;
+            memcpy(out + used, sink, take);
+            used += take;
+        }
+    }
+    close(pipefd[0]);
+    if (out) {
+        out[used] = '\0';
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("wait4");
+        exit(EXIT_FAILURE);
+    }
+    double endTime = now_ms();
+
+    sample->wall_ms = endTime - startTime;
+    sample->cpu_ms = timeval_ms(usage.ru_utime) + timeval_ms(usage.ru_stime);
+    sample->maxrss_kb = usage.ru_maxrss;
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+#define MAX_WORKERS 256
+
+// Outcome of one audit, also the exit status of the worker process that ran it
+enum { VERDICT_PASS, VERDICT_FAIL, VERDICT_ERROR };
+
+char *verdict_names[] = { "PASS", "FAIL", "ERROR" };
+
+// Verdict in verifyProof's output: the banner of a debug build or the bare 1 or 0 of a quiet one
+int parse_verdict(const char *out) {
+    if (strstr(out, "Successfull") || strcmp(out, "1") == 0) {
+        return VERDICT_PASS;
+    }
+    if (strstr(out, "Failed") || strcmp(out, "0") == 0) {
+        return VERDICT_FAIL;
+    }
+    return VERDICT_ERROR;
+}
+
+// Worker processes, each running one job at a time in its own directory, since dataAudit writes
+// fixed file names into its working directory
+typedef struct {
+    int size;
+    int running;
+    pid_t pid[MAX_WORKERS];     // 0 for an idle worker
+    char *dir[MAX_WORKERS];
+} WORKERPOOL;
+
+// Sets up size idle workers in the directories base/w0 .. base/w<size - 1>
+void pool_init(WORKERPOOL *pool, char *base, int size) {
+    mkdir(base, 0755);
+    pool->size = size;
+    pool->running = 0;
+    for (int w = 0; w < size; w++) {
+        size_t len = strlen(base) + 16;
+        pool->dir[w] = malloc(len);
+        if (!pool->dir[w]) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        snprintf(pool->dir[w], len, "%s/w%d", base, w);
+        mkdir(pool->dir[w], 0755);
+        pool->pid[w] = 0;
+    }
+}
+
+// Forks a job onto an idle worker (there must be one) and stores the worker's index in slot.
+// Returns 0 in the child, which runs the job in pool->dir[*slot] and exits with its verdict,
+// and the child's pid in the parent.
+pid_t pool_fork(WORKERPOOL *pool, int *slot) {
+    int w = 0;
+    while (pool->pid[w]) {
+        w++;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    *slot = w;
+    if (pid > 0) {
+        pool->pid[w] = pid;
+        pool->running++;
+    }
+    return pid;
+}
+
+// Waits for a job to finish and frees its worker. Returns the worker's index with the job's verdict
+// and resource usage, or -1 when the wait was interrupted or reaped some other child.
+int pool_wait(WORKERPOOL *pool, int *verdict, struct rusage *usage) {
+    int status;
+    pid_t pid = wait4(-1, &status, 0, usage);
+    if (pid < 0) {
+        if (errno == EINTR) {
+            return -1;
+        }
+        perror("wait4");
+        exit(EXIT_FAILURE);
+    }
+    int w = 0;
+    while (w < pool->size && pool->pid[w] != pid) {
+        w++;
+    }
+    if (w == pool->size) {
+        return -1;
+    }
+    pool->pid[w] = 0;
+    pool->running--;
+    *verdict = WIFEXITED(status) && WEXITSTATUS(status) <= VERDICT_ERROR ? WEXITSTATUS(status) : VERDICT_ERROR;
+    return w;
+}
+
+// Returns a heap copy of name made absolute against dir (NULL stays NULL)
+char *absolute_path(char *name, char *dir) {
+    if (name == NULL || name[0] == '/') {
+        return name;
+    }
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char *path = malloc(len);
+    if (!path) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(path, len, "%s/%s", dir, name);
+    return path;
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array
+double percentile(double *sorted, int n, double p) {
+    int rank = (int)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+void compute_stats(double *values, int n, BENCHSTATS *stats) {
+    double sum = 0.0;
+
+    if (n <= 0) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    double *sorted = malloc(n * sizeof(double));
+    if (!sorted) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, values, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), compare_double);
+    for (int i = 0; i < n; i++) {
+        sum += sorted[i];
+    }
+
+    stats->n = n;
+    stats->min = sorted[0];
+    stats->max = sorted[n - 1];
+    stats->mean = sum / n;
+    stats->median = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    stats->p90 = percentile(sorted, n, 90);
+    stats->p99 = percentile(sorted, n, 99);
+    free(sorted);
+}
+
+// Parses sizes such as 4096, 64K, 1M, 10G
+long long parse_size(const char *str) {
+    char *end;
+    double value = strtod(str, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.0; break;
+        case 'm': case 'M': value *= 1024.0 * 1024; break;
+        case 'g': case 'G': value *= 1024.0 * 1024 * 1024; break;
+        case '\0': break;
+        default:
+            printf("Error: Invalid size %s\n", str);
+            exit(EXIT_FAILURE);
+    }
+    return (long long)value;
+}
+
+// Fills a file with size bytes of pseudo-random data derived from seed
+void generate_data_file(char *filename, long long size, uint64_t seed) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    static uint64_t chunk[1 << 17];  // 1 MB
+    uint64_t state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+
+    while (size > 0) {
+        for (size_t i = 0; i < sizeof(chunk) / sizeof(chunk[0]); i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            chunk[i] = state;
+        }
+        size_t take = size < (long long)sizeof(chunk) ? (size_t)size : sizeof(chunk);
+        if (fwrite(chunk, 1, take, file) != take) {
+            perror("Error writing data file");
+            exit(EXIT_FAILURE);
+        }
+        size -= take;
+    }
+    fclose(file);
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Progress record of a long tagGen run, kept next to the tag file as "<tag file>.ckpt".
+// The tags it covers are fsynced before the record is replaced (write .tmp, fsync, rename), so
+// after a crash the record never claims more tags than are on disk. Both the tagged input prefix
+// and the tag prefix are fingerprinted, and a resumed run refuses to continue if either changed.
+
+#define CHECKPOINT_MAGIC "DCACKPT1"
+#define CHECKPOINT_SUFFIX ".ckpt"
+#define CHECKPOINT_INTERVAL_MS 5000.0   // default time between checkpoints
+
+typedef struct {
+    char magic[8];
+    uint64_t done_blocks;   // blocks whose tags are durable
+    uint64_t done_bytes;    // input bytes covered by those blocks
+    uint64_t input_hash;    // FNV-1a of the first done_bytes of the input
+    uint64_t sigma_hash;    // FNV-1a of the first done_blocks tags
+    uint64_t setup_hash;    // FNV-1a of the input name and the tagging keys
+    double time_ms;         // tagging time spent up to this checkpoint
+} TAGCHECKPOINT;
+
+// Folds bytes [from, to) of fd into hash; returns 0 if the file is shorter than to
+int fnv1a_file_range(int fd, uint64_t *hash, uint64_t from, uint64_t to) {
+    unsigned char chunk[1 << 16];
+    while (from < to) {
+        size_t want = to - from < sizeof(chunk) ? (size_t)(to - from) : sizeof(chunk);
+        ssize_t got = pread(fd, chunk, want, (off_t) from);
+        if (got <= 0) {
+            return 0;
+        }
+        *hash = fnv1a_update(*hash, chunk, got);
+        from += got;
+    }
+    return 1;
+}
+
+// out = path followed by suffix; a name too long for out is an error rather than a truncated file name
+void checkpoint_name(char *out, size_t len, const char *path, const char *suffix) {
+    int n = snprintf(out, len, "%s%s", path, suffix);
+    if (n < 0 || (size_t) n >= len) {
+        printf("Error: File name too long: %s%s\n", path, suffix);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void checkpoint_path(char *path, size_t len, const char *sigma_file) {
+    checkpoint_name(path, len, sigma_file, CHECKPOINT_SUFFIX);
+}
+
+// fsyncs the directory holding path so a rename into it survives a crash
+static void checkpoint_sync_dir(const char *path) {
+    char dir[4096];
+    const char *slash = strrchr(path, '/');
+    int n = snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path) + 1 : 1, slash ? path : ".");
+    if (n < 0 || (size_t) n >= sizeof(dir)) {
+        return;
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// Atomically replaces the checkpoint at path
+void checkpoint_save(const char *path, TAGCHECKPOINT *ckpt) {
+    char tmp_path[4096];
+    checkpoint_name(tmp_path, sizeof(tmp_path), path, ".tmp");
+    memcpy(ckpt->magic, CHECKPOINT_MAGIC, sizeof(ckpt->magic));
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || write(fd, ckpt, sizeof(*ckpt)) != (ssize_t) sizeof(*ckpt) || fsync(fd) != 0) {
+        perror("Error writing checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    if (rename(tmp_path, path) != 0) {
+        perror("Error replacing checkpoint");
+        exit(EXIT_FAILURE);
+    }
+    checkpoint_sync_dir(path);
+}
+
+// Returns 0 when there is no checkpoint at path
+int checkpoint_load(const char *path, TAGCHECKPOINT *ckpt) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t got = read(fd, ckpt, sizeof(*ckpt));
+    close(fd);
+    if (got != (ssize_t) sizeof(*ckpt) || memcmp(ckpt->magic, CHECKPOINT_MAGIC, sizeof(ckpt->magic)) != 0) {
+        printf("Error: %s is not a tagGen checkpoint\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return 1;
+}
+
+// Removes the checkpoint, and any replacement a crash left half written
+void checkpoint_remove(const char *path) {
+    char tmp_path[4096];
+    checkpoint_name(tmp_path, sizeof(tmp_path), path, ".tmp");
+    unlink(tmp_path);
+    if (unlink(path) == 0) {
+        checkpoint_sync_dir(path);
+    }
+}
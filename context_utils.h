@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary audit context: the pairing parameter text plus copies of the small files a command
+// reads (localParams.bin, key files), checked by a trailing hash and mapped with a single mmap.
+// Layout: magic | u32 param length | param text | u32 entry count |
+//         per entry: u32 name length | name | u64 data length | data | u64 FNV-1a hash of all preceding bytes
+
+#define CONTEXT_MAGIC "DCACTX01"
+#define CONTEXT_MAGIC_LEN 8
+#define CONTEXT_MAX_ENTRIES 32
+
+typedef struct {
+    const char *name;
+    size_t name_len;
+    const unsigned char *data;
+    size_t size;
+} CONTEXTENTRY;
+
+typedef struct {
+    const char *param;
+    size_t param_size;
+    int num_entries;
+    CONTEXTENTRY entries[CONTEXT_MAX_ENTRIES];
+} AUDITCONTEXT;
+
+// The loaded context; num_entries stays 0 when the command was started from a text parameter file
+AUDITCONTEXT audit_context;
+
+uint64_t context_hash(const unsigned char *data, size_t len) {
+    return fnv1a_update(FNV_OFFSET, data, len);
+}
+
+// Maps a whole file read-only; the mapping is never written, so it is shared with the page cache
+unsigned char *map_file(const char *filename, size_t *size) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    *size = st.st_size;
+    return (unsigned char *) map;
+}
+
+int is_context(const unsigned char *map, size_t size) {
+    return size >= CONTEXT_MAGIC_LEN && memcmp(map, CONTEXT_MAGIC, CONTEXT_MAGIC_LEN) == 0;
+}
+
+// Bounds-checked cursor over a mapped context
+static const unsigned char *context_take(const unsigned char **pos, const unsigned char *end, size_t len) {
+    if ((size_t)(end - *pos) < len) {
+        printf("Error: Truncated context file\n");
+        exit(EXIT_FAILURE);
+    }
+    const unsigned char *start = *pos;
+    *pos += len;
+    return start;
+}
+
+// Validates a mapped context and indexes its entries in place; the mapping must stay alive
+void load_context(const unsigned char *map, size_t size) {
+    uint64_t stored;
+    uint32_t len32, count;
+    uint64_t len64;
+
+    if (size < CONTEXT_MAGIC_LEN + sizeof(stored)) {
+        printf("Error: Truncated context file\n");
+        exit(EXIT_FAILURE);
+    }
+    const unsigned char *end = map + size - sizeof(stored);
+    memcpy(&stored, end, sizeof(stored));
+    if (context_hash(map, end - map) != stored) {
+        printf("Error: Context file failed its integrity check\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *pos = map + CONTEXT_MAGIC_LEN;
+    memcpy(&len32, context_take(&pos, end, sizeof(len32)), sizeof(len32));
+    audit_context.param_size = len32;
+    audit_context.param = (const char *) context_take(&pos, end, len32);
+
+    memcpy(&count, context_take(&pos, end, sizeof(count)), sizeof(count));
+    if (count > CONTEXT_MAX_ENTRIES) {
+        printf("Error: Context file holds %u entries, at most %d are supported\n", count, CONTEXT_MAX_ENTRIES);
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        CONTEXTENTRY *entry = &audit_context.entries[i];
+        memcpy(&len32, context_take(&pos, end, sizeof(len32)), sizeof(len32));
+        entry->name_len = len32;
+        entry->name = (const char *) context_take(&pos, end, len32);
+        memcpy(&len64, context_take(&pos, end, sizeof(len64)), sizeof(len64));
+        entry->size = len64;
+        entry->data = context_take(&pos, end, len64);
+    }
+    audit_context.num_entries = count;
+}
+
+// Returns an in-memory stream over the context copy of filename, or NULL if the context has none
+FILE *context_open(const char *filename) {
+    size_t len = strlen(filename);
+    for (int i = 0; i < audit_context.num_entries; i++) {
+        CONTEXTENTRY *entry = &audit_context.entries[i];
+        if (entry->name_len == len && memcmp(entry->name, filename, len) == 0) {
+            return fmemopen((void *) entry->data, entry->size, "rb");
+        }
+    }
+    return NULL;
+}
+
+static void context_write(FILE *file, const void *data, size_t len, uint64_t *hash) {
+    if (fwrite(data, 1, len, file) != len) {
+        perror("Error writing context file");
+        exit(EXIT_FAILURE);
+    }
+    *hash = fnv1a_update(*hash, data, len);
+}
+
+// Packs the parameter text and the named files into a context file
+void write_context(const char *filename, const char *param, size_t param_size, char **names, int count) {
+    if (count > CONTEXT_MAX_ENTRIES) {
+        printf("Error: At most %d files fit in a context\n", CONTEXT_MAX_ENTRIES);
+        exit(EXIT_FAILURE);
+    }
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    uint32_t len32 = param_size, count32 = count;
+    context_write(file, CONTEXT_MAGIC, CONTEXT_MAGIC_LEN, &hash);
+    context_write(file, &len32, sizeof(len32), &hash);
+    context_write(file, param, param_size, &hash);
+    context_write(file, &count32, sizeof(count32), &hash);
+
+    for (int i = 0; i < count; i++) {
+        size_t size;
+        unsigned char *data = map_file(names[i], &size);
+        uint64_t len64 = size;
+        len32 = strlen(names[i]);
+        context_write(file, &len32, sizeof(len32), &hash);
+        context_write(file, names[i], len32, &hash);
+        context_write(file, &len64, sizeof(len64), &hash);
+        context_write(file, data, size, &hash);
+        munmap(data, size);
+    }
+
+    if (fwrite(&hash, 1, sizeof(hash), file) != sizeof(hash)) {
+        perror("Error writing context file");
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+}
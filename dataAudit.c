@@ -1,14 +1,19 @@
+#define _GNU_SOURCE     // O_DIRECT for AUDIT_IO_MODE=direct (io_utils.h)
 #include "audit_utils.h"
+#include <pthread.h>
+#include <limits.h>
+#include "audit_lib.h"
 
-void handle_setup(FILE *msk_file, FILE *params_file, SETUPVALS setup_vals) {
-    save_element_to_file(setup_vals.alpha, msk_file);
-    save_element_to_file(setup_vals.params.g, params_file);
-    save_element_to_file(setup_vals.params.g0, params_file);
+void handle_setup(FILE *msk_file, FILE *params_file, SETUPVALS *setup_vals) {
+    save_element_to_file(setup_vals->alpha, msk_file);
+    save_element_to_file(setup_vals->params.g, params_file);
+    save_element_to_file(setup_vals->params.g0, params_file);
+    if (!pairing_is_symmetric(global_params)) {
+        save_element_to_file(setup_vals->params.g1, params_file);
+    }
     fclose(msk_file);
     fclose(params_file);
-    element_clear(setup_vals.alpha);
-    element_clear(setup_vals.params.g);
-    element_clear(setup_vals.params.g0);
+    clear_setup(setup_vals);
 }
 
 void setup_main() {    
@@ -18,11 +23,13 @@ void setup_main() {
     FILE *params_file = open_file("localParams.bin", "wb");
     
     FILE *stat_file = open_file("statistics.txt", "a");
-    float totalTimeTaken = 0.0;
+    double totalTimeTaken = 0.0;
     
-    setup_vals = setup(&totalTimeTaken);
+    int span = trace_begin("setup", "total");
+    setup(&setup_vals, &totalTimeTaken);
         
-    handle_setup(msk_file, params_file, setup_vals);
+    handle_setup(msk_file, params_file, &setup_vals);
+    trace_end(span);
     
     fprintf(stat_file, "Setup Phase Time = %.2f ms\n", totalTimeTaken);
     fclose(stat_file);
@@ -32,39 +39,42 @@ void setup_main() {
     }
 }
 
-void handle_keygen1(FILE *privt_key_file, element_t private_key) {
-    save_element_to_file(private_key, privt_key_file);
-    fclose(privt_key_file);
-    element_clear(private_key);
+void handle_keygen1(KEYWRITER *privt_key_writer, element_t private_key) {
+    save_element_to_file(private_key, privt_key_writer->file);
+    key_writer_close(privt_key_writer);
 }
 
 void partialKeyGen_main(int argc, char **argv) {    
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <MSK file> <ID>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <MSK file> <ID> [keystore]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    element_t alpha, private_key;
-    element_init_Zr(alpha, global_params);
-    element_init_G1(private_key, global_params);
+    // With a keystore the key becomes a record there instead of a file
+    char *keystore = argc > 3 ? argv[3] : NULL;
+    KEYWRITER privt_key_writer;
+    
+    ZR_ELEMENT(alpha);
+    G1_ELEMENT(private_key);
         
     FILE *msk_file = open_file(argv[1], "rb");
     
     char *ID = argv[2];
     
-    FILE *privt_key_file = create_and_open_file(ID, "_partial_private_key.bin", "wb");
+    key_writer_open(&privt_key_writer, keystore, ID, KEY_PARTIAL);
     
     read_element_from_file(alpha, msk_file);
     
     FILE *stat_file = open_file("statistics.txt", "a");
-    float totalTimeTaken = 0.0;
+    double totalTimeTaken = 0.0;
     
+    int span = trace_begin("partialKeyGen", "keygen1");
     keygen1(private_key, alpha, ID, &totalTimeTaken);
+    trace_end(span);
        
-    handle_keygen1(privt_key_file, private_key);
+    handle_keygen1(&privt_key_writer, private_key);
     
     fclose(msk_file);
-    element_clear(alpha);
     
     fprintf(stat_file, "Partial Key Generation Phase Time = %.2f ms\n", totalTimeTaken);
     fclose(stat_file);
@@ -76,63 +86,61 @@ void partialKeyGen_main(int argc, char **argv) {
 
 void fullKeyGen_main(int argc, char **argv) {    
     if (argc < 4) {
-        fprintf(stderr, "Usage: %s <local params file> <partial private key file> <ID>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <local params file> <partial private key file> <ID> [keystore]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    element_t g, g0, par_private_key, Q, P1, P2;
+    char *keystore = argc > 4 ? argv[4] : NULL;
+    KEYWRITER pub_key_writer, full_privt_key_writer;
+    
+    G1_ELEMENT(par_private_key);
+    G1_ELEMENT(Q);
+    GT_ELEMENT(P1);
+    GT_ELEMENT(P2);
+    IBEPARAMS params;
     PUKEYVALS key_vals;
-    element_init_G1(g, global_params);
-    element_init_G1(g0, global_params);
-    element_init_G1(par_private_key, global_params);
-    element_init_G1(Q, global_params);
-    element_init_GT(P1, global_params);
-    element_init_GT(P2, global_params);
     
     FILE *params_file = open_file(argv[1], "rb");
     FILE *par_privt_key_file = open_file(argv[2], "rb");
     char *ID = argv[3];
     
-    FILE *pub_key_file = create_and_open_file(ID, "_public_key.bin", "wb");
-    FILE *full_privt_key_file = create_and_open_file(ID, "_full_private_key.bin", "wb");
+    FILE *pub_key_file = key_writer_open(&pub_key_writer, keystore, ID, KEY_PUBLIC);
+    FILE *full_privt_key_file = key_writer_open(&full_privt_key_writer, keystore, ID, KEY_FULL);
     
-    read_element_from_file(g, params_file);
-    read_element_from_file(g0, params_file);
+    read_params(&params, params_file);
     read_element_from_file(par_private_key, par_privt_key_file);
     
     FILE *stat_file = open_file("statistics.txt", "a");
-    clock_t startTime, endTime;
-    float totalTimeTaken = 0.0;
+    uint64_t startTime, endTime;
+    double totalTimeTaken = 0.0;
     
-    startTime = clock();
+    int span = trace_begin("fullKeyGen", "authenticate");
+    startTime = trace_now_ns();
     H1(Q, ID);
-    element_pairing(P1, par_private_key, g);
-    element_pairing(P2, Q, g0);
+    element_pairing(P1, par_private_key, params.g);
+    element_pairing(P2, Q, params.g0);
+    TRACE_COUNT(CNT_PAIRING, 2);
+    trace_end(span);
     
     if (!element_cmp(P1, P2)) {
-        key_vals = keygen2(g, ID, &totalTimeTaken);
+        keygen2(&key_vals, params.g1, params.g, ID, &totalTimeTaken);
     }
     else {
         printf("\nAuthentication failed in full key generation phase\n");
+        exit(EXIT_FAILURE);
     }
-    endTime = clock();
+    endTime = trace_now_ns();
     
     save_element_to_file(key_vals.beta, full_privt_key_file);
     save_element_to_file(par_private_key, full_privt_key_file);
-    save_element_to_file(key_vals.P, pub_key_file);
+    save_public_key(&key_vals, pub_key_file);
     
     fclose(params_file);
     fclose(par_privt_key_file);
-    fclose(full_privt_key_file);
-    fclose(pub_key_file);
-    element_clear(g);
-    element_clear(g0);
-    element_clear(par_private_key);
-    element_clear(Q);
-    element_clear(P1);
-    element_clear(P2);
-    element_clear(key_vals.beta);
-    element_clear(key_vals.P);
+    key_writer_close(&full_privt_key_writer);
+    key_writer_close(&pub_key_writer);
+    clear_params(&params);
+    clear_keyvals(&key_vals);
     
     fprintf(stat_file, "Full Key Generation Phase Time = %.2f ms\n", totalTimeTaken + measure_time(startTime, endTime));
     fclose(stat_file);
@@ -142,94 +150,246 @@ void fullKeyGen_main(int argc, char **argv) {
     }
 }
 
-void taggen(char *input_file, char *output_file, element_t Dc, element_t Pe, element_t Bc, float *totalTimeTaken, long long *blocks) {
+// Fingerprint of what a tag depends on besides the block itself: the file identifier and the keys
+uint64_t tag_setup_hash(char *input_file, element_t Dc, element_t Pe, element_t Bc) {
+    uint64_t hash = fnv1a_update(FNV_OFFSET, input_file, strlen(input_file) + 1);
+    hash = fnv1a_element(hash, Dc);
+    hash = fnv1a_element(hash, Pe);
+    return fnv1a_element(hash, Bc);
+}
+
+// Reopens the tag file of an interrupted run after checking that the checkpointed input prefix
+// and tags are unchanged; drops any tags written after the checkpoint and seeks the tag file past it.
+// Input offsets count from input_base and tag offsets from tag_base (non-zero for shards).
+FILE *taggen_resume(char *input_file, STORAGE *input, char *output_file, TAGCHECKPOINT *ckpt, uint64_t setup_hash,
+                    uint64_t input_size, uint64_t input_base, uint64_t tag_base, size_t tag_size) {
+    uint64_t tags_end = tag_base + ckpt->done_blocks * tag_size;
+    uint64_t input_end = input_base + ckpt->done_bytes;
+    uint64_t hash = FNV_OFFSET;
+    
+    if (ckpt->setup_hash != setup_hash) {
+        printf("Error: The checkpoint of %s was written for another file name, range or other keys\n", output_file);
+        exit(EXIT_FAILURE);
+    }
+    // A short final block may only be resumed past if it is still the end of the file
+    if (input_end > input_size || (ckpt->done_bytes % BLOCK_SIZE && input_end != input_size) ||
+        !storage_fnv1a_range(input, &hash, input_base, input_end) || hash != ckpt->input_hash) {
+        printf("Error: Bytes %llu to %llu of %s changed since the checkpoint, run tagGen without --resume\n",
+               (unsigned long long) input_base, (unsigned long long) input_end, input_file);
+        exit(EXIT_FAILURE);
+    }
+    
+    FILE *Sigma_write = open_file(output_file, "r+b");
+    hash = FNV_OFFSET;
+    if (!fnv1a_file_range(fileno(Sigma_write), &hash, 0, tags_end) || hash != ckpt->sigma_hash) {
+        printf("Error: The tags in %s do not match its checkpoint, run tagGen without --resume\n", output_file);
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(fileno(Sigma_write), (off_t) tags_end) != 0) {
+        perror("Error truncating tag file");
+        exit(EXIT_FAILURE);
+    }
+    fseeko(Sigma_write, 0, SEEK_END);
+    return Sigma_write;
+}
+
+// Makes the tags of the first done_blocks blocks durable, then records them in the checkpoint
+void taggen_checkpoint(char *ckpt_file, TAGCHECKPOINT *ckpt, ELEMBUF *Sigma_buf, FILE *Sigma_write, long long done_blocks,
+                       uint64_t done_bytes, uint64_t input_hash, uint64_t tag_base, size_t tag_size, double time_ms) {
+    flush_elements(Sigma_buf, Sigma_write);
+    if (fflush(Sigma_write) != 0 || fsync(fileno(Sigma_write)) != 0 ||
+        !fnv1a_file_range(fileno(Sigma_write), &ckpt->sigma_hash, tag_base + ckpt->done_blocks * tag_size,
+                          tag_base + done_blocks * tag_size)) {
+        perror("Error syncing tag file");
+        exit(EXIT_FAILURE);
+    }
+    ckpt->done_blocks = done_blocks;
+    ckpt->done_bytes = done_bytes;
+    ckpt->input_hash = input_hash;
+    ckpt->time_ms = time_ms;
+    checkpoint_save(ckpt_file, ckpt);
+}
+
+// Tags input_file into output_file; with a range, only those blocks are tagged, into a tag shard.
+// Progress is checkpointed to "<output_file>.ckpt" every checkpoint_ms of wall time (never when 0);
+// with resume set, tagging continues from that checkpoint. *blocks is the number of blocks covered.
+void taggen(char *input_file, char *output_file, element_t Dc, element_t Pe, element_t Bc, TAGRANGE *range, int resume,
+            double checkpoint_ms, double *totalTimeTaken, long long *blocks) {
     if(debug) {
         printf("TAG GEN ALGO INVOKED...\n\n");
     }
     
-    FILE *fptr1 = open_file(input_file, "rb");
-    FILE *Sigma_write = open_file(output_file, "wb");
+    STORAGE *input = storage_open(input_file);
        
     long long num_blocks;
-    struct stat st;
-    stat(input_file, &st);
+    off_t input_size = storage_size(input);
     
-    num_blocks = (st.st_size / BLOCK_SIZE) + 1;  // Calculate number of blocks
-    *blocks = num_blocks;
+    num_blocks = (input_size + BLOCK_SIZE - 1) / BLOCK_SIZE;  // Number of blocks actually read below
     
     if(debug) {
         printf("Total number of blocks: %lld\n", num_blocks);
     }
-
-    genint("integer.txt", num_blocks);
-    process_and_hash2(num_blocks, "integer.txt", input_file, "H2TG.bin", Pe);
-    
-    FILE *H2_read = open_file("H2TG.bin", "rb");
-        
-    unsigned char buffer[BLOCK_SIZE];
-    size_t bytes_read;
-    element_t bl1, j1, j2, j3, j4, j5, result;
-
-    element_init_Zr(bl1, global_params);
-    element_init_G1(j1, global_params);
-    element_init_G1(j2, global_params);
-    element_init_G1(j3, global_params);
-    element_init_G1(j4, global_params);
-    element_init_G1(j5, global_params);
-    element_init_G1(result, global_params);
-
-    char file1[50];
     
-    int i = 0;
-    clock_t startTime, endTime;
-    
-    while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, fptr1)) > 0) {
+    // Shards tag blocks first..last behind a TAGSHARDHEADER; a whole-file run is the range 1..num_blocks
+    long long first = 1, last = num_blocks;
+    if (range) {
+        if (range->first > num_blocks) {
+            printf("Error: Block range %lld:%lld starts past the %lld blocks of %s\n", range->first, range->last, num_blocks, input_file);
+            exit(EXIT_FAILURE);
+        }
+        first = range->first;
+        last = range->last < num_blocks ? range->last : num_blocks;
+    }
+    *blocks = last - first + 1;
+    uint64_t input_base = (uint64_t)(first - 1) * BLOCK_SIZE;
+    uint64_t tag_base = range ? sizeof(TAGSHARDHEADER) : 0;
+    
+    char ckpt_file[4096];
+    checkpoint_path(ckpt_file, sizeof(ckpt_file), output_file);
+    size_t tag_size = element_length_in_bytes(Dc);
+    uint64_t setup_hash = tag_setup_hash(input_file, Dc, Pe, Bc);
+    // A checkpoint also belongs to one range
+    uint64_t ckpt_hash = range ? fnv1a_update(fnv1a_update(setup_hash, &first, sizeof(first)), &last, sizeof(last)) : setup_hash;
+    TAGCHECKPOINT ckpt;
+    FILE *Sigma_write;
+    
+    if (resume && checkpoint_load(ckpt_file, &ckpt)) {
+        Sigma_write = taggen_resume(input_file, input, output_file, &ckpt, ckpt_hash, input_size, input_base, tag_base, tag_size);
+        *totalTimeTaken += ckpt.time_ms;
         if(debug) {
-            printf("\nProcessing Block %d...\n", i + 1);
+            printf("Resuming after block %llu\n", first - 1 + (unsigned long long) ckpt.done_blocks);
         }
-
-        read_element_from_file(j2, H2_read);
+    }
+    else {
+        checkpoint_remove(ckpt_file);
+        memset(&ckpt, 0, sizeof(ckpt));
+        ckpt.input_hash = ckpt.sigma_hash = FNV_OFFSET;
+        ckpt.setup_hash = ckpt_hash;
+        Sigma_write = open_file(output_file, "w+b");  // read back when checkpointing
         
-        startTime = clock();
-        element_from_hash(result, file1, strlen(file1));
-        element_from_hash(bl1, buffer, bytes_read);
-        element_pow_zn(j1, Dc, bl1);
-        element_mul(j3, j2, Pe);
-        element_pow_zn(j4, j3, Bc);
-        element_mul(j5, j1, j4);
-        endTime = clock();    
+        if (range) {
+            TAGSHARDHEADER header;
+            memset(&header, 0, sizeof(header));
+            if (strlen(input_file) >= TAGSHARD_NAME_LEN) {
+                printf("Error: File name %s is too long for a tag shard\n", input_file);
+                exit(EXIT_FAILURE);
+            }
+            memcpy(header.magic, TAGSHARD_MAGIC, sizeof(header.magic));
+            header.first_block = first;
+            header.last_block = last;
+            header.num_blocks = num_blocks;
+            header.input_size = input_size;
+            header.setup_hash = setup_hash;
+            header.tag_size = tag_size;
+            strcpy(header.input, input_file);
+            if (fwrite(&header, 1, sizeof(header), Sigma_write) != sizeof(header)) {
+                perror("Error writing tag shard");
+                exit(EXIT_FAILURE);
+            }
+            ckpt.sigma_hash = fnv1a_update(ckpt.sigma_hash, &header, sizeof(header));
+        }
+    }
+    long long done = ckpt.done_blocks;
+    uint64_t done_bytes = ckpt.done_bytes, input_hash = ckpt.input_hash;
 
-        save_element_to_file(j5, Sigma_write);
+    // Blocks are tagged TAG_BATCH at a time so their H2 points and exponentiations share batches
+    TAGSTATE *ts = malloc(sizeof(TAGSTATE));
+    tagstate_init(ts, input_file, Dc, Pe, Bc);
+    ELEMBUF Sigma_buf;
+    elembuf_init(&Sigma_buf, tag_size * ELEM_BATCH);
+    
+    long long i = done;
+    int n;
+    off_t input_pos = (off_t)(input_base + done_bytes);
+    uint64_t startTime, endTime, lastCheckpoint = trace_now_ns();
+    TRACEHIST *block_hist = trace_histogram("tagGen.block");
+    int span = trace_begin("tagGen", "blocks");
+    
+    do {
+        for (n = 0; n < TAG_BATCH && i + n < *blocks && (ts->len[n] = storage_read_at(input, ts->block[n], BLOCK_SIZE, input_pos)) > 0; n++) {
+            if(debug) {
+                printf("\nProcessing Block %lld...\n", first + i + n);
+            }
+            TRACE_COUNT(CNT_BYTES_READ, ts->len[n]);
+            input_hash = fnv1a_update(input_hash, ts->block[n], ts->len[n]);
+            done_bytes += ts->len[n];
+            input_pos += ts->len[n];
+        }
+        if (n == 0) {
+            break;
+        }
         
+        startTime = trace_now_ns();
+        tag_blocks(ts, first + i, n);
+        endTime = trace_now_ns();    
+
+        for (int k = 0; k < n; k++) {
+            append_element_to_file(&Sigma_buf, ts->tag[k], Sigma_write);
+            trace_hist_add(block_hist, (endTime - startTime) / n);
+        }
         *totalTimeTaken += measure_time(startTime, endTime);
 
-        i++;
+        i += n;
+        if (checkpoint_ms > 0 && measure_time(lastCheckpoint, endTime) >= checkpoint_ms) {
+            taggen_checkpoint(ckpt_file, &ckpt, &Sigma_buf, Sigma_write, i, done_bytes, input_hash, tag_base, tag_size,
+                              *totalTimeTaken);
+            lastCheckpoint = trace_now_ns();
+        }
+    } while (n == TAG_BATCH);
+    flush_elements(&Sigma_buf, Sigma_write);
+    trace_end(span);
+    if (i != *blocks) {
+        printf("Error: Could not read block %lld of %s\n", first + i, input_file);
+        exit(EXIT_FAILURE);
     }
 
-    fclose(fptr1);
-    fclose(H2_read);
-    fclose(Sigma_write);
-    
-    // Clean up elements
-    element_clear(result);
-    element_clear(bl1);
-    element_clear(j1);
-    element_clear(j2);
-    element_clear(j3);
-    element_clear(j4);
-    element_clear(j5);
+    tagstate_clear(ts);
+    free(ts);
+    elembuf_free(&Sigma_buf);
+    storage_close(input);
+    if (fclose(Sigma_write) != 0) {
+        perror("Error saving tag file");
+        exit(EXIT_FAILURE);
+    }
+    checkpoint_remove(ckpt_file);
 }
 
 void tagGen_main(int argc, char **argv) {
+    // --resume, --checkpoint <seconds> and --range <start:end> may appear anywhere; the remaining
+    // arguments stay positional
+    int resume = 0;
+    double checkpoint_ms = CHECKPOINT_INTERVAL_MS;
+    TAGRANGE range, *shard = NULL;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--resume") == 0) {
+            resume = 1;
+        }
+        else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            range = parse_tag_range(argv[++i]);
+            shard = &range;
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint_ms = atof(argv[++i]) * 1000.0;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    
     if (argc < 4) {
-        fprintf(stderr, "Usage: %s <csp full private key file> <auditee public key file> <input file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <csp full private key file> <auditee public key file> <input file> [metadata file] [file info file] [--resume] [--checkpoint <seconds>] [--range <start:end>]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    element_t Dc, Bc, Pe;
-    element_init_G1(Dc, global_params);
-    element_init_Zr(Bc, global_params);
-    element_init_G1(Pe, global_params);
+    // Optional output names let several files be tagged side by side
+    char *sigma_file = argc > 4 ? argv[4] : "sigma.bin";
+    char *info_file = argc > 5 ? argv[5] : "file_info.txt";
+    
+    G1_ELEMENT(Dc);
+    ZR_ELEMENT(Bc);
+    G1_ELEMENT(Pe);
 
     FILE *privt_key_csp_file = open_file(argv[1], "rb");
     FILE *pub_key_auditee_file = open_file(argv[2], "rb");
@@ -241,25 +401,145 @@ void tagGen_main(int argc, char **argv) {
     long long num_blocks;
     
     FILE *stat_file = open_file("statistics.txt", "a");
-    float totalTimeTaken = 0.0;
+    double totalTimeTaken = 0.0;
 
-    taggen(argv[3], "sigma.bin", Dc, Pe, Bc, &totalTimeTaken, &num_blocks);
+    taggen(argv[3], sigma_file, Dc, Pe, Bc, shard, resume, checkpoint_ms, &totalTimeTaken, &num_blocks);
     
-    write_to_file("file_info.txt", argv[3], num_blocks);
+    // A shard's file info is written by tagMerge once all shards are in
+    if (shard == NULL) {
+        write_to_file(info_file, argv[3], num_blocks);
+    }
     
     // Clean up
     fclose(privt_key_csp_file);
     fclose(pub_key_auditee_file);
-    element_clear(Dc);
-    element_clear(Bc);
-    element_clear(Pe);
 
     fprintf(stat_file, "Tag(one block) Generation for  Time(avg) = %.2f ms\n", totalTimeTaken/num_blocks);
+    io_report(stat_file);
+    storage_report(stat_file);
     fclose(stat_file);
 
     if(debug) {
-    printf("Tag Generation Executed Successfully. \nSave metadata on file name %s\n\n", "sigma.bin");
+    printf("Tag Generation Executed Successfully. \nSave metadata on file name %s\n\n", sigma_file);
+    }
+}
+
+typedef struct {
+    TAGSHARDHEADER header;
+    char *name;
+} TAGSHARD;
+
+int compare_shards(const void *a, const void *b) {
+    const TAGSHARDHEADER *x = &((const TAGSHARD *) a)->header, *y = &((const TAGSHARD *) b)->header;
+    return x->first_block < y->first_block ? -1 : x->first_block > y->first_block;
+}
+
+// Stitches tag shards of one input into its tag file and file info, copying the tags unchanged.
+// The shards must come from the same input and keys and cover every block exactly once.
+void tagMerge_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: tagMerge <metadata file> <file info file> <tag shard> [<tag shard> ...]\n");
+        exit(EXIT_FAILURE);
+    }
+    char *sigma_file = argv[0];
+    char *info_file = argv[1];
+    int count = argc - 2;
+    
+    TAGSHARD *shards = (TAGSHARD *) malloc(count * sizeof(TAGSHARD));
+    for (int i = 0; i < count; i++) {
+        shards[i].name = argv[2 + i];
+        read_shard_header(shards[i].name, &shards[i].header);
+    }
+    qsort(shards, count, sizeof(TAGSHARD), compare_shards);
+    TAGSHARDHEADER *first = &shards[0].header;
+    
+    uint64_t next = 1;
+    for (int i = 0; i < count; i++) {
+        TAGSHARDHEADER *h = &shards[i].header;
+        if (h->setup_hash != first->setup_hash || h->num_blocks != first->num_blocks ||
+            h->input_size != first->input_size || h->tag_size != first->tag_size ||
+            strcmp(h->input, first->input) != 0) {
+            printf("Error: Tag shard %s belongs to another file or other keys than %s\n", shards[i].name, shards[0].name);
+            exit(EXIT_FAILURE);
+        }
+        check_block_span(&next, h->first_block, h->last_block, shards[i].name);
+    }
+    check_block_coverage(next, first->num_blocks, first->input);
+    
+    // Written under a temporary name so a failed merge never leaves a truncated tag file behind
+    uint64_t startTime = trace_now_ns();
+    char tmp_file[4096];
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", sigma_file);
+    FILE *out = open_file(tmp_file, "wb");
+    for (int i = 0; i < count; i++) {
+        copy_shard_tags(shards[i].name, out);
+    }
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0 || fclose(out) != 0 || rename(tmp_file, sigma_file) != 0) {
+        perror("Error saving tag file");
+        exit(EXIT_FAILURE);
+    }
+    write_to_file(info_file, first->input, first->num_blocks);
+    uint64_t endTime = trace_now_ns();
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    fprintf(stat_file, "Tag Merge (%d shards, %llu blocks) Time = %.2f ms\n", count,
+            (unsigned long long) first->num_blocks, measure_time(startTime, endTime));
+    fclose(stat_file);
+    
+    if(debug) {
+        printf("Tag Merge Executed Successfully. \nSave metadata on file name %s\n\n", sigma_file);
+    }
+    free(shards);
+}
+
+// Fingerprint of what the offline verification state depends on besides the challenge
+uint64_t preverify_hash(char *fileName, long long num_blocks, element_t Pe, element_t Pc) {
+    uint64_t hash = fnv1a_update(FNV_OFFSET, fileName, strlen(fileName) + 1);
+    hash = fnv1a_update(hash, &num_blocks, sizeof(num_blocks));
+    hash = fnv1a_element(hash, Pe);
+    return fnv1a_element(hash, Pc);
+}
+
+// Writes the offline verification state of a challenge, to be passed to verifyProof later
+void save_preverify(char *filename, CHALLENGE *chal, char *fileName, long long num_blocks, element_t Pe, element_t Pc,
+                    double *totalTimeTaken) {
+    GT_ELEMENT(b3);
+    if (!verify_offline(b3, chal, fileName, num_blocks, Pe, Pc, totalTimeTaken)) {
+        perror("Failed to allocate memory for numbers array");
+        exit(EXIT_FAILURE);
+    }
+    
+    PREVERIFYHEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PREVERIFY_MAGIC, sizeof(header.magic));
+    header.chal_hash = challenge_hash(chal);
+    header.setup_hash = preverify_hash(fileName, num_blocks, Pe, Pc);
+    
+    FILE *pre_write = open_file(filename, "wb");
+    if (fwrite(&header, 1, sizeof(header), pre_write) != sizeof(header)) {
+        perror("Error writing pre-verification file");
+        exit(EXIT_FAILURE);
+    }
+    save_element_to_file(b3, pre_write);
+    fclose(pre_write);
+}
+
+// Reads the offline state saved for exactly this challenge, file and key pair
+void load_preverify(element_t b3, char *filename, CHALLENGE *chal, char *fileName, long long num_blocks, element_t Pe,
+                    element_t Pc) {
+    PREVERIFYHEADER header;
+    FILE *pre_read = open_file(filename, "rb");
+    if (fread(&header, 1, sizeof(header), pre_read) != sizeof(header) ||
+        memcmp(header.magic, PREVERIFY_MAGIC, sizeof(header.magic)) != 0) {
+        printf("Error: %s is not a pre-verification file\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    if (header.chal_hash != challenge_hash(chal) || header.setup_hash != preverify_hash(fileName, num_blocks, Pe, Pc)) {
+        printf("Error: %s was prepared for another challenge, file or key pair\n", filename);
+        exit(EXIT_FAILURE);
     }
+    read_element_from_file(b3, pre_read);
+    fclose(pre_read);
 }
 
 void seed_pbc_random(FILE *chal_file) {
@@ -276,7 +556,7 @@ void seed_pbc_random(FILE *chal_file) {
 
     // Write the seed to chal_file
     if (fwrite(seed, 1, sizeof(seed), chal_file) != sizeof(seed)) {
-        printf("Error: Could not write seed to chal_file.txt\n");
+        printf("Error: Could not write seed to the challenge file\n");
         exit(EXIT_FAILURE);
     }
 
@@ -284,158 +564,235 @@ void seed_pbc_random(FILE *chal_file) {
     fprintf(chal_file, "\n");
     
     if(debug) {
-    printf("\nSeed successfully written to chal_file.txt.\n\n");
+    printf("\nSeed successfully written to the challenge file.\n\n");
     }
 }
 
+// chalGen <ratio> challenges that fraction of every file. chalGen <detection probability> <corruption rate>
+// [min blocks] [max blocks] instead records the smallest block count that catches a file with that
+// fraction of corrupted blocks with the requested probability, independent of the file size.
+// --out <challenge file> replaces chal_file.txt, so challenges can be queued ahead of time, and
+// --prepare <csp public key> <auditee public key> <file info file> <pre-verification file> also
+// does the proof-independent half of verifying the answer now (see verify_offline()).
 void chalGen_main(int argc, char **argv) {
-    // Open chal_file.txt for writing both the seed and number
-    FILE *chal_file = open_file("chal_file.txt", "wb");
-    
-    // Write random seed to chal_file.txt
-    seed_pbc_random(chal_file);
+    char *chal_name = "chal_file.txt";
+    char **prepare = NULL;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            chal_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--prepare") == 0 && i + 4 < argc) {
+            prepare = argv + i + 1;
+            i += 4;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
     
     // Checks whether at least 1 command line argument is given
     if(argc < 2){
         printf("Error: Please Enter Correct Execution Command %d !!!\n", argc);
-        fclose(chal_file);
         exit(1);
     }
     
-    // Convert the argument to a float and write it to chal_file.txt
-    float number = atof(argv[1]);
-    fprintf(chal_file, "%f\n", number);
+    // Open the challenge file for writing both the seed and number
+    FILE *chal_file = open_file(chal_name, "wb");
+    
+    // Write random seed to the challenge file
+    seed_pbc_random(chal_file);
+    
+    if (argc > 2) {
+        double probability = atof(argv[1]);
+        double rate = atof(argv[2]);
+        long long min_blocks = argc > 3 ? atoll(argv[3]) : CHAL_MIN_BLOCKS;
+        long long max_blocks = argc > 4 ? atoll(argv[4]) : CHAL_MAX_BLOCKS;
+        
+        if (probability <= 0 || probability >= 1 || rate <= 0 || rate > 1 || min_blocks < 1 || max_blocks < min_blocks) {
+            printf("Error: Need 0 < probability < 1, 0 < corruption rate <= 1 and 1 <= min blocks <= max blocks\n");
+            fclose(chal_file);
+            exit(EXIT_FAILURE);
+        }
+        
+        // Recorded without a decimal point, which read_challenge_file takes as a block count
+        long long count = detection_challenge_count(probability, rate, min_blocks, max_blocks);
+        fprintf(chal_file, "%lld\n", count);
+        
+        if(debug) {
+        printf("Challenging %lld blocks per file.\n", count);
+        }
+    }
+    else {
+        // Convert the argument to a float and write it to the challenge file
+        float number = atof(argv[1]);
+        fprintf(chal_file, "%f\n", number);
+    }
      
     fclose(chal_file);
     
+    if (prepare) {
+        G2_ELEMENT(Pc);
+        G1_ELEMENT(Pe);
+        FILE *pub_key_csp_file = open_file(prepare[0], "rb");
+        FILE *pub_key_auditee_file = open_file(prepare[1], "rb");
+        read_public_key_G2(Pc, pub_key_csp_file);
+        read_element_from_file(Pe, pub_key_auditee_file);
+        fclose(pub_key_csp_file);
+        fclose(pub_key_auditee_file);
+        
+        CHALLENGE chal;
+        chal_file = open_file(chal_name, "rb");
+        read_challenge_file(chal_file, &chal);
+        fclose(chal_file);
+        
+        char *fileName = NULL;
+        long long num_blocks;
+        read_from_file(prepare[2], &fileName, &num_blocks);
+        
+        double totalTimeTaken = 0.0;
+        save_preverify(prepare[3], &chal, fileName, num_blocks, Pe, Pc, &totalTimeTaken);
+        free(fileName);
+        
+        FILE *stat_file = open_file("statistics.txt", "a");
+        fprintf(stat_file, "Verify Proof Offline Phase Time = %.2f ms\n", totalTimeTaken);
+        fclose(stat_file);
+    }
+    
     if(debug) {
     printf("Challenge Generation Executed Successfully.");
     }
 }
 
+// Announces the reads of the given blocks (ascending) and their tags, so remote storage fetches them at once
+void prefetch_blocks(STORAGE *data_file, STORAGE *Sigma_read, off_t sig_base, size_t sig_size, int *indices, int n) {
+    off_t *offsets = malloc((n > 0 ? n : 1) * sizeof(off_t));
+    for (int p = 0; p < n; p++) {
+        offsets[p] = (off_t)(indices[p] - 1) * BLOCK_SIZE;
+    }
+    storage_prefetch(data_file, offsets, n, BLOCK_SIZE);
+    for (int p = 0; p < n; p++) {
+        offsets[p] = sig_base + (off_t)(indices[p] - 1) * sig_size;
+    }
+    storage_prefetch(Sigma_read, offsets, n, sig_size);
+    free(offsets);
+}
+
+// Block reader over a data file and its tag file, whose tags start sig_base bytes in
+typedef struct {
+    STORAGE *data_file;
+    STORAGE *Sigma_read;
+    off_t sig_base;
+} STOREDBLOCKS;
+
+size_t read_stored_block(void *arg, long long index, unsigned char *data, unsigned char *tag, size_t tag_len) {
+    STOREDBLOCKS *stored = arg;
+    size_t bytes_read = storage_read_at(stored->data_file, data, BLOCK_SIZE, (off_t)(index - 1) * BLOCK_SIZE);
+    if (bytes_read == 0 ||
+        storage_read_at(stored->Sigma_read, tag, tag_len, stored->sig_base + (off_t)(index - 1) * tag_len) != tag_len) {
+        return 0;
+    }
+    TRACE_COUNT(CNT_BYTES_READ, bytes_read + tag_len);
+    TRACE_COUNT(CNT_IO_CALLS, 2);
+    return bytes_read;
+}
+
+// Folds the challenge positions in range into the running sums of a proof (see fold_blocks()).
+// Tags start sig_base bytes into Sigma_read (past the header of a tag shard).
+void accumulate_range(STORAGE *data_file, STORAGE *Sigma_read, off_t sig_base, int *indices, LOCATERANGE range,
+                      unsigned char *seed, int v_offset, element_t Be, element_t add_mu, element_t pro_sigu,
+                      element_t add_Zr_points, double *totalTimeTaken) {
+    STOREDBLOCKS stored = { data_file, Sigma_read, sig_base };
+    prefetch_blocks(data_file, Sigma_read, sig_base, pairing_length_in_bytes_G1(global_params), indices + range.lo,
+                    range.hi - range.lo);
+    int failed = fold_blocks(read_stored_block, &stored, indices + range.lo, range.hi - range.lo, seed, v_offset, Be,
+                             add_mu, pro_sigu, add_Zr_points, totalTimeTaken);
+    if (failed) {
+        printf("Error: Could not read block %d or its tag\n", failed);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Aggregates (mu, sigu) over the challenge positions in range, exactly as proofgen does for the whole set
+void prove_range(STORAGE *data_file, STORAGE *Sigma_read, int *indices, LOCATERANGE range, unsigned char *seed,
+                 element_t Be, element_t Pc, element_t add_mu, element_t sigu, double *totalTimeTaken) {
+    ZR_ELEMENT(add_Zr_points);
+    G1_ELEMENT(pro_sigu);
+    
+    element_set0(add_Zr_points);
+    element_set0(add_mu);
+    element_set1(pro_sigu);
+    
+    accumulate_range(data_file, Sigma_read, 0, indices, range, seed, 0, Be, add_mu, pro_sigu, add_Zr_points, totalTimeTaken);
+    finalize_proof(sigu, pro_sigu, add_Zr_points, Be, Pc, totalTimeTaken);
+}
+
+// Writes a proof (mu, sigu) to file_name in the layout verifyProof reads
+void save_proof(char *file_name, element_t add_mu, element_t sigu) {
+    FILE *POP_write = open_file(file_name, "wb");
+    save_element_to_file(add_mu, POP_write);
+    save_element_to_file(sigu, POP_write);
+    fclose(POP_write);
+}
+
 void proofgen(char *arg1, char *arg2, char *arg3, char *arg4, element_t Be, element_t Pc) {
     if(debug) {
         printf("PROOF GEN ALGO INVOKED...\n\n");
     }
-	
-    unsigned char buffer[BLOCK_SIZE];
-    size_t bytes_read;
-    int i = 0;
     	
-    element_t bl1, Zr_point1, mu, add_mu, add_Zr_points, sigu, pro_sigu, j1, j2, j3, j4, j5, sig;
-
-    element_init_Zr(bl1, global_params);
-    element_init_Zr(Zr_point1, global_params);
-    element_init_Zr(add_Zr_points, global_params);
-    element_init_Zr(mu, global_params);
-    element_init_Zr(add_mu, global_params);
-    element_init_Zr(j1, global_params);
-    element_init_Zr(j2, global_params);
-
-    element_init_G1(sigu, global_params);
-    element_init_G1(pro_sigu, global_params);
-    element_init_G1(sig, global_params);
-    element_init_G1(j3, global_params);
-    element_init_G1(j4, global_params);
-    element_init_G1(j5, global_params);
+    ZR_ELEMENT(add_Zr_points);
+    ZR_ELEMENT(add_mu);
+    G1_ELEMENT(sigu);
+    G1_ELEMENT(pro_sigu);
     	
-    FILE *fptr1 = open_file(arg1, "rb");   	
-    FILE *Sigma_read = open_file(arg2, "rb");
-    FILE *POP_write = open_file(arg3, "wb");
+    STORAGE *fptr1 = storage_open(arg1);
+    STORAGE *Sigma_read = storage_open(arg2);
     FILE *chalFile = open_file(arg4, "rb");
+    
+    // The block count comes from the file size, so only challenged blocks and tags are ever read
+    int span = trace_begin("proofGen", "challenge");
+    int i = (storage_size(fptr1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
     	
-    while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, fptr1)) > 0) {
-     	i++;
-    }
-    fclose(fptr1);
-    	
-    unsigned char seed[SEED_SIZE];
-    float num;
+    CHALLENGE chal;
     
-    if (!read_challenge_file(chalFile, seed, &num)) {
+    if (!read_challenge_file(chalFile, &chal)) {
         fclose(chalFile);
         exit(EXIT_FAILURE);
     }
     	
     fclose(chalFile);
     	
-    int num_blocks = i*num;
+    int num_blocks = challenge_size(&chal, i);
     	
-    process_numbers(seed, num_blocks, i, "Challenge_index_PG.txt");
+    int *indices = challenge_indices(chal.seed, num_blocks, i);
+    trace_end(span);
     	    	
     element_set0(add_Zr_points);
     element_set0(add_mu);
     element_set1(pro_sigu);
-	
-    FILE *file = open_file("Challenge_index_PG.txt", "r");
-    	
-    int next_int = read_next_integer(file);
-    	
-    i = 0;
-    	
-    fptr1 = open_file(arg1, "rb");
     	
     FILE *stat_file = open_file("statistics.txt", "a");
-    clock_t startTime, endTime;
-    float totalTimeTaken = 0.0;
-	
-    while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, fptr1)) > 0) {
-        i++;
-     	read_element_from_file(sig, Sigma_read);
-    	 	
-     	if(i == next_int) {
-    	 	
-            startTime = clock();
-    	    element_from_hash(bl1, buffer, bytes_read);
-            generate_deterministic_v_with_seed(Zr_point1, seed, i);
-            element_mul(mu, bl1, Zr_point1);
-            element_add(add_mu, add_mu, mu);
-            element_pow_zn(j5, sig, Zr_point1);
-            element_mul(pro_sigu, pro_sigu, j5);
-            element_mul(j1, Be, Zr_point1);
-            element_add(add_Zr_points, add_Zr_points, j1);
-            endTime = clock();
-        		
-            totalTimeTaken = (totalTimeTaken + measure_time(startTime, endTime));
-        		
-            // Now read the next integer from the file for the next iteration
-       	    next_int = read_next_integer(file);
-        }
-    }
-        
-    fclose(fptr1);
-    fclose(file);
+    double totalTimeTaken = 0.0;
+    span = trace_begin("proofGen", "blocks");
+    accumulate_range(fptr1, Sigma_read, 0, indices, (LOCATERANGE){0, num_blocks}, chal.seed, 0,
+                     Be, add_mu, pro_sigu, add_Zr_points, &totalTimeTaken);
+    trace_end(span);
         
-    startTime = clock();
-    element_sub(j2, add_Zr_points, Be);
-    element_pow_zn(j3, Pc, j2);
-    element_invert(j4, j3);
-    element_mul(sigu, pro_sigu, j4);
-    endTime = clock();
-    	
-    totalTimeTaken = (totalTimeTaken + measure_time(startTime, endTime));
-    	
-    save_element_to_file(add_mu, POP_write);
-    save_element_to_file(sigu, POP_write);
+    storage_close(fptr1);
+    free(indices);
         
-    fclose(Sigma_read);
-    fclose(POP_write);
+    span = trace_begin("proofGen", "finalize");
+    finalize_proof(sigu, pro_sigu, add_Zr_points, Be, Pc, &totalTimeTaken);
+    	
+    save_proof(arg3, add_mu, sigu);
         
-    element_clear(bl1);
-    element_clear(Zr_point1);
-    element_clear(mu);
-    element_clear(add_mu);
-    element_clear(add_Zr_points);
-    element_clear(sigu);
-    element_clear(pro_sigu);
-    element_clear(j1);
-    element_clear(j2);
-    element_clear(j3);
-    element_clear(j4);
-    element_clear(j5);
-    element_clear(sig);
+    storage_close(Sigma_read);
+    trace_end(span);
     
     fprintf(stat_file, "Proof Generation Phase Time = %.2f ms\n", totalTimeTaken);
+    io_report(stat_file);
+    storage_report(stat_file);
     fclose(stat_file);
 }
 
@@ -445,12 +802,8 @@ void proofGen_main(int argc, char **argv) {
         exit(EXIT_FAILURE);
     }
 	
-    element_t Be, Pc, mu, sigu, Pe;
-    element_init_Zr(Be, global_params);
-    element_init_G1(Pc, global_params);
-    element_init_G1(Pe, global_params);
-    element_init_Zr(mu, global_params);
-    element_init_G1(sigu, global_params);
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
 	
     FILE *privt_key_auditee_file = open_file(argv[1], "rb");
     FILE *pub_key_csp_file = open_file(argv[2], "rb");
@@ -462,154 +815,456 @@ void proofGen_main(int argc, char **argv) {
 	
     fclose(privt_key_auditee_file);
     fclose(pub_key_csp_file);
-    element_clear(Be);
-    element_clear(Pc);
     	
     if(debug) {
         printf("Proof Generation Executed Successfully. \nComplete proof is save on file name %s\n\n", "POP.bin");
     }
 }
 
-int verifyproof(char **argv, element_t b1, element_t b4, float *totalTimeTaken) {
-    if(debug) {
-    printf("VERIFY PROOF ALGO INVOKED...\n\n");
-    }
-    
-    element_t Qc, Pc, Pe, mu, sigu, x1, b2, b3, g, g0, wi, Zr_point, j6, pro_wi, j7;
-    element_init_G1(Qc, global_params);
-    element_init_G1(Pc, global_params);
-    element_init_G1(Pe, global_params);
-    element_init_G1(sigu, global_params);
-    element_init_G1(x1, global_params);
-    element_init_G1(g, global_params);
-    element_init_G1(g0, global_params);
-    element_init_G1(wi, global_params);
-    element_init_G1(j6, global_params);
-    element_init_G1(j7, global_params);
-    element_init_G1(pro_wi, global_params);
-    
-    element_init_Zr(mu, global_params);
-    element_init_Zr(Zr_point, global_params);
-    
-    element_init_GT(b2, global_params);
-    element_init_GT(b3, global_params);
+// One of the challenges answered by proofGenMulti, with its running sums
+typedef struct {
+    CHALLENGE chal;
+    int *indices;
+    int count;
+    int pos;        // next position in indices
+    element_t add_mu;
+    element_t pro_sigu;
+    element_t add_Zr_points;
+    G1PRODUCT sig_prod;
+} MULTIPROOF;
 
-    FILE *pub_key_csp_file = open_file(argv[1], "rb");
-    FILE *pub_key_auditee_file = open_file(argv[2], "rb");
-    FILE *POP_read = open_file(argv[3], "rb");
-    FILE *params_file = open_file(argv[5], "rb");
-    FILE *chalFile = open_file(argv[6], "rb");
-    
+// Answers several challenges on the same file in one pass: the sorted index lists are merged, and
+// each block and tag in their union is read and hashed once, then folded into every proof that
+// challenges it. Writes POP_1.bin .. POP_N.bin, one per challenge file in argument order.
+void proofGenMulti_main(int argc, char **argv) {
+    if (argc < 6) {
+        fprintf(stderr, "Usage: proofGenMulti <param file> <auditee full private key file> <csp public key file> <input file> <metadata file> <challenge file>...\n");
+        exit(EXIT_FAILURE);
+    }
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
+    FILE *privt_key_auditee_file = open_file(argv[1], "rb");
+    FILE *pub_key_csp_file = open_file(argv[2], "rb");
+    read_element_from_file(Be, privt_key_auditee_file);
     read_element_from_file(Pc, pub_key_csp_file);
-    read_element_from_file(Pe, pub_key_auditee_file);
-    read_element_from_file(mu, POP_read);
-    read_element_from_file(sigu, POP_read);
-    read_element_from_file(g, params_file);
-    read_element_from_file(g0, params_file);
-    
-    H1(Qc, argv[4]);
-
-    int i = 0;
-    
-    unsigned char seed[SEED_SIZE];
-    float num;
-    
-    read_challenge_file(chalFile, seed, &num);
-    
-    char *fileName = NULL;
-    long long num_blocks;
-    read_from_file(argv[7], &fileName, &num_blocks);
-    int challenge_blocks = (int)(num_blocks * num);
+    fclose(privt_key_auditee_file);
+    fclose(pub_key_csp_file);
     
-    element_set1(pro_wi);
+    STORAGE *data_file = storage_open(argv[3]);
+    STORAGE *Sigma_read = storage_open(argv[4]);
+    int block_count = (storage_size(data_file) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    
+    int count = argc - 5;
+    int challenged = 0;
+    MULTIPROOF *proofs = (MULTIPROOF *) calloc(count, sizeof(MULTIPROOF));
+    int span = trace_begin("proofGenMulti", "challenge");
+    for (int k = 0; k < count; k++) {
+        MULTIPROOF *proof = &proofs[k];
+        FILE *chalFile = open_file(argv[5 + k], "rb");
+        if (!read_challenge_file(chalFile, &proof->chal)) {
+            fclose(chalFile);
+            exit(EXIT_FAILURE);
+        }
+        fclose(chalFile);
+        proof->count = challenge_size(&proof->chal, block_count);
+        proof->indices = challenge_indices(proof->chal.seed, proof->count, block_count);
+        challenged += proof->count;
+        
+        element_init_Zr(proof->add_mu, global_params);
+        element_init_G1(proof->pro_sigu, global_params);
+        element_init_Zr(proof->add_Zr_points, global_params);
+        element_set0(proof->add_mu);
+        element_set1(proof->pro_sigu);
+        element_set0(proof->add_Zr_points);
+        g1_product_init(&proof->sig_prod);
+    }
+    trace_end(span);
     
-    process_numbers(seed, challenge_blocks, num_blocks, "Challenge_index_VP.txt");
+    STOREDBLOCKS stored = { data_file, Sigma_read, 0 };
+    unsigned char buffer[BLOCK_SIZE];
+    ZR_ELEMENT(bl1);
+    G1_ELEMENT(sig);
+    size_t sig_size = element_length_in_bytes(sig);
+    unsigned char *sig_bytes = malloc(sig_size);
+    uint64_t startTime, endTime;
+    double totalTimeTaken = 0.0;
+    int distinct = 0;
+    
+    // Only the union of the challenges is fetched
+    int *all = malloc((challenged > 0 ? challenged : 1) * sizeof(int));
+    int all_count = 0;
+    for (int k = 0; k < count; k++) {
+        memcpy(all + all_count, proofs[k].indices, proofs[k].count * sizeof(int));
+        all_count += proofs[k].count;
+    }
+    qsort(all, all_count, sizeof(int), compare);
+    int unique = 0;
+    for (int p = 0; p < all_count; p++) {
+        if (unique == 0 || all[p] != all[unique - 1]) {
+            all[unique++] = all[p];
+        }
+    }
+    prefetch_blocks(data_file, Sigma_read, 0, sig_size, all, unique);
+    free(all);
+    TRACEHIST *block_hist = trace_histogram("proofGenMulti.block");
+    
+    span = trace_begin("proofGenMulti", "blocks");
+    for (;;) {
+        // Smallest index not yet folded into every proof that challenges it
+        int index = INT_MAX;
+        for (int k = 0; k < count; k++) {
+            if (proofs[k].pos < proofs[k].count && proofs[k].indices[proofs[k].pos] < index) {
+                index = proofs[k].indices[proofs[k].pos];
+            }
+        }
+        if (index == INT_MAX) {
+            break;
+        }
+        
+        size_t bytes_read = read_block(read_stored_block, &stored, index, buffer, sig_bytes, sig_size, sig);
+        if (bytes_read == 0) {
+            printf("Error: Could not read block %d or its tag\n", index);
+            exit(EXIT_FAILURE);
+        }
+        distinct++;
+        
+        // Hashed once, then folded into every proof that challenges it
+        startTime = trace_now_ns();
+        element_from_hash(bl1, buffer, bytes_read);
+        TRACE_COUNT(CNT_HASH_ZR, 1);
+        for (int k = 0; k < count; k++) {
+            MULTIPROOF *proof = &proofs[k];
+            if (proof->pos < proof->count && proof->indices[proof->pos] == index) {
+                fold_block(bl1, sig, proof->chal.seed, index, Be, proof->add_mu, &proof->sig_prod, proof->pro_sigu,
+                           proof->add_Zr_points);
+                proof->pos++;
+            }
+        }
+        endTime = trace_now_ns();
+        totalTimeTaken = (totalTimeTaken + measure_time(startTime, endTime));
+        trace_hist_add(block_hist, endTime - startTime);
+    }
+    trace_end(span);
+    free(sig_bytes);
+    storage_close(data_file);
+    storage_close(Sigma_read);
+    
+    span = trace_begin("proofGenMulti", "finalize");
+    G1_ELEMENT(sigu);
+    for (int k = 0; k < count; k++) {
+        MULTIPROOF *proof = &proofs[k];
+        startTime = trace_now_ns();
+        g1_product_flush(&proof->sig_prod, proof->pro_sigu);
+        endTime = trace_now_ns();
+        totalTimeTaken = (totalTimeTaken + measure_time(startTime, endTime));
+        finalize_proof(sigu, proof->pro_sigu, proof->add_Zr_points, Be, Pc, &totalTimeTaken);
+        
+        char pop_name[64];
+        snprintf(pop_name, sizeof(pop_name), "POP_%d.bin", k + 1);
+        save_proof(pop_name, proof->add_mu, sigu);
+        
+        if(debug) {
+        printf("Proof for %s saved to %s\n", argv[5 + k], pop_name);
+        }
+        
+        g1_product_clear(&proof->sig_prod);
+        element_clear(proof->add_mu);
+        element_clear(proof->pro_sigu);
+        element_clear(proof->add_Zr_points);
+        free(proof->indices);
+    }
+    trace_end(span);
+    free(proofs);
     
-    process_and_hash2(challenge_blocks, "Challenge_index_VP.txt", fileName, "H2PV.bin", Pe);
+    FILE *stat_file = open_file("statistics.txt", "a");
+    fprintf(stat_file, "Multi-challenge Proof Generation (%d challenges, %d blocks read for %d challenged) Time = %.2f ms\n",
+            count, distinct, challenged, totalTimeTaken);
+    io_report(stat_file);
+    storage_report(stat_file);
+    fclose(stat_file);
+}
+
+// Partial proof of a shard holder: folds the challenged blocks among first..last of its data shard
+// (those blocks' bytes only) and tag shard. No key is needed; the combiner applies Be and Pc.
+void proofGenShard_main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: proofGenShard <param file> <data shard> <tag shard> <challenge file> [partial proof file]\n");
+        exit(EXIT_FAILURE);
+    }
+    char *data_shard = argv[1];
+    char *tag_shard = argv[2];
+    char *partial_file = argc > 4 ? argv[4] : "PARTIAL_POP.bin";
+    
+    ZR_ELEMENT(one);
+    ZR_ELEMENT(add_mu);
+    ZR_ELEMENT(add_v);
+    G1_ELEMENT(pro_sigu);
+    
+    TAGSHARDHEADER shard;
+    read_shard_header(tag_shard, &shard);
+    uint64_t shard_base = (shard.first_block - 1) * BLOCK_SIZE;
+    uint64_t shard_end = shard.last_block * BLOCK_SIZE < shard.input_size ? shard.last_block * BLOCK_SIZE : shard.input_size;
+    struct stat st;
+    if (stat(data_shard, &st) != 0 || (uint64_t) st.st_size != shard_end - shard_base) {
+        printf("Error: %s does not hold blocks %llu to %llu of %s\n", data_shard, (unsigned long long) shard.first_block,
+               (unsigned long long) shard.last_block, shard.input);
+        exit(EXIT_FAILURE);
+    }
     
-    FILE *H2_read = open_file("H2PV.bin", "rb");
-    FILE *file = open_file("Challenge_index_VP.txt", "r");
-    	
-    int next_int = read_next_integer(file);
+    int span = trace_begin("proofGenShard", "challenge");
+    CHALLENGE chal;
+    FILE *chalFile = open_file(argv[3], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
     
-    element_t result;
-    element_init_G1(result, global_params);
-    char file1[50];
+    // Challenged indices are sorted, so the shard's are one run; they are renumbered from the
+    // shard's first block and v_offset restores the global index for the coefficients
+    int num_blocks = challenge_size(&chal, shard.num_blocks);
+    int *indices = challenge_indices(chal.seed, num_blocks, shard.num_blocks);
+    int lo = 0, hi;
+    while (lo < num_blocks && (uint64_t) indices[lo] < shard.first_block) {
+        lo++;
+    }
+    for (hi = lo; hi < num_blocks && (uint64_t) indices[hi] <= shard.last_block; hi++) {
+        indices[hi] -= shard.first_block - 1;
+    }
+    trace_end(span);
     
-    clock_t startTime, endTime;
+    element_set1(one);
+    element_set0(add_mu);
+    element_set0(add_v);
+    element_set1(pro_sigu);
     
-    while (num_blocks > i++) {
-        if (i == next_int) {
-            read_element_from_file(wi, H2_read);
-            
-            startTime = clock();
-            element_from_hash(result, file1, strlen(file1));
-            generate_deterministic_v_with_seed(Zr_point, seed, i);
-            element_pow_zn(j6, wi, Zr_point);
-            element_mul(pro_wi, pro_wi, j6);
-            endTime = clock();
-            
-    	    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
-            
-            next_int = read_next_integer(file);
-        }
+    STORAGE *data_file = storage_open(data_shard);
+    STORAGE *Sigma_read = storage_open(tag_shard);
+    double totalTimeTaken = 0.0;
+    span = trace_begin("proofGenShard", "blocks");
+    accumulate_range(data_file, Sigma_read, sizeof(TAGSHARDHEADER), indices, (LOCATERANGE){lo, hi}, chal.seed,
+                     shard.first_block - 1, one, add_mu, pro_sigu, add_v, &totalTimeTaken);
+    trace_end(span);
+    storage_close(data_file);
+    storage_close(Sigma_read);
+    free(indices);
+    
+    PARTIALPROOFHEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PARTIALPROOF_MAGIC, sizeof(header.magic));
+    header.first_block = shard.first_block;
+    header.last_block = shard.last_block;
+    header.num_blocks = shard.num_blocks;
+    header.setup_hash = shard.setup_hash;
+    header.chal_hash = challenge_hash(&chal);
+    header.challenged = hi - lo;
+    
+    FILE *partial_write = open_file(partial_file, "wb");
+    if (fwrite(&header, 1, sizeof(header), partial_write) != sizeof(header)) {
+        perror("Error writing partial proof");
+        exit(EXIT_FAILURE);
     }
+    save_element_to_file(add_mu, partial_write);
+    save_element_to_file(pro_sigu, partial_write);
+    save_element_to_file(add_v, partial_write);
+    fclose(partial_write);
     
-    startTime = clock();
-    element_pairing(b1, sigu, g);
-    element_pow_zn(x1, Qc, mu);
-    element_pairing(b2, x1, g0);
-    element_mul(j7, pro_wi, Pe);
-    element_pairing(b3, j7, Pc);
-    element_mul(b4, b2, b3);
-    endTime = clock();
+    FILE *stat_file = open_file("statistics.txt", "a");
+    fprintf(stat_file, "Shard Proof Generation (blocks %llu-%llu, %d challenged) Time = %.2f ms\n",
+            (unsigned long long) shard.first_block, (unsigned long long) shard.last_block, hi - lo, totalTimeTaken);
+    io_report(stat_file);
+    storage_report(stat_file);
+    fclose(stat_file);
     
-    *totalTimeTaken = (*totalTimeTaken + measure_time(startTime, endTime));
+    if(debug) {
+        printf("Shard Proof Generation Executed Successfully. \nPartial proof is saved on file name %s\n\n", partial_file);
+    }
+}
 
-    fclose(file);
-    fclose(chalFile);
-    fclose(params_file);
-    fclose(POP_read);
-    fclose(H2_read);
-    fclose(pub_key_csp_file);
-    fclose(pub_key_auditee_file);
+typedef struct {
+    PARTIALPROOFHEADER header;
+    char *name;
+} PARTIALPROOF;
 
-    element_clear(result);
-    element_clear(Pc);
-    element_clear(Pe);
-    element_clear(mu);
-    element_clear(sigu);
-    element_clear(x1);
-    element_clear(b2);
-    element_clear(b3);
-    element_clear(g);
-    element_clear(g0);
-    element_clear(wi);
-    element_clear(Zr_point);
-    element_clear(j6);
-    element_clear(pro_wi);
-    element_clear(j7);
+int compare_partials(const void *a, const void *b) {
+    const PARTIALPROOFHEADER *x = &((const PARTIALPROOF *) a)->header, *y = &((const PARTIALPROOF *) b)->header;
+    return x->first_block < y->first_block ? -1 : x->first_block > y->first_block;
 }
 
-void verifyProof_main(int argc, char **argv) {
-    if (argc < 9) {
-        fprintf(stderr, "Usage: %s <csp public key file> <auditee public key file> <POP file> <csp ID> <local params file> <challenge file> <data file identifier> <total number of blocks in data file>\n", argv[0]);
+// Designated combiner: folds the partial proofs of all shard holders into the POP.bin that
+// proofGen would have produced over the whole file, applying the Be/Pc correction once
+void proofCombine_main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: proofCombine <param file> <auditee full private key file> <csp public key file> <challenge file> <partial proof> [<partial proof> ...]\n");
         exit(EXIT_FAILURE);
     }
+    int count = argc - 4;
+    
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
+    ZR_ELEMENT(add_mu);
+    ZR_ELEMENT(add_v);
+    ZR_ELEMENT(add_Zr_points);
+    ZR_ELEMENT(mu);
+    ZR_ELEMENT(v);
+    G1_ELEMENT(pro_sigu);
+    G1_ELEMENT(sig);
+    G1_ELEMENT(sigu);
     
-    element_t b1, b4;
-    
-    element_init_GT(b1, global_params);
-    element_init_GT(b4, global_params);
-    
-    FILE *stat_file = open_file("statistics.txt", "a");
-    clock_t startTime, endTime;
-    float totalTimeTaken = 0.0;
+    FILE *privt_key_auditee_file = open_file(argv[1], "rb");
+    FILE *pub_key_csp_file = open_file(argv[2], "rb");
+    read_element_from_file(Be, privt_key_auditee_file);
+    read_element_from_file(Pc, pub_key_csp_file);
+    fclose(privt_key_auditee_file);
+    fclose(pub_key_csp_file);
+    
+    CHALLENGE chal;
+    FILE *chalFile = open_file(argv[3], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    PARTIALPROOF *partials = (PARTIALPROOF *) malloc(count * sizeof(PARTIALPROOF));
+    for (int i = 0; i < count; i++) {
+        partials[i].name = argv[4 + i];
+        FILE *partial_read = open_file(partials[i].name, "rb");
+        if (fread(&partials[i].header, 1, sizeof(PARTIALPROOFHEADER), partial_read) != sizeof(PARTIALPROOFHEADER) ||
+            memcmp(partials[i].header.magic, PARTIALPROOF_MAGIC, sizeof(partials[i].header.magic)) != 0) {
+            printf("Error: %s is not a partial proof\n", partials[i].name);
+            exit(EXIT_FAILURE);
+        }
+        fclose(partial_read);
+    }
+    qsort(partials, count, sizeof(PARTIALPROOF), compare_partials);
+    
+    // The partials must answer this challenge for the same file and keys, and between them cover
+    // every block, so every challenged block was proved exactly once
+    PARTIALPROOFHEADER *first = &partials[0].header;
+    uint64_t next = 1, challenged = 0;
+    for (int i = 0; i < count; i++) {
+        PARTIALPROOFHEADER *h = &partials[i].header;
+        if (h->chal_hash != challenge_hash(&chal)) {
+            printf("Error: %s answers another challenge than %s\n", partials[i].name, argv[3]);
+            exit(EXIT_FAILURE);
+        }
+        if (h->setup_hash != first->setup_hash || h->num_blocks != first->num_blocks) {
+            printf("Error: %s belongs to another file or other keys than %s\n", partials[i].name, partials[0].name);
+            exit(EXIT_FAILURE);
+        }
+        check_block_span(&next, h->first_block, h->last_block, partials[i].name);
+        challenged += h->challenged;
+    }
+    check_block_coverage(next, first->num_blocks, "the challenged file");
+    if (challenged != (uint64_t) challenge_size(&chal, first->num_blocks)) {
+        printf("Error: The partial proofs cover %llu challenged blocks, the challenge has %d\n",
+               (unsigned long long) challenged, challenge_size(&chal, first->num_blocks));
+        exit(EXIT_FAILURE);
+    }
+    
+    element_set0(add_mu);
+    element_set0(add_v);
+    element_set1(pro_sigu);
+    
+    double totalTimeTaken = 0.0;
+    uint64_t startTime = trace_now_ns();
+    for (int i = 0; i < count; i++) {
+        FILE *partial_read = open_file(partials[i].name, "rb");
+        fseeko(partial_read, sizeof(PARTIALPROOFHEADER), SEEK_SET);
+        read_element_from_file(mu, partial_read);
+        read_element_from_file(sig, partial_read);
+        read_element_from_file(v, partial_read);
+        fclose(partial_read);
+        
+        element_add(add_mu, add_mu, mu);
+        element_mul(pro_sigu, pro_sigu, sig);
+        element_add(add_v, add_v, v);
+    }
+    // sum(Be*v) over all challenged blocks is Be * sum(v)
+    element_mul(add_Zr_points, Be, add_v);
+    uint64_t endTime = trace_now_ns();
+    totalTimeTaken += measure_time(startTime, endTime);
+    finalize_proof(sigu, pro_sigu, add_Zr_points, Be, Pc, &totalTimeTaken);
+    free(partials);
+    
+    save_proof("POP.bin", add_mu, sigu);
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    fprintf(stat_file, "Proof Combination (%d partial proofs) Time = %.2f ms\n", count, totalTimeTaken);
+    fclose(stat_file);
+    
+    if(debug) {
+        printf("Proof Combination Executed Successfully. \nComplete proof is save on file name %s\n\n", "POP.bin");
+    }
+}
+
+// Checks e(sigu, g) == e(Qc^mu, g0) * b3, with b3 from preverify_file when given
+int verifyproof(char **argv, char *preverify_file, double *totalTimeTaken) {
+    if(debug) {
+    printf("VERIFY PROOF ALGO INVOKED...\n\n");
+    }
+    
+    G1_ELEMENT(Qc);
+    G2_ELEMENT(Pc);
+    G1_ELEMENT(Pe);
+    G1_ELEMENT(sigu);
+    G2_ELEMENT(g);
+    G2_ELEMENT(g0);
+    
+    ZR_ELEMENT(mu);
+    
+    GT_ELEMENT(b3);
+
+    FILE *pub_key_csp_file = open_file(argv[1], "rb");
+    FILE *pub_key_auditee_file = open_file(argv[2], "rb");
+    FILE *POP_read = open_file(argv[3], "rb");
+    FILE *params_file = open_file(argv[5], "rb");
+    FILE *chalFile = open_file(argv[6], "rb");
+    
+    read_public_key_G2(Pc, pub_key_csp_file);
+    read_element_from_file(Pe, pub_key_auditee_file);
+    read_element_from_file(mu, POP_read);
+    read_element_from_file(sigu, POP_read);
+    read_element_from_file(g, params_file);
+    read_element_from_file(g0, params_file);
+    
+    H1(Qc, argv[4]);
+    
+    CHALLENGE chal;
+    
+    read_challenge_file(chalFile, &chal);
+    
+    char *fileName = NULL;
+    long long num_blocks;
+    read_from_file(argv[7], &fileName, &num_blocks);
+    
+    if (preverify_file) {
+        load_preverify(b3, preverify_file, &chal, fileName, num_blocks, Pe, Pc);
+    }
+    else if (!verify_offline(b3, &chal, fileName, num_blocks, Pe, Pc, totalTimeTaken)) {
+        perror("Failed to allocate memory for numbers array");
+        exit(EXIT_FAILURE);
+    }
+    free(fileName);
     
-    verifyproof(argv, b1, b4, &totalTimeTaken);
+    int span = trace_begin("verifyProof", "pairings");
+    int ok = check_proof_online(mu, sigu, b3, Qc, g, g0, totalTimeTaken);
+    trace_end(span);
+
+    fclose(chalFile);
+    fclose(params_file);
+    fclose(POP_read);
+    fclose(pub_key_csp_file);
+    fclose(pub_key_auditee_file);
+    return ok;
+}
+
+void verifyProof_main(int argc, char **argv) {
+    if (argc < 8) {
+        fprintf(stderr, "Usage: %s <csp public key file> <auditee public key file> <POP file> <csp ID> <local params file> <challenge file> <file info file> [pre-verification file]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
     
-    startTime = clock();
-    if (!element_cmp(b1, b4)) {
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    
+    // A pre-verification file from chalGen --prepare leaves only the proof-dependent pairings
+    if (verifyproof(argv, argc > 8 ? argv[8] : NULL, &totalTimeTaken)) {
         if(lastDebug) {
             printf("\n\nVerification Successfull!\n\n");
         }
@@ -625,50 +1280,1126 @@ void verifyProof_main(int argc, char **argv) {
     	    printf("0");
     	}
     }
-    endTime = clock();
     
-    totalTimeTaken = (totalTimeTaken + measure_time(startTime, endTime));
+    fprintf(stat_file, argc > 8 ? "Verify Proof Online Phase Time = %.2f ms\n" : "Verify Proof Phase Time = %.2f ms\n",
+            totalTimeTaken);
+    fclose(stat_file);
+
+    if(debug) {
+    printf("Verify Proof Executed Successfully.");
+    }
+}
+
+// Upload-time tag validation. Each tag satisfies e(sigma_i, g) = e(Qc, g0)^bl_i * e(H2_i * Pe, Pc), so
+// for random 64-bit r_i a whole range is checked at once with three pairings:
+//     e(prod sigma_i^r_i, g) == e(Qc^sum(r_i*bl_i), g0) * e(prod H2_i^r_i * Pe^sum(r_i), Pc)
+// A failing range is halved until the bad tags are isolated; when one half holds, the other is
+// known to fail and is split without being checked itself.
+
+typedef struct {
+    STOREDBLOCKS blocks;
+    char *fileName;
+    int *indices;          // checked blocks, or NULL for every block in order
+    element_ptr Qc, Pe, Pc, g, g0;
+    gmp_randstate_t rand_state;
+    size_t sig_size;
+    long long checks;
+} TAGCHECK;
+
+static inline int tag_block(TAGCHECK *tc, long long p) {
+    return tc->indices ? tc->indices[p] : (int)(p + 1);
+}
+
+// Aggregated check of the tags at positions [lo, hi) of the checked set
+int tags_hold(TAGCHECK *tc, long long lo, long long hi) {
+    unsigned char buffer[BLOCK_SIZE];
+    int block[H2_BATCH];
+    G1_ELEMENTS(h2, H2_BATCH);
+    element_ptr h2_ptr[H2_BATCH];
+    for (int k = 0; k < H2_BATCH; k++) {
+        h2_ptr[k] = h2.e[k];
+    }
+    unsigned char *sig_bytes = malloc(tc->sig_size);
+    ZR_ELEMENT(bl);
+    ZR_ELEMENT(r);
+    ZR_ELEMENT(j1);
+    ZR_ELEMENT(sum_rbl);
+    ZR_ELEMENT(sum_r);
+    G1_ELEMENT(sig);
+    G1_ELEMENT(pro_sig);
+    G1_ELEMENT(pro_h2);
+    G1_ELEMENT(x1);
+    G1_ELEMENT(x2);
+    GT_ELEMENT(b1);
+    GT_ELEMENT(b2);
+    GT_ELEMENT(b3);
+    G1PRODUCT sig_prod, h2_prod;
+    g1_product_init(&sig_prod);
+    g1_product_init(&h2_prod);
+    mpz_t z;
+    mpz_init(z);
+    
+    element_set1(pro_sig);
+    element_set1(pro_h2);
+    element_set0(sum_rbl);
+    element_set0(sum_r);
+    
+    for (long long p = lo; p < hi; p += H2_BATCH) {
+        int n = hi - p < H2_BATCH ? (int)(hi - p) : H2_BATCH;
+        for (int k = 0; k < n; k++) {
+            block[k] = tag_block(tc, p + k);
+        }
+        hash2_blocks(h2_ptr, tc->fileName, block, n);
+        
+        for (int k = 0; k < n; k++) {
+            size_t bytes_read = read_stored_block(&tc->blocks, block[k], buffer, sig_bytes, tc->sig_size);
+            if (bytes_read == 0) {
+                printf("Error: Could not read block %d or its tag\n", block[k]);
+                exit(EXIT_FAILURE);
+            }
+            element_from_bytes(sig, sig_bytes);
+            
+            element_from_hash(bl, buffer, bytes_read);
+            mpz_urandomb(z, tc->rand_state, 64);
+            element_set_mpz(r, z);
+            g1_product_add(&sig_prod, pro_sig, sig, r);
+            g1_product_add(&h2_prod, pro_h2, h2.e[k], r);
+            element_mul(j1, r, bl);
+            element_add(sum_rbl, sum_rbl, j1);
+            element_add(sum_r, sum_r, r);
+        }
+        TRACE_COUNT(CNT_HASH_ZR, n);
+        TRACE_COUNT(CNT_G1_EXP, 2 * n);
+    }
+    g1_product_flush(&sig_prod, pro_sig);
+    g1_product_flush(&h2_prod, pro_h2);
+    
+    element_pairing(b1, pro_sig, tc->g);
+    g1_pow_zn(x1, tc->Qc, sum_rbl);
+    element_pairing(b2, x1, tc->g0);
+    g1_pow_zn(x2, tc->Pe, sum_r);
+    element_mul(x2, x2, pro_h2);
+    element_pairing(b3, x2, tc->Pc);
+    element_mul(b2, b2, b3);
+    TRACE_COUNT(CNT_PAIRING, 3);
+    TRACE_COUNT(CNT_G1_EXP, 2);
+    tc->checks++;
+    int holds = !element_cmp(b1, b2);
+    
+    g1_product_clear(&sig_prod);
+    g1_product_clear(&h2_prod);
+    mpz_clear(z);
+    free(sig_bytes);
+    return holds;
+}
+
+// Writes the blocks with bad tags among positions [lo, hi) to bad_file; returns their number
+long long locate_bad_tags(TAGCHECK *tc, long long lo, long long hi, int known_bad, FILE *bad_file) {
+    if (!known_bad && tags_hold(tc, lo, hi)) {
+        return 0;
+    }
+    if (hi - lo == 1) {
+        fprintf(bad_file, "%d\n", tag_block(tc, lo));
+        return 1;
+    }
+    long long mid = lo + (hi - lo) / 2;
+    long long bad = locate_bad_tags(tc, lo, mid, 0, bad_file);
+    return bad + locate_bad_tags(tc, mid, hi, bad == 0, bad_file);
+}
 
-    element_clear(b1);
-    element_clear(b4);
+void verifyTags_main(int argc, char **argv) {
+    if (argc < 8) {
+        fprintf(stderr, "Usage: verifyTags <param file> <csp public key file> <auditee public key file> <csp ID> <local params file> <input file> <metadata file> <file info file> [ratio|count of blocks to sample]\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    G1_ELEMENT(Qc);
+    G2_ELEMENT(Pc);
+    G1_ELEMENT(Pe);
+    G2_ELEMENT(g);
+    G2_ELEMENT(g0);
+    
+    FILE *pub_key_csp_file = open_file(argv[1], "rb");
+    FILE *pub_key_auditee_file = open_file(argv[2], "rb");
+    FILE *params_file = open_file(argv[4], "rb");
+    read_public_key_G2(Pc, pub_key_csp_file);
+    read_element_from_file(Pe, pub_key_auditee_file);
+    read_element_from_file(g, params_file);
+    read_element_from_file(g0, params_file);
+    fclose(pub_key_csp_file);
+    fclose(pub_key_auditee_file);
+    fclose(params_file);
+    H1(Qc, argv[3]);
+    
+    TAGCHECK tc;
+    long long num_blocks;
+    tc.fileName = NULL;
+    read_from_file(argv[7], &tc.fileName, &num_blocks);
+    tc.blocks.data_file = storage_open(argv[5]);
+    tc.blocks.Sigma_read = storage_open(argv[6]);
+    tc.blocks.sig_base = 0;
+    // A full check reads local files front to back
+    STORAGE *stores[2] = {tc.blocks.data_file, tc.blocks.Sigma_read};
+    for (int i = 0; i < 2; i++) {
+        if (stores[i]->file && fileno(stores[i]->file) >= 0) {
+            setvbuf(stores[i]->file, NULL, _IOFBF, 1 << 20);
+        }
+    }
+    tc.Qc = Qc;
+    tc.Pe = Pe;
+    tc.Pc = Pc;
+    tc.g = g;
+    tc.g0 = g0;
+    tc.sig_size = element_length_in_bytes(Qc);
+    tc.checks = 0;
+    
+    // Coefficients and the optional sample come from fresh randomness the tagger cannot predict
+    unsigned char seed[SEED_SIZE];
+    FILE *random_file = open_file("/dev/urandom", "rb");
+    if (fread(seed, 1, SEED_SIZE, random_file) != SEED_SIZE) {
+        printf("Error: Could not read random data from /dev/urandom\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(random_file);
+    mpz_t z;
+    mpz_init(z);
+    mpz_import(z, SEED_SIZE, 1, 1, 0, 0, seed);
+    gmp_randinit_default(tc.rand_state);
+    gmp_randseed(tc.rand_state, z);
+    mpz_clear(z);
+    
+    long long checked = num_blocks;
+    tc.indices = NULL;
+    if (argc > 8) {
+        // Same syntax as a challenge: ratios have a decimal point, block counts do not
+        CHALLENGE sample;
+        memcpy(sample.seed, seed, SEED_SIZE);
+        sample.ratio = strpbrk(argv[8], ".eE") ? atof(argv[8]) : 0;
+        sample.count = sample.ratio ? 0 : atoll(argv[8]);
+        checked = challenge_size(&sample, num_blocks);
+        tc.indices = challenge_indices(sample.seed, checked, num_blocks);
+        prefetch_blocks(tc.blocks.data_file, tc.blocks.Sigma_read, 0, tc.sig_size, tc.indices, checked);
+    }
+    
+    FILE *bad_file = open_file("bad_tags.txt", "w");
+    int span = trace_begin("verifyTags", "check");
+    uint64_t startTime = trace_now_ns();
+    long long bad = checked > 0 ? locate_bad_tags(&tc, 0, checked, 0, bad_file) : 0;
+    uint64_t endTime = trace_now_ns();
+    trace_end(span);
+    fclose(bad_file);
     
-    fprintf(stat_file, "Verify Proof Phase Time = %.2f ms\n", totalTimeTaken);
+    if (bad == 0) {
+        if(lastDebug) {
+            printf("\n\nTag Verification Successfull!\n\n");
+        }
+        else {
+            printf("1");
+        }
+    }
+    else {
+        if(lastDebug) {
+            printf("\n\nTag Verification Failed! %lld bad tag(s) listed in bad_tags.txt\n\n", bad);
+        }
+        else {
+            printf("0");
+        }
+    }
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    fprintf(stat_file, "Tag Verification (%lld of %lld blocks, %lld checks) Time = %.2f ms\n", checked, num_blocks, tc.checks,
+            measure_time(startTime, endTime));
+    io_report(stat_file);
+    storage_report(stat_file);
     fclose(stat_file);
+    
+    gmp_randclear(tc.rand_state);
+    free(tc.indices);
+    free(tc.fileName);
+    storage_close(tc.blocks.data_file);
+    storage_close(tc.blocks.Sigma_read);
+}
 
+// Corrupted-block localization by binary splitting. The auditor keeps the still-suspect
+// challenge positions as ranges in a subsets file, the prover answers one aggregated proof
+// per range in a single response, and every failing range is halved for the next round
+// until it is down to one block. d corrupted blocks out of k are found in O(d log k) checks.
+
+void locateInit_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: locateInit <param file> <challenge file> <data file identifier>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    CHALLENGE chal;
+    FILE *chalFile = open_file(argv[1], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    char *fileName = NULL;
+    long long num_blocks;
+    read_from_file(argv[2], &fileName, &num_blocks);
+    int challenge_blocks = challenge_size(&chal, num_blocks);
+    
+    // verifyProof has already failed on the whole set, so start from its two halves
+    LOCATERANGE ranges[2];
+    int count = 0;
+    if (challenge_blocks == 1) {
+        ranges[count++] = (LOCATERANGE){0, 1};
+    }
+    else if (challenge_blocks > 1) {
+        ranges[count++] = (LOCATERANGE){0, challenge_blocks / 2};
+        ranges[count++] = (LOCATERANGE){challenge_blocks / 2, challenge_blocks};
+    }
+    write_ranges("locate_subsets.txt", ranges, count);
+    fclose(open_file("corrupted_blocks.txt", "w"));
+    free(fileName);
+    
     if(debug) {
-    printf("Verify Proof Executed Successfully.");
+    printf("Localization started over %d challenged blocks.\n", challenge_blocks);
+    }
+}
+
+void locateProof_main(int argc, char **argv) {
+    if (argc < 7) {
+        fprintf(stderr, "Usage: locateProof <param file> <auditee full private key file> <csp public key file> <input file> <metadata file> <challenge file> <subsets file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
+    ZR_ELEMENT(mu);
+    G1_ELEMENT(sigu);
+    
+    FILE *privt_key_auditee_file = open_file(argv[1], "rb");
+    FILE *pub_key_csp_file = open_file(argv[2], "rb");
+    read_element_from_file(Be, privt_key_auditee_file);
+    read_element_from_file(Pc, pub_key_csp_file);
+    fclose(privt_key_auditee_file);
+    fclose(pub_key_csp_file);
+    
+    CHALLENGE chal;
+    FILE *chalFile = open_file(argv[5], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    STORAGE *data_file = storage_open(argv[3]);
+    STORAGE *Sigma_read = storage_open(argv[4]);
+    int block_count = (storage_size(data_file) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int challenge_blocks = challenge_size(&chal, block_count);
+    int *indices = challenge_indices(chal.seed, challenge_blocks, block_count);
+    
+    int count;
+    LOCATERANGE *ranges = read_ranges(argv[6], &count);
+    
+    FILE *POP_write = open_file("LOCATE_POP.bin", "wb");
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    
+    int span = trace_begin("locateProof", "subsets");
+    for (int r = 0; r < count; r++) {
+        if (ranges[r].lo < 0 || ranges[r].hi > challenge_blocks || ranges[r].lo >= ranges[r].hi) {
+            printf("Error: Subset %d %d is outside the challenge\n", ranges[r].lo, ranges[r].hi);
+            exit(EXIT_FAILURE);
+        }
+        prove_range(data_file, Sigma_read, indices, ranges[r], chal.seed, Be, Pc, mu, sigu, &totalTimeTaken);
+        save_element_to_file(mu, POP_write);
+        save_element_to_file(sigu, POP_write);
+    }
+    trace_end(span);
+    
+    storage_close(data_file);
+    storage_close(Sigma_read);
+    fclose(POP_write);
+    free(ranges);
+    free(indices);
+    
+    fprintf(stat_file, "Locate Proof Generation (%d subsets) Time = %.2f ms\n", count, totalTimeTaken);
+    io_report(stat_file);
+    storage_report(stat_file);
+    fclose(stat_file);
+    
+    if(debug) {
+        printf("Locate Proof Generation Executed Successfully. \nSubset proofs are saved on file name %s\n\n", "LOCATE_POP.bin");
+    }
+}
+
+// Checks one subset proof read from POP_read
+int verify_range(FILE *POP_read, int *indices, LOCATERANGE range, char *fileName, unsigned char *seed,
+                 element_t Qc, element_t Pe, element_t Pc, element_t g, element_t g0, double *totalTimeTaken) {
+    ZR_ELEMENT(mu);
+    G1_ELEMENT(sigu);
+    G1_ELEMENT(pro_wi);
+    
+    read_element_from_file(mu, POP_read);
+    read_element_from_file(sigu, POP_read);
+    
+    element_set1(pro_wi);
+    accumulate_h2(pro_wi, indices, range, fileName, seed, 0, totalTimeTaken);
+    return check_proof(mu, sigu, pro_wi, Qc, Pe, Pc, g, g0, totalTimeTaken);
+}
+
+void locateVerify_main(int argc, char **argv) {
+    if (argc < 9) {
+        fprintf(stderr, "Usage: locateVerify <param file> <csp public key file> <auditee public key file> <locate POP file> <csp ID> <local params file> <challenge file> <data file identifier> <subsets file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    G1_ELEMENT(Qc);
+    G2_ELEMENT(Pc);
+    G1_ELEMENT(Pe);
+    G2_ELEMENT(g);
+    G2_ELEMENT(g0);
+    
+    FILE *pub_key_csp_file = open_file(argv[1], "rb");
+    FILE *pub_key_auditee_file = open_file(argv[2], "rb");
+    FILE *params_file = open_file(argv[5], "rb");
+    read_public_key_G2(Pc, pub_key_csp_file);
+    read_element_from_file(Pe, pub_key_auditee_file);
+    read_element_from_file(g, params_file);
+    read_element_from_file(g0, params_file);
+    fclose(pub_key_csp_file);
+    fclose(pub_key_auditee_file);
+    fclose(params_file);
+    H1(Qc, argv[4]);
+    
+    CHALLENGE chal;
+    FILE *chalFile = open_file(argv[6], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    char *fileName = NULL;
+    long long num_blocks;
+    read_from_file(argv[7], &fileName, &num_blocks);
+    int challenge_blocks = challenge_size(&chal, num_blocks);
+    int *indices = challenge_indices(chal.seed, challenge_blocks, num_blocks);
+    
+    int count;
+    LOCATERANGE *ranges = read_ranges(argv[8], &count);
+    LOCATERANGE *next = malloc((2 * count + 1) * sizeof(LOCATERANGE));
+    int next_count = 0, failed = 0, located = 0;
+    
+    FILE *POP_read = open_file(argv[3], "rb");
+    FILE *corrupted_file = open_file("corrupted_blocks.txt", "a");
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    
+    int span = trace_begin("locateVerify", "subsets");
+    for (int r = 0; r < count; r++) {
+        if (ranges[r].lo < 0 || ranges[r].hi > challenge_blocks || ranges[r].lo >= ranges[r].hi) {
+            printf("Error: Subset %d %d is outside the challenge\n", ranges[r].lo, ranges[r].hi);
+            exit(EXIT_FAILURE);
+        }
+        if (verify_range(POP_read, indices, ranges[r], fileName, chal.seed, Qc, Pe, Pc, g, g0, &totalTimeTaken)) {
+            continue;
+        }
+        failed++;
+        
+        int mid = ranges[r].lo + (ranges[r].hi - ranges[r].lo) / 2;
+        if (ranges[r].hi - ranges[r].lo == 1) {
+            fprintf(corrupted_file, "%d\n", indices[ranges[r].lo]);
+            located++;
+        }
+        else {
+            next[next_count++] = (LOCATERANGE){ranges[r].lo, mid};
+            next[next_count++] = (LOCATERANGE){mid, ranges[r].hi};
+        }
+    }
+    trace_end(span);
+    
+    write_ranges(argv[8], next, next_count);
+    
+    fclose(POP_read);
+    fclose(corrupted_file);
+    free(next);
+    free(ranges);
+    free(indices);
+    free(fileName);
+    
+    fprintf(stat_file, "Locate Verification (%d subsets) Time = %.2f ms\n", count, totalTimeTaken);
+    fclose(stat_file);
+    
+    if(lastDebug) {
+        printf("\nLocate round: %d of %d subsets failed, %d corrupted block(s) located, %d subsets left\n", failed, count, located, next_count);
+    }
+    else {
+        printf("%d", next_count);
+    }
+}
+
+// Multi-file audit: the CSP folds the challenged blocks of every file listed in a manifest into a
+// single (mu, sigu) pair, so the verifier spends three pairings whatever the number of files.
+// Each file draws its challenge from the shared seed offset by its manifest position, and its
+// coefficients from a running block offset, so no two files share challenge sets or coefficients.
+
+void proofGenFiles_main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: proofGenFiles <param file> <auditee full private key file> <csp public key file> <manifest file> <challenge file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    ZR_ELEMENT(Be);
+    G1_ELEMENT(Pc);
+    ZR_ELEMENT(add_mu);
+    ZR_ELEMENT(add_Zr_points);
+    G1_ELEMENT(pro_sigu);
+    G1_ELEMENT(sigu);
+    
+    FILE *privt_key_auditee_file = open_file(argv[1], "rb");
+    FILE *pub_key_csp_file = open_file(argv[2], "rb");
+    read_element_from_file(Be, privt_key_auditee_file);
+    read_element_from_file(Pc, pub_key_csp_file);
+    fclose(privt_key_auditee_file);
+    fclose(pub_key_csp_file);
+    
+    CHALLENGE chal;
+    unsigned char fseed[SEED_SIZE];
+    FILE *chalFile = open_file(argv[4], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    int count;
+    MANIFESTENTRY *files = read_manifest(argv[3], &count);
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    int v_offset = 0, challenged = 0;
+    
+    element_set0(add_mu);
+    element_set0(add_Zr_points);
+    element_set1(pro_sigu);
+    
+    int span = trace_begin("proofGenFiles", "files");
+    for (int f = 0; f < count; f++) {
+        STORAGE *data_file = storage_open(files[f].input);
+        STORAGE *Sigma_read = storage_open(files[f].sigma);
+        int block_count = (storage_size(data_file) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        int challenge_blocks = challenge_size(&chal, block_count);
+        
+        file_seed(chal.seed, f, fseed);
+        int *indices = challenge_indices(fseed, challenge_blocks, block_count);
+        
+        accumulate_range(data_file, Sigma_read, 0, indices, (LOCATERANGE){0, challenge_blocks}, chal.seed, v_offset,
+                         Be, add_mu, pro_sigu, add_Zr_points, &totalTimeTaken);
+        storage_close(data_file);
+        storage_close(Sigma_read);
+        free(indices);
+        
+        v_offset += block_count;
+        challenged += challenge_blocks;
+    }
+    trace_end(span);
+    
+    finalize_proof(sigu, pro_sigu, add_Zr_points, Be, Pc, &totalTimeTaken);
+    
+    save_proof("POP_FILES.bin", add_mu, sigu);
+    free_manifest(files, count);
+    
+    fprintf(stat_file, "Multi-file Proof Generation (%d files, %d blocks) Time = %.2f ms\n", count, challenged, totalTimeTaken);
+    io_report(stat_file);
+    storage_report(stat_file);
+    fclose(stat_file);
+    
+    if(debug) {
+        printf("Multi-file Proof Generation Executed Successfully. \nComplete proof is save on file name %s\n\n", "POP_FILES.bin");
+    }
+}
+
+void verifyProofFiles_main(int argc, char **argv) {
+    if (argc < 8) {
+        fprintf(stderr, "Usage: verifyProofFiles <param file> <csp public key file> <auditee public key file> <POP file> <csp ID> <local params file> <challenge file> <manifest file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    G1_ELEMENT(Qc);
+    G2_ELEMENT(Pc);
+    G1_ELEMENT(Pe);
+    G2_ELEMENT(g);
+    G2_ELEMENT(g0);
+    ZR_ELEMENT(mu);
+    G1_ELEMENT(sigu);
+    G1_ELEMENT(pro_wi);
+    
+    FILE *pub_key_csp_file = open_file(argv[1], "rb");
+    FILE *pub_key_auditee_file = open_file(argv[2], "rb");
+    FILE *POP_read = open_file(argv[3], "rb");
+    FILE *params_file = open_file(argv[5], "rb");
+    read_public_key_G2(Pc, pub_key_csp_file);
+    read_element_from_file(Pe, pub_key_auditee_file);
+    read_element_from_file(mu, POP_read);
+    read_element_from_file(sigu, POP_read);
+    read_element_from_file(g, params_file);
+    read_element_from_file(g0, params_file);
+    fclose(pub_key_csp_file);
+    fclose(pub_key_auditee_file);
+    fclose(POP_read);
+    fclose(params_file);
+    H1(Qc, argv[4]);
+    
+    CHALLENGE chal;
+    unsigned char fseed[SEED_SIZE];
+    FILE *chalFile = open_file(argv[6], "rb");
+    read_challenge_file(chalFile, &chal);
+    fclose(chalFile);
+    
+    int count;
+    MANIFESTENTRY *files = read_manifest(argv[7], &count);
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    int v_offset = 0, challenged = 0;
+    
+    element_set1(pro_wi);
+    
+    int span = trace_begin("verifyProofFiles", "hash2");
+    for (int f = 0; f < count; f++) {
+        char *fileName = NULL;
+        long long num_blocks;
+        read_from_file(files[f].info, &fileName, &num_blocks);
+        int challenge_blocks = challenge_size(&chal, num_blocks);
+        
+        file_seed(chal.seed, f, fseed);
+        int *indices = challenge_indices(fseed, challenge_blocks, num_blocks);
+        accumulate_h2(pro_wi, indices, (LOCATERANGE){0, challenge_blocks}, fileName, chal.seed, v_offset, &totalTimeTaken);
+        free(indices);
+        free(fileName);
+        
+        v_offset += num_blocks;
+        challenged += challenge_blocks;
+    }
+    trace_end(span);
+    
+    span = trace_begin("verifyProofFiles", "pairings");
+    int ok = check_proof(mu, sigu, pro_wi, Qc, Pe, Pc, g, g0, &totalTimeTaken);
+    trace_end(span);
+    free_manifest(files, count);
+    
+    if (ok) {
+        if(lastDebug) {
+            printf("\n\nVerification Successfull!\n\n");
+        }
+        else {
+    	    printf("1");
+    	}
+    }
+    else {
+        if(lastDebug) {
+            printf("\n\nVerification Failed!\n\n");
+        }
+        else {
+    	    printf("0");
+    	}
+    }
+    
+    fprintf(stat_file, "Multi-file Verify Proof (%d files, %d blocks) Time = %.2f ms\n", count, challenged, totalTimeTaken);
+    fclose(stat_file);
+}
+
+// Packs the pairing parameters and the given files (localParams.bin, key files) into a context
+// file. Passing the context in place of the parameter file lets a command start with one mmap.
+void contextGen_main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: contextGen <param file> <output context file> [files to include...]\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    size_t size;
+    unsigned char *map = map_file(argv[0], &size);
+    if (is_context(map, size)) {
+        write_context(argv[1], audit_context.param, audit_context.param_size, argv + 2, argc - 2);
+    }
+    else {
+        write_context(argv[1], (const char *) map, size, argv + 2, argc - 2);
+    }
+    munmap(map, size);
+    
+    if(debug) {
+    printf("Context file %s generated with %d files.\n", argv[1], argc - 2);
+    }
+}
+
+// Reads one ID per line from filename into a malloc'd array of strings
+char **read_id_list(char *filename, int *count) {
+    FILE *file = open_file(filename, "r");
+    int capacity = 64;
+    char **ids = malloc(capacity * sizeof(char *));
+    char *line = NULL;
+    size_t len = 0;
+
+    *count = 0;
+    while (ids && getline(&line, &len, file) > 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            ids = realloc(ids, capacity * sizeof(char *));
+            if (!ids) {
+                break;
+            }
+        }
+        ids[(*count)++] = strdup(line);
+    }
+    if (!ids) {
+        perror("Failed to allocate memory for IDs");
+        exit(EXIT_FAILURE);
+    }
+    free(line);
+    fclose(file);
+    return ids;
+}
+
+// Moves the per-ID key files of every listed ID into a keystore in one pass over the store
+void keyImport_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: keyImport <param file> <keystore> <ID list file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int count, imported = 0;
+    char **ids = read_id_list(argv[2], &count);
+    KEYSTORE store;
+    keystore_open_rw(&store, argv[1]);
+    
+    for (int i = 0; i < count; i++) {
+        for (int kind = 0; kind < KEY_KINDS; kind++) {
+            char filename[KEYSTORE_ID_LEN + 32];
+            key_file_name(filename, sizeof(filename), ids[i], key_kind_suffixes[kind]);
+            
+            struct stat st;
+            if (stat(filename, &st) != 0) {
+                continue;
+            }
+            size_t size;
+            unsigned char *data = map_file(filename, &size);
+            keystore_put(&store, ids[i], kind, data, size);
+            munmap(data, size);
+            imported++;
+        }
+        free(ids[i]);
+    }
+    keystore_close(&store);
+    free(ids);
+    
+    if(debug) {
+    printf("%d keys of %d IDs imported into %s.\n", imported, count, argv[1]);
+    }
+}
+
+// Writes the keys of every listed ID back out as per-ID key files
+void keyExport_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: keyExport <param file> <keystore> <ID list file>\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int count;
+    char **ids = read_id_list(argv[2], &count);
+    KEYSTORE store;
+    keystore_open_ro(&store, argv[1]);
+    
+    for (int i = 0; i < count; i++) {
+        KEYRECORD *record = keystore_find(&store, ids[i]);
+        if (record == NULL) {
+            printf("Error: No keys for %s in %s\n", ids[i], argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        for (int kind = 0; kind < KEY_KINDS; kind++) {
+            if (record->lengths[kind] == 0) {
+                continue;
+            }
+            FILE *file = create_and_open_file(ids[i], (char *) key_kind_suffixes[kind], "wb");
+            if (file == NULL || fwrite(record->slots[kind], 1, record->lengths[kind], file) != record->lengths[kind]) {
+                exit(EXIT_FAILURE);
+            }
+            fclose(file);
+        }
+        free(ids[i]);
+    }
+    keystore_close(&store);
+    free(ids);
+}
+
+// KGC batch mode: partial keys for a list of IDs are issued by a pool of threads, and full key
+// generation authenticates the whole batch with two pairings through a random linear combination.
+
+typedef struct {
+    char **ids;
+    element_t *keys;
+    element_ptr alpha;
+    int lo;
+    int hi;
+    double totalTimeTaken;
+} KEYGENJOB;
+
+void *partial_keygen_worker(void *arg) {
+    KEYGENJOB *job = (KEYGENJOB *) arg;
+    for (int i = job->lo; i < job->hi; i++) {
+        double t;
+        keygen1(job->keys[i], job->alpha, job->ids[i], &t);
+        job->totalTimeTaken += t;
+    }
+    arena_release();
+    return NULL;
+}
+
+// Writes one generated key either into an open keystore or into the per-ID file
+void store_key(KEYSTORE *store, char *id, int kind, element_ptr *elems, int n) {
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *file = store ? open_memstream(&buf, &size) : create_and_open_file(id, (char *) key_kind_suffixes[kind], "wb");
+    if (file == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        save_element_to_file(elems[i], file);
+    }
+    fclose(file);
+    if (store) {
+        keystore_put(store, id, kind, buf, size);
+        free(buf);
+    }
+}
+
+void partialKeyGenBatch_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: partialKeyGenBatch <param file> <MSK file> <ID list file> [keystore] [threads]\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char *keystore = argc > 3 && strcmp(argv[3], "-") != 0 ? argv[3] : NULL;
+    int threads = argc > 4 ? atoi(argv[4]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    
+    ZR_ELEMENT(alpha);
+    FILE *msk_file = open_file(argv[1], "rb");
+    read_element_from_file(alpha, msk_file);
+    fclose(msk_file);
+    
+    int count;
+    char **ids = read_id_list(argv[2], &count);
+    G1_ELEMENTS(keys, count);
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+    
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    KEYGENJOB *jobs = calloc(threads, sizeof(KEYGENJOB));
+    if (!workers || !jobs) {
+        perror("Failed to allocate memory for workers");
+        exit(EXIT_FAILURE);
+    }
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    int span = trace_begin("partialKeyGenBatch", "keygen1");
+    uint64_t startTime = trace_now_ns();
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (KEYGENJOB){ids, keys.e, alpha, (int)((long long)count * t / threads), (int)((long long)count * (t + 1) / threads), 0.0};
+        if (pthread_create(&workers[t], NULL, partial_keygen_worker, &jobs[t]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    uint64_t endTime = trace_now_ns();
+    trace_end(span);
+    
+    span = trace_begin("partialKeyGenBatch", "store");
+    KEYSTORE store;
+    if (keystore) {
+        keystore_open_rw(&store, keystore);
+    }
+    for (int i = 0; i < count; i++) {
+        element_ptr key = keys.e[i];
+        store_key(keystore ? &store : NULL, ids[i], KEY_PARTIAL, &key, 1);
+        free(ids[i]);
+    }
+    if (keystore) {
+        keystore_close(&store);
+    }
+    trace_end(span);
+    
+    fprintf(stat_file, "Partial Key Generation Batch (%d IDs, %d threads) Time = %.2f ms\n", count, threads, measure_time(startTime, endTime));
+    fclose(stat_file);
+    free(ids);
+    free(workers);
+    free(jobs);
+    
+    if(debug) {
+    printf("Partial Key Generation Batch Executed Successfully.");
+    }
+}
+
+// Checks e(prod D_i^r_i, g) == e(prod Q_i^r_i, g0) over [lo, hi) with 64-bit random r_i, halving failing
+// ranges until the forged keys are isolated. All-valid batches cost two pairings in total.
+int batch_authenticate(element_t *D, element_t *Q, uint64_t *r, int lo, int hi, element_t g, element_t g0, int *valid) {
+    G1_ELEMENT(A);
+    G1_ELEMENT(B);
+    ZR_ELEMENT(ri);
+    GT_ELEMENT(P1);
+    GT_ELEMENT(P2);
+    G1PRODUCT prod_A, prod_B;
+    g1_product_init(&prod_A);
+    g1_product_init(&prod_B);
+    mpz_t z;
+    mpz_init(z);
+    
+    element_set1(A);
+    element_set1(B);
+    for (int i = lo; i < hi; i++) {
+        mpz_set_ui(z, r[i]);
+        element_set_mpz(ri, z);
+        g1_product_add(&prod_A, A, D[i], ri);
+        g1_product_add(&prod_B, B, Q[i], ri);
+    }
+    g1_product_flush(&prod_A, A);
+    g1_product_flush(&prod_B, B);
+    g1_product_clear(&prod_A);
+    g1_product_clear(&prod_B);
+    mpz_clear(z);
+    element_pairing(P1, A, g);
+    element_pairing(P2, B, g0);
+    TRACE_COUNT(CNT_G1_EXP, 2 * (hi - lo));
+    TRACE_COUNT(CNT_PAIRING, 2);
+    
+    if (!element_cmp(P1, P2)) {
+        for (int i = lo; i < hi; i++) {
+            valid[i] = 1;
+        }
+        return hi - lo;
+    }
+    if (hi - lo == 1) {
+        valid[lo] = 0;
+        return 0;
+    }
+    int mid = lo + (hi - lo) / 2;
+    return batch_authenticate(D, Q, r, lo, mid, g, g0, valid) + batch_authenticate(D, Q, r, mid, hi, g, g0, valid);
+}
+
+void fullKeyGenBatch_main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: fullKeyGenBatch <param file> <local params file> <ID list file> [keystore]\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char *keystore = argc > 3 ? argv[3] : NULL;
+    IBEPARAMS params;
+    FILE *params_file = open_file(argv[1], "rb");
+    read_params(&params, params_file);
+    fclose(params_file);
+    
+    int count;
+    char **ids = read_id_list(argv[2], &count);
+    G1_ELEMENTS(D, count);
+    G1_ELEMENTS(Q, count);
+    uint64_t *r = malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+    int *valid = calloc(count > 0 ? count : 1, sizeof(int));
+    if (!r || !valid) {
+        perror("Failed to allocate memory for keys");
+        exit(EXIT_FAILURE);
+    }
+    
+    int span = trace_begin("fullKeyGenBatch", "read");
+    for (int i = 0; i < count; i++) {
+        char name[KEYSTORE_ID_LEN + 4096];
+        if (keystore) {
+            snprintf(name, sizeof(name), "%s%s%s:%s", keystore, KEYSTORE_SEPARATOR, ids[i], key_kind_names[KEY_PARTIAL]);
+        }
+        else {
+            key_file_name(name, sizeof(name), ids[i], key_kind_suffixes[KEY_PARTIAL]);
+        }
+        FILE *par_privt_key_file = open_file(name, "rb");
+        read_element_from_file(D.e[i], par_privt_key_file);
+        fclose(par_privt_key_file);
+        H1(Q.e[i], ids[i]);
+    }
+    trace_end(span);
+    
+    FILE *random_file = open_file("/dev/urandom", "rb");
+    if (count > 0 && fread(r, sizeof(uint64_t), count, random_file) != (size_t) count) {
+        printf("Error: Could not read random data from /dev/urandom\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(random_file);
+    
+    FILE *stat_file = open_file("statistics.txt", "a");
+    double totalTimeTaken = 0.0;
+    span = trace_begin("fullKeyGenBatch", "authenticate");
+    uint64_t startTime = trace_now_ns();
+    int authenticated = count > 0 ? batch_authenticate(D.e, Q.e, r, 0, count, params.g, params.g0, valid) : 0;
+    uint64_t endTime = trace_now_ns();
+    trace_end(span);
+    totalTimeTaken += measure_time(startTime, endTime);
+    
+    span = trace_begin("fullKeyGenBatch", "keygen2");
+    KEYSTORE store;
+    if (keystore) {
+        keystore_open_rw(&store, keystore);
+    }
+    for (int i = 0; i < count; i++) {
+        if (!valid[i]) {
+            printf("\nAuthentication failed in full key generation phase for %s\n", ids[i]);
+        }
+        else {
+            PUKEYVALS key_vals;
+            double t;
+            keygen2(&key_vals, params.g1, params.g, ids[i], &t);
+            totalTimeTaken += t;
+            
+            // Full key file layout: beta, then D; public key: P, then P2 for asymmetric pairings
+            element_ptr full_key[2] = {key_vals.beta, D.e[i]};
+            element_ptr public_key[2] = {key_vals.P, key_vals.P2};
+            store_key(keystore ? &store : NULL, ids[i], KEY_FULL, full_key, 2);
+            store_key(keystore ? &store : NULL, ids[i], KEY_PUBLIC, public_key, pairing_is_symmetric(global_params) ? 1 : 2);
+            clear_keyvals(&key_vals);
+        }
+        free(ids[i]);
+    }
+    if (keystore) {
+        keystore_close(&store);
+    }
+    trace_end(span);
+    
+    fprintf(stat_file, "Full Key Generation Batch (%d IDs, %d authenticated) Time = %.2f ms\n", count, authenticated, totalTimeTaken);
+    fclose(stat_file);
+    clear_params(&params);
+    free(r);
+    free(valid);
+    free(ids);
+    
+    if (authenticated < count) {
+        exit(EXIT_FAILURE);
+    }
+    if(debug) {
+    printf("Full Key Generation Batch Executed Successfully.");
+    }
+}
+
+// Writes a fresh pairing parameter file: type a (symmetric) or type f (asymmetric, Barreto-Naehrig)
+void paramGen_main(int argc, char **argv) {
+    if (argc < 1) {
+        fprintf(stderr, "Usage: paramGen <output param file> [a|f] [bits]\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char *type = argc > 1 ? argv[1] : "f";
+    int bits = argc > 2 ? atoi(argv[2]) : 160;
+    
+    pbc_param_t param;
+    if (strcmp(type, "a") == 0) {
+        pbc_param_init_a_gen(param, bits, 512);
+    }
+    else if (strcmp(type, "f") == 0) {
+        pbc_param_init_f_gen(param, bits);
+    }
+    else {
+        printf("Error: Unsupported curve type %s\n", type);
+        exit(EXIT_FAILURE);
+    }
+    
+    FILE *param_file = open_file(argv[0], "w");
+    pbc_param_out_str(param_file, param);
+    fclose(param_file);
+    pbc_param_clear(param);
+    
+    if(debug) {
+    printf("Parameter file %s generated.\n", argv[0]);
     }
 }
 
 int main(int argc, char **argv) {
+        arena_install();
+        
+        if (argc > 2 && strcmp(argv[1], "paramGen") == 0) {
+                paramGen_main(argc - 2, argv + 2);
+                return 0;
+        }
+        
+        // Stitching tag shards needs no pairing
+        if (argc > 2 && strcmp(argv[1], "tagMerge") == 0) {
+                tagMerge_main(argc - 2, argv + 2);
+                return 0;
+        }
+        
+        trace_set_command(argv[1]);
+        int span = trace_begin("startup", "initialize");
         myPBC_Initialize(argv[2]);
+        trace_end(span);
         
         if (strcmp(argv[1], "setup") == 0){
 		setup_main();
 	}
 	else if (strcmp(argv[1], "partialKeyGen") == 0){
-		partialKeyGen_main( argc, (argv+2) );
+		partialKeyGen_main( argc - 2, (argv+2) );
 	}
 	else if (strcmp(argv[1], "fullKeyGen") == 0){
-		fullKeyGen_main( argc, (argv+2) );
+		fullKeyGen_main( argc - 2, (argv+2) );
 	}
 	else if (strcmp(argv[1], "tagGen") == 0){
-		tagGen_main( argc, (argv+2) );
+		tagGen_main( argc - 2, (argv+2) );
 	}
 	else if (strcmp(argv[1], "chalGen") == 0){
-		chalGen_main( argc, (argv+2) );
+		chalGen_main( argc - 2, (argv+2) );
 	}
 	else if (strcmp(argv[1], "proofGen") == 0){
-		proofGen_main( argc, (argv+2) );
+		proofGen_main( argc - 2, (argv+2) );
 	}
 	else if (strcmp(argv[1], "verifyProof") == 0){
-		verifyProof_main( argc, (argv+2) );
+		verifyProof_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "verifyTags") == 0){
+		verifyTags_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "proofGenMulti") == 0){
+		proofGenMulti_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "proofGenShard") == 0){
+		proofGenShard_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "proofCombine") == 0){
+		proofCombine_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "partialKeyGenBatch") == 0){
+		partialKeyGenBatch_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "fullKeyGenBatch") == 0){
+		fullKeyGenBatch_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "keyImport") == 0){
+		keyImport_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "keyExport") == 0){
+		keyExport_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "contextGen") == 0){
+		contextGen_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "proofGenFiles") == 0){
+		proofGenFiles_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "verifyProofFiles") == 0){
+		verifyProofFiles_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "locateInit") == 0){
+		locateInit_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "locateProof") == 0){
+		locateProof_main( argc - 2, (argv+2) );
+	}
+	else if (strcmp(argv[1], "locateVerify") == 0){
+		locateVerify_main( argc - 2, (argv+2) );
 	}
 	else{
 		printf("Incorrect Command\n");
 	}
         
         pairing_clear(global_params);
+        trace_flush();
         
 	return 0;
 }
@@ -3,10 +3,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "hash_utils.h"
+#include "trace_utils.h"
+#include "context_utils.h"
+#include "keystore_utils.h"
+#include "checkpoint_utils.h"
+#include "shard_utils.h"
+#include "io_utils.h"
 
 // Opens a file with the specified mode and exits if the file cannot be opened.
-FILE* open_file(char *filename, char *mode) {
-    FILE *file = fopen(filename, mode);
+// Reads of files packed into the loaded context or named by a keystore spec are served from memory.
+FILE* open_file(char *filename, const char *mode) {
+    FILE *file = NULL;
+    if (mode[0] == 'r') {
+        file = audit_context.num_entries ? context_open(filename) : NULL;
+        if (file == NULL) {
+            file = keystore_open_key(filename);
+        }
+    }
+    if (file == NULL) {
+        file = fopen(filename, mode);
+    }
     if (file == NULL) {
         printf("Error opening file: %s\n", filename);
         exit(EXIT_FAILURE);
@@ -29,6 +46,9 @@ void save_element_to_file(element_t X, FILE *fptr) {
         free(bin);
         exit(EXIT_FAILURE);
     }
+    TRACE_COUNT(CNT_BYTES_WRITTEN, size);
+    TRACE_COUNT(CNT_IO_CALLS, 1);
+    TRACE_COUNT(CNT_ALLOCS, 1);
     
     free(bin);
 }
@@ -49,77 +69,195 @@ void read_element_from_file(element_t X, FILE *fptr) {
     }
     
     element_from_bytes(X, bin);
+    TRACE_COUNT(CNT_BYTES_READ, size);
+    TRACE_COUNT(CNT_IO_CALLS, 1);
+    TRACE_COUNT(CNT_ALLOCS, 1);
     free(bin);
 }
 
-// Read integer from file and handle file end
-void read_integer_from_file(FILE* file, char* integer_str, size_t size) {
-    if (!fgets(integer_str, size, file)) {
-        rewind(file);
-        if (!fgets(integer_str, size, file)) {
-            perror("Error reading integer from file");
-            exit(EXIT_FAILURE);
-        }
+// Number of elements moved per batched read or write
+#define ELEM_BATCH 4096
+
+// Caller-owned buffer for batched element (de)serialization. Elements are encoded
+// back to back; pos is the decode cursor and size the number of bytes in use.
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t pos;
+    size_t capacity;
+} ELEMBUF;
+
+void elembuf_init(ELEMBUF *buf, size_t capacity) {
+    buf->data = (unsigned char *) malloc(capacity);
+    if (!buf->data) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
     }
-    
-    size_t len = strlen(integer_str);
-    if (len > 0 && integer_str[len-1] == '\n') {
-        integer_str[len-1] = '\0';
+    TRACE_COUNT(CNT_ALLOCS, 1);
+    buf->size = 0;
+    buf->pos = 0;
+    buf->capacity = capacity;
+}
+
+// Grows the buffer so it can hold at least capacity bytes
+void elembuf_reserve(ELEMBUF *buf, size_t capacity) {
+    if (capacity <= buf->capacity) {
+        return;
     }
+    unsigned char *data = (unsigned char *) realloc(buf->data, capacity);
+    if (!data) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    TRACE_COUNT(CNT_ALLOCS, 1);
+    buf->data = data;
+    buf->capacity = capacity;
 }
 
-// Write sorted numbers to the file
-void write_numbers_to_file(char *filename, int *numbers, int num_blocks) {
-    FILE *file = open_file(filename, "w");
-    
-    for (int i = 0; i < num_blocks; i++) {
-        fprintf(file, "%d\n", numbers[i]);
-        if (ferror(file)) {
-            perror("Error writing to file");
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
+void elembuf_free(ELEMBUF *buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = buf->pos = buf->capacity = 0;
+}
+
+// Appends the encoding of X to the buffer
+void encode_element(ELEMBUF *buf, element_t X) {
+    size_t size = element_length_in_bytes(X);
+    if (buf->size + size > buf->capacity) {
+        elembuf_reserve(buf, buf->size + size > 2 * buf->capacity ? buf->size + size : 2 * buf->capacity);
+    }
+    element_to_bytes(buf->data + buf->size, X);
+    buf->size += size;
+}
+
+// Decodes X at the buffer's cursor
+void decode_element(ELEMBUF *buf, element_t X) {
+    size_t size = element_length_in_bytes(X);
+    if (buf->pos + size > buf->size) {
+        printf("Error: Element buffer underflow\n");
+        exit(EXIT_FAILURE);
     }
+    element_from_bytes(X, buf->data + buf->pos);
+    buf->pos += size;
+}
 
-    fclose(file);
+// Appends the encodings of n elements to the buffer
+void encode_elements(ELEMBUF *buf, element_t *elems, int n) {
+    for (int i = 0; i < n; i++) {
+        encode_element(buf, elems[i]);
+    }
 }
 
-// Function to read the next integer from a file and return its value
-int read_next_integer(FILE *file) {
-    int value;
-    int result = fscanf(file, "%d", &value);
-    if (result == 1) {
-        return value;  // Successfully read an integer
-    } else {
-        if (feof(file)) {
-            //printf("End of file reached.\n");
-        } else {
-            printf("Error reading integer from file.\n");
-        }
-        return -1;  // Return -1 if an error occurs
+// Decodes n elements starting at the buffer's cursor
+void decode_elements(ELEMBUF *buf, element_t *elems, int n) {
+    for (int i = 0; i < n; i++) {
+        decode_element(buf, elems[i]);
     }
 }
 
-// User-defined function to truncate at '@' and concatenate a given string
-void truncate_and_concat(char *ID, char *str) {
-    // Find the '@' character in ID
-    char *at_ptr = strchr(ID, '@');
-    if (at_ptr != NULL) {
-        // Replace '@' with null terminator to truncate the string
-        *at_ptr = '\0';
+// Writes out everything encoded so far with a single call and empties the buffer
+void flush_elements(ELEMBUF *buf, FILE *fptr) {
+    if (buf->size == 0) {
+        return;
+    }
+    if (fwrite(buf->data, 1, buf->size, fptr) != buf->size) {
+        perror("Error saving elements to file");
+        exit(EXIT_FAILURE);
+    }
+    TRACE_COUNT(CNT_BYTES_WRITTEN, buf->size);
+    TRACE_COUNT(CNT_IO_CALLS, 1);
+    buf->size = 0;
+    buf->pos = 0;
+}
+
+// Replaces the buffer contents with the next count encodings of elem_size bytes.
+// Returns the number of whole elements read (less than count only at end of file).
+size_t fill_elements(ELEMBUF *buf, FILE *fptr, size_t elem_size, size_t count) {
+    elembuf_reserve(buf, elem_size * count);
+    size_t got = fread(buf->data, 1, elem_size * count, fptr);
+    TRACE_COUNT(CNT_BYTES_READ, got);
+    TRACE_COUNT(CNT_IO_CALLS, 1);
+    buf->size = got - got % elem_size;
+    buf->pos = 0;
+    return buf->size / elem_size;
+}
+
+// Decodes the next element, refilling the buffer from fptr in ELEM_BATCH chunks when drained
+void next_element_from_file(ELEMBUF *buf, element_t X, FILE *fptr) {
+    size_t size = element_length_in_bytes(X);
+    if (buf->pos + size > buf->size && fill_elements(buf, fptr, size, ELEM_BATCH) == 0) {
+        perror("Error reading from file");
+        exit(EXIT_FAILURE);
+    }
+    decode_element(buf, X);
+}
+
+// Skips the next element of elem_size bytes without decoding it
+void skip_element_from_file(ELEMBUF *buf, size_t elem_size, FILE *fptr) {
+    if (buf->pos + elem_size > buf->size && fill_elements(buf, fptr, elem_size, ELEM_BATCH) == 0) {
+        perror("Error reading from file");
+        exit(EXIT_FAILURE);
+    }
+    buf->pos += elem_size;
+}
+
+// Encodes X and writes the buffer out once ELEM_BATCH elements have accumulated
+void append_element_to_file(ELEMBUF *buf, element_t X, FILE *fptr) {
+    encode_element(buf, X);
+    if (buf->size >= (size_t)element_length_in_bytes(X) * ELEM_BATCH) {
+        flush_elements(buf, fptr);
     }
-    // Concatenate the given string 'str' to the truncated ID
-    strcat(ID, str);
 }
 
 FILE *create_and_open_file(char *id, char *suffix, char *mode) {
-    char filename[50];
+    char filename[4096];
     
-    strcpy(filename, id);
-    truncate_and_concat(filename, suffix);
+    if (!key_file_name(filename, sizeof(filename), id, suffix)) {
+        printf("Error: ID %s is too long for a key file name\n", id);
+        return NULL;
+    }
     FILE *file = fopen(filename, mode);
     if (file == NULL) {
         perror("Error opening file");
     }
     return file;
 }
+
+// Destination of a newly generated key: the per-ID file, or a record in a keystore when store is set
+typedef struct {
+    FILE *file;
+    char *buf;
+    size_t size;
+    char *store;
+    char *id;
+    int kind;
+} KEYWRITER;
+
+FILE *key_writer_open(KEYWRITER *writer, char *store, char *id, int kind) {
+    writer->store = store;
+    writer->id = id;
+    writer->kind = kind;
+    writer->buf = NULL;
+    writer->size = 0;
+    if (store) {
+        writer->file = open_memstream(&writer->buf, &writer->size);
+    }
+    else {
+        writer->file = create_and_open_file(id, (char *) key_kind_suffixes[kind], (char *) "wb");
+    }
+    if (writer->file == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    return writer->file;
+}
+
+void key_writer_close(KEYWRITER *writer) {
+    fclose(writer->file);
+    if (writer->store) {
+        KEYSTORE store;
+        keystore_open_rw(&store, writer->store);
+        keystore_put(&store, writer->id, writer->kind, writer->buf, writer->size);
+        keystore_close(&store);
+        free(writer->buf);
+    }
+}
@@ -0,0 +1,1142 @@
+#include <gmp.h>
+#include <pbc/pbc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX512IFMA__) && defined(__AVX512F__)
+#include <immintrin.h>
+#define FP512_IFMA 1
+#endif
+
+// Fixed-size field backend for the type A curve y^2 = x^3 + x over a prime q of at most 512 bits.
+// Field elements are 8 x 64-bit limbs in Montgomery form (R = 2^512) and points are Jacobian, so a
+// G1 exponentiation runs without GMP calls until the final conversion to affine coordinates.
+// With AVX-512 IFMA the batch entry point runs 8 exponentiations side by side, one per lane,
+// on 10 x 52-bit limbs (R = 2^520). Points cross the PBC boundary as element_to_bytes() output,
+// so results are bit-for-bit those of element_pow_mpz(). Only G1 arithmetic lives here; pairings
+// and GT stay on PBC.
+// There is no AVX2 path: AVX2 has only 32x32-bit multiplies, so a 4-lane product needs 19 x 28-bit
+// limbs and four times the multiplies of the 64-bit mulx loop. Measured at -O2 -march=native, a
+// 4-lane AVX2 Montgomery product costs about as much per lane as the scalar one (0.97x) before its
+// lane transposes and final reduction, so it could only lose against the scalar path.
+
+#define FP512_LIMBS 8
+#define FP512_WINDOW 4
+#define FP512_TABLE (1 << FP512_WINDOW)
+#define FP512_LANES 8
+
+typedef uint64_t fp512[FP512_LIMBS];
+
+typedef struct {
+    fp512 X, Y, Z;      // Z = 0 is the point at infinity
+} FP512POINT;
+
+typedef struct {
+    int ready;
+    int hash_ready;     // hash-to-G1 batches may use the backend
+    size_t bytes;       // length of one coordinate in element_to_bytes()
+    mpz_t q;
+    mpz_t cofactor;     // h, the cofactor of G1 in E(F_q)
+    mpz_t sqrt_exp;     // (q + 1) / 4
+    fp512 p, r2, one;
+    uint64_t n0;        // -p^-1 mod 2^64
+} FP512FIELD;
+
+FP512FIELD fp512_field;
+
+// Plain integer < 2^512 to/from little-endian limbs
+static inline void fp512_from_mpz(fp512 r, const mpz_t z) {
+    memset(r, 0, sizeof(fp512));
+    mpz_export(r, NULL, -1, sizeof(uint64_t), 0, 0, z);
+}
+
+static inline void fp512_to_mpz(mpz_t z, const fp512 a) {
+    mpz_import(z, FP512_LIMBS, -1, sizeof(uint64_t), 0, 0, a);
+}
+
+static inline int fp512_is_zero(const fp512 a) {
+    uint64_t acc = 0;
+    for (int i = 0; i < FP512_LIMBS; i++) {
+        acc |= a[i];
+    }
+    return acc == 0;
+}
+
+// r = a - b over FP512_LIMBS limbs, returns the borrow
+static inline uint64_t fp512_sub_borrow(fp512 r, const fp512 a, const fp512 b) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < FP512_LIMBS; i++) {
+        unsigned __int128 d = (unsigned __int128) a[i] - b[i] - borrow;
+        r[i] = (uint64_t) d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+static inline void fp512_add(fp512 r, const fp512 a, const fp512 b) {
+    fp512 s, d;
+    uint64_t carry = 0;
+    for (int i = 0; i < FP512_LIMBS; i++) {
+        unsigned __int128 t = (unsigned __int128) a[i] + b[i] + carry;
+        s[i] = (uint64_t) t;
+        carry = (uint64_t)(t >> 64);
+    }
+    uint64_t borrow = fp512_sub_borrow(d, s, fp512_field.p);
+    memcpy(r, (carry || !borrow) ? d : s, sizeof(fp512));
+}
+
+static inline void fp512_sub(fp512 r, const fp512 a, const fp512 b) {
+    fp512 d;
+    if (fp512_sub_borrow(d, a, b)) {
+        uint64_t carry = 0;
+        for (int i = 0; i < FP512_LIMBS; i++) {
+            unsigned __int128 t = (unsigned __int128) d[i] + fp512_field.p[i] + carry;
+            d[i] = (uint64_t) t;
+            carry = (uint64_t)(t >> 64);
+        }
+    }
+    memcpy(r, d, sizeof(fp512));
+}
+
+// Montgomery product a * b / 2^512 mod p (CIOS); r may alias a or b
+static inline void fp512_mul(fp512 r, const fp512 a, const fp512 b) {
+    const uint64_t *p = fp512_field.p;
+    uint64_t t[FP512_LIMBS + 2] = {0};
+
+    for (int i = 0; i < FP512_LIMBS; i++) {
+        unsigned __int128 c = 0;
+        // Unrolled so -O2 keeps t in registers; rolled, the loop is about 20% slower
+#pragma GCC unroll 8
+        for (int j = 0; j < FP512_LIMBS; j++) {
+            c = (unsigned __int128) a[j] * b[i] + t[j] + (uint64_t)(c >> 64);
+            t[j] = (uint64_t) c;
+        }
+        c = (unsigned __int128) t[FP512_LIMBS] + (uint64_t)(c >> 64);
+        t[FP512_LIMBS] = (uint64_t) c;
+        t[FP512_LIMBS + 1] = (uint64_t)(c >> 64);
+
+        uint64_t m = t[0] * fp512_field.n0;
+        c = (unsigned __int128) m * p[0] + t[0];
+#pragma GCC unroll 8
+        for (int j = 1; j < FP512_LIMBS; j++) {
+            c = (unsigned __int128) m * p[j] + t[j] + (uint64_t)(c >> 64);
+            t[j - 1] = (uint64_t) c;
+        }
+        c = (unsigned __int128) t[FP512_LIMBS] + (uint64_t)(c >> 64);
+        t[FP512_LIMBS - 1] = (uint64_t) c;
+        t[FP512_LIMBS] = t[FP512_LIMBS + 1] + (uint64_t)(c >> 64);
+    }
+
+    fp512 d;
+    uint64_t borrow = fp512_sub_borrow(d, t, p);
+    memcpy(r, (t[FP512_LIMBS] || !borrow) ? d : t, sizeof(fp512));
+}
+
+static inline void fp512_sqr(fp512 r, const fp512 a) {
+    fp512_mul(r, a, a);
+}
+
+// 2P in Jacobian coordinates for a = 1 (dbl-2007-bl); infinity and 2-torsion map to Z = 0
+void fp512_point_dbl(FP512POINT *r, const FP512POINT *P) {
+    fp512 XX, YY, YYYY, ZZ, S, M, T;
+    fp512_sqr(XX, P->X);
+    fp512_sqr(YY, P->Y);
+    fp512_sqr(YYYY, YY);
+    fp512_sqr(ZZ, P->Z);
+
+    fp512_add(S, P->X, YY);
+    fp512_sqr(S, S);
+    fp512_sub(S, S, XX);
+    fp512_sub(S, S, YYYY);
+    fp512_add(S, S, S);
+
+    fp512_sqr(M, ZZ);
+    fp512_add(M, M, XX);
+    fp512_add(M, M, XX);
+    fp512_add(M, M, XX);
+
+    fp512_add(r->Z, P->Y, P->Z);
+    fp512_sqr(r->Z, r->Z);
+    fp512_sub(r->Z, r->Z, YY);
+    fp512_sub(r->Z, r->Z, ZZ);
+
+    fp512_sqr(T, M);
+    fp512_sub(T, T, S);
+    fp512_sub(T, T, S);
+    fp512_sub(S, S, T);
+    fp512_mul(S, M, S);
+    fp512_add(YYYY, YYYY, YYYY);
+    fp512_add(YYYY, YYYY, YYYY);
+    fp512_add(YYYY, YYYY, YYYY);
+    fp512_sub(r->Y, S, YYYY);
+    memcpy(r->X, T, sizeof(fp512));
+}
+
+// P + Q in Jacobian coordinates (add-2007-bl), including the doubling and inverse cases
+void fp512_point_add(FP512POINT *r, const FP512POINT *P, const FP512POINT *Q) {
+    if (fp512_is_zero(P->Z)) {
+        *r = *Q;
+        return;
+    }
+    if (fp512_is_zero(Q->Z)) {
+        *r = *P;
+        return;
+    }
+    fp512 Z1Z1, Z2Z2, U1, U2, S1, S2, H, I, J, R, V;
+    fp512_sqr(Z1Z1, P->Z);
+    fp512_sqr(Z2Z2, Q->Z);
+    fp512_mul(U1, P->X, Z2Z2);
+    fp512_mul(U2, Q->X, Z1Z1);
+    fp512_mul(S1, P->Y, Q->Z);
+    fp512_mul(S1, S1, Z2Z2);
+    fp512_mul(S2, Q->Y, P->Z);
+    fp512_mul(S2, S2, Z1Z1);
+    fp512_sub(H, U2, U1);
+    fp512_sub(R, S2, S1);
+
+    if (fp512_is_zero(H)) {
+        if (fp512_is_zero(R)) {
+            fp512_point_dbl(r, P);
+        }
+        else {
+            memset(r, 0, sizeof(*r));
+        }
+        return;
+    }
+
+    fp512_add(I, H, H);
+    fp512_sqr(I, I);
+    fp512_mul(J, H, I);
+    fp512_add(R, R, R);
+    fp512_mul(V, U1, I);
+
+    fp512 Z3;
+    fp512_add(Z3, P->Z, Q->Z);
+    fp512_sqr(Z3, Z3);
+    fp512_sub(Z3, Z3, Z1Z1);
+    fp512_sub(Z3, Z3, Z2Z2);
+    fp512_mul(r->Z, Z3, H);
+
+    fp512_sqr(r->X, R);
+    fp512_sub(r->X, r->X, J);
+    fp512_sub(r->X, r->X, V);
+    fp512_sub(r->X, r->X, V);
+
+    fp512_sub(V, V, r->X);
+    fp512_mul(V, R, V);
+    fp512_mul(S1, S1, J);
+    fp512_add(S1, S1, S1);
+    fp512_sub(r->Y, V, S1);
+}
+
+static const fp512 fp512_plain_one = {1};
+static const fp512 fp512_zero = {0};
+
+// Big-endian coordinate of fp512_field.bytes bytes to/from a plain integer
+static inline void fp512_from_bytes(fp512 r, const unsigned char *bytes) {
+    memset(r, 0, sizeof(fp512));
+    for (size_t i = 0; i < fp512_field.bytes; i++) {
+        r[i / 8] |= (uint64_t) bytes[fp512_field.bytes - 1 - i] << (8 * (i % 8));
+    }
+}
+
+static inline void fp512_to_bytes(unsigned char *bytes, const fp512 a) {
+    for (size_t i = 0; i < fp512_field.bytes; i++) {
+        bytes[fp512_field.bytes - 1 - i] = (unsigned char)(a[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+// Affine x || y bytes to a Jacobian point in Montgomery form
+void fp512_point_load(FP512POINT *r, const unsigned char *bytes) {
+    fp512_from_bytes(r->X, bytes);
+    fp512_from_bytes(r->Y, bytes + fp512_field.bytes);
+    fp512_mul(r->X, r->X, fp512_field.r2);
+    fp512_mul(r->Y, r->Y, fp512_field.r2);
+    memcpy(r->Z, fp512_field.one, sizeof(fp512));
+}
+
+// Inverse in Montgomery form, through GMP
+void fp512_inv(fp512 r, const fp512 a) {
+    fp512 t;
+    mpz_t z;
+    mpz_init(z);
+    fp512_mul(t, a, fp512_plain_one);
+    fp512_to_mpz(z, t);
+    mpz_invert(z, z, fp512_field.q);
+    fp512_from_mpz(t, z);
+    mpz_clear(z);
+    fp512_mul(r, t, fp512_field.r2);
+}
+
+// Jacobian points to affine x || y bytes with one inversion for all of them (Montgomery's trick);
+// finite[i] is 0 where P[i] is the point at infinity
+void fp512_points_store(unsigned char **out, const FP512POINT *P, int *finite, int n) {
+    fp512 *prefix = (fp512 *) malloc((n > 0 ? n : 1) * sizeof(fp512));
+    fp512 acc, inv, zinv, zz, t;
+    memcpy(acc, fp512_field.one, sizeof(fp512));
+    for (int i = 0; i < n; i++) {
+        finite[i] = !fp512_is_zero(P[i].Z);
+        memcpy(prefix[i], acc, sizeof(fp512));
+        if (finite[i]) {
+            fp512_mul(acc, acc, P[i].Z);
+        }
+    }
+    fp512_inv(inv, acc);
+
+    for (int i = n - 1; i >= 0; i--) {
+        if (!finite[i]) {
+            continue;
+        }
+        fp512_mul(zinv, inv, prefix[i]);
+        fp512_mul(inv, inv, P[i].Z);
+        fp512_sqr(zz, zinv);
+        fp512_mul(t, P[i].X, zz);
+        fp512_mul(t, t, fp512_plain_one);
+        fp512_to_bytes(out[i], t);
+        fp512_mul(zz, zz, zinv);
+        fp512_mul(t, P[i].Y, zz);
+        fp512_mul(t, t, fp512_plain_one);
+        fp512_to_bytes(out[i] + fp512_field.bytes, t);
+    }
+    free(prefix);
+}
+
+// Window digit at position w (FP512_WINDOW bits) of |e|; windows never straddle a limb
+static inline unsigned fp512_digit(mpz_srcptr e, size_t w) {
+    size_t bit = w * FP512_WINDOW;
+    return (unsigned)(mpz_getlimbn(e, bit / GMP_NUMB_BITS) >> (bit % GMP_NUMB_BITS)) & (FP512_TABLE - 1);
+}
+
+static inline size_t fp512_windows(mpz_srcptr e) {
+    return mpz_sgn(e) ? (mpz_sizeinbase(e, 2) + FP512_WINDOW - 1) / FP512_WINDOW : 0;
+}
+
+// r = a^e in the field for e >= 0, fixed 4-bit window
+void fp512_pow(fp512 r, const fp512 a, mpz_srcptr e) {
+    fp512 table[FP512_TABLE], acc;
+    memcpy(table[0], fp512_field.one, sizeof(fp512));
+    for (int i = 1; i < FP512_TABLE; i++) {
+        fp512_mul(table[i], table[i - 1], a);
+    }
+    memcpy(acc, fp512_field.one, sizeof(fp512));
+    for (size_t w = fp512_windows(e); w-- > 0; ) {
+        for (int b = 0; b < FP512_WINDOW; b++) {
+            fp512_sqr(acc, acc);
+        }
+        fp512_mul(acc, acc, table[fp512_digit(e, w)]);
+    }
+    memcpy(r, acc, sizeof(fp512));
+}
+
+// r = e * P on Jacobian points with a fixed 4-bit window; r may alias P
+void fp512_point_pow(FP512POINT *r, const FP512POINT *P, mpz_srcptr e) {
+    FP512POINT table[FP512_TABLE], acc;
+    memset(&acc, 0, sizeof(acc));
+    table[1] = *P;
+    fp512_point_dbl(&table[2], &table[1]);
+    for (int i = 3; i < FP512_TABLE; i++) {
+        fp512_point_add(&table[i], &table[i - 1], &table[1]);
+    }
+
+    for (size_t w = fp512_windows(e); w-- > 0; ) {
+        for (int b = 0; b < FP512_WINDOW; b++) {
+            fp512_point_dbl(&acc, &acc);
+        }
+        unsigned d = fp512_digit(e, w);
+        if (d) {
+            fp512_point_add(&acc, &acc, &table[d]);
+        }
+    }
+    if (mpz_sgn(e) < 0) {
+        fp512_sub(acc.Y, fp512_zero, acc.Y);
+    }
+    *r = acc;
+}
+
+#ifdef FP512_IFMA
+
+// 8 field elements, one per lane, as 10 x 52-bit limbs in Montgomery form (R = 2^520)
+#define FPV_LIMBS 10
+#define FPV_MASK ((1ULL << 52) - 1)
+
+typedef struct {
+    __m512i l[FPV_LIMBS];
+} FPV;
+
+typedef struct {
+    FPV X, Y, Z;
+} FPVPOINT;
+
+typedef struct {
+    uint64_t p[FPV_LIMBS], r2[FPV_LIMBS], n0;
+} FPVFIELD;
+
+FPVFIELD fpv_field;
+
+// 8 x 64-bit limbs to 10 x 52-bit limbs and back
+static inline void fpv_split(uint64_t *l, const fp512 a) {
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        int bit = 52 * j, w = bit / 64, s = bit % 64;
+        uint64_t v = a[w] >> s;
+        if (s > 12 && w + 1 < FP512_LIMBS) {
+            v |= a[w + 1] << (64 - s);
+        }
+        l[j] = v & FPV_MASK;
+    }
+}
+
+static inline void fpv_join(fp512 a, const uint64_t *l) {
+    memset(a, 0, sizeof(fp512));
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        int bit = 52 * j, w = bit / 64, s = bit % 64;
+        a[w] |= l[j] << s;
+        if (s > 12 && w + 1 < FP512_LIMBS) {
+            a[w + 1] |= l[j] >> (64 - s);
+        }
+    }
+}
+
+static inline void fpv_broadcast(FPV *r, const uint64_t *l) {
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        r->l[j] = _mm512_set1_epi64((long long) l[j]);
+    }
+}
+
+// Subtracts p from lanes where t >= p; t must be normalised and below 2p
+static inline void fpv_reduce(FPV *r, const __m512i *t) {
+    const __m512i mask = _mm512_set1_epi64(FPV_MASK);
+    __m512i d[FPV_LIMBS], borrow = _mm512_setzero_si512();
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        d[j] = _mm512_sub_epi64(_mm512_sub_epi64(t[j], _mm512_set1_epi64((long long) fpv_field.p[j])), borrow);
+        borrow = _mm512_srli_epi64(d[j], 63);
+        d[j] = _mm512_and_si512(d[j], mask);
+    }
+    __mmask8 keep = _mm512_test_epi64_mask(borrow, borrow);
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        r->l[j] = _mm512_mask_blend_epi64(keep, d[j], t[j]);
+    }
+}
+
+// Lane-wise Montgomery product a * b / 2^520 mod p; r may alias a or b
+static inline void fpv_mul(FPV *r, const FPV *a, const FPV *b) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i mask = _mm512_set1_epi64(FPV_MASK);
+    const __m512i n0 = _mm512_set1_epi64((long long) fpv_field.n0);
+    __m512i t[FPV_LIMBS + 1];
+    for (int j = 0; j <= FPV_LIMBS; j++) {
+        t[j] = zero;
+    }
+
+    for (int i = 0; i < FPV_LIMBS; i++) {
+        __m512i bi = b->l[i];
+        for (int j = 0; j < FPV_LIMBS; j++) {
+            t[j] = _mm512_madd52lo_epu64(t[j], a->l[j], bi);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], a->l[j], bi);
+        }
+        __m512i m = _mm512_madd52lo_epu64(zero, t[0], n0);
+        for (int j = 0; j < FPV_LIMBS; j++) {
+            __m512i pj = _mm512_set1_epi64((long long) fpv_field.p[j]);
+            t[j] = _mm512_madd52lo_epu64(t[j], pj, m);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], pj, m);
+        }
+        // The low 52 bits of t[0] are now zero: carry the rest up and shift down one limb
+        t[1] = _mm512_add_epi64(t[1], _mm512_srli_epi64(t[0], 52));
+        for (int j = 0; j < FPV_LIMBS; j++) {
+            t[j] = t[j + 1];
+        }
+        t[FPV_LIMBS] = zero;
+    }
+
+    for (int j = 0; j < FPV_LIMBS - 1; j++) {
+        t[j + 1] = _mm512_add_epi64(t[j + 1], _mm512_srli_epi64(t[j], 52));
+        t[j] = _mm512_and_si512(t[j], mask);
+    }
+    fpv_reduce(r, t);
+}
+
+static inline void fpv_add(FPV *r, const FPV *a, const FPV *b) {
+    const __m512i mask = _mm512_set1_epi64(FPV_MASK);
+    __m512i t[FPV_LIMBS], carry = _mm512_setzero_si512();
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        t[j] = _mm512_add_epi64(_mm512_add_epi64(a->l[j], b->l[j]), carry);
+        carry = _mm512_srli_epi64(t[j], 52);
+        t[j] = _mm512_and_si512(t[j], mask);
+    }
+    // a + b < 2p < 2^520, so nothing carries out of the top limb
+    fpv_reduce(r, t);
+}
+
+static inline void fpv_sub(FPV *r, const FPV *a, const FPV *b) {
+    const __m512i mask = _mm512_set1_epi64(FPV_MASK);
+    __m512i d[FPV_LIMBS], borrow = _mm512_setzero_si512(), carry = _mm512_setzero_si512();
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        d[j] = _mm512_sub_epi64(_mm512_sub_epi64(a->l[j], b->l[j]), borrow);
+        borrow = _mm512_srli_epi64(d[j], 63);
+        d[j] = _mm512_and_si512(d[j], mask);
+    }
+    __mmask8 wrap = _mm512_test_epi64_mask(borrow, borrow);
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        __m512i s = _mm512_add_epi64(_mm512_add_epi64(d[j], _mm512_set1_epi64((long long) fpv_field.p[j])), carry);
+        carry = _mm512_srli_epi64(s, 52);
+        r->l[j] = _mm512_mask_blend_epi64(wrap, d[j], _mm512_and_si512(s, mask));
+    }
+}
+
+static inline __mmask8 fpv_is_zero(const FPV *a) {
+    __m512i acc = a->l[0];
+    for (int j = 1; j < FPV_LIMBS; j++) {
+        acc = _mm512_or_si512(acc, a->l[j]);
+    }
+    return _mm512_testn_epi64_mask(acc, acc);
+}
+
+static inline void fpv_blend(FPV *r, __mmask8 k, const FPV *a, const FPV *b) {
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        r->l[j] = _mm512_mask_blend_epi64(k, a->l[j], b->l[j]);
+    }
+}
+
+static inline void fpv_point_blend(FPVPOINT *r, __mmask8 k, const FPVPOINT *a, const FPVPOINT *b) {
+    fpv_blend(&r->X, k, &a->X, &b->X);
+    fpv_blend(&r->Y, k, &a->Y, &b->Y);
+    fpv_blend(&r->Z, k, &a->Z, &b->Z);
+}
+
+// Lane-wise twin of fp512_point_dbl()
+void fpv_point_dbl(FPVPOINT *r, const FPVPOINT *P) {
+    FPV XX, YY, YYYY, ZZ, S, M, T;
+    fpv_mul(&XX, &P->X, &P->X);
+    fpv_mul(&YY, &P->Y, &P->Y);
+    fpv_mul(&YYYY, &YY, &YY);
+    fpv_mul(&ZZ, &P->Z, &P->Z);
+
+    fpv_add(&S, &P->X, &YY);
+    fpv_mul(&S, &S, &S);
+    fpv_sub(&S, &S, &XX);
+    fpv_sub(&S, &S, &YYYY);
+    fpv_add(&S, &S, &S);
+
+    fpv_mul(&M, &ZZ, &ZZ);
+    fpv_add(&M, &M, &XX);
+    fpv_add(&M, &M, &XX);
+    fpv_add(&M, &M, &XX);
+
+    fpv_add(&r->Z, &P->Y, &P->Z);
+    fpv_mul(&r->Z, &r->Z, &r->Z);
+    fpv_sub(&r->Z, &r->Z, &YY);
+    fpv_sub(&r->Z, &r->Z, &ZZ);
+
+    fpv_mul(&T, &M, &M);
+    fpv_sub(&T, &T, &S);
+    fpv_sub(&T, &T, &S);
+    fpv_sub(&S, &S, &T);
+    fpv_mul(&S, &M, &S);
+    fpv_add(&YYYY, &YYYY, &YYYY);
+    fpv_add(&YYYY, &YYYY, &YYYY);
+    fpv_add(&YYYY, &YYYY, &YYYY);
+    fpv_sub(&r->Y, &S, &YYYY);
+    r->X = T;
+}
+
+// Lane-wise generic addition; returns the lanes of active that hit an input at infinity or P = +-Q,
+// which the formula does not cover and the caller recomputes with the scalar code
+__mmask8 fpv_point_add(FPVPOINT *r, const FPVPOINT *P, const FPVPOINT *Q, __mmask8 active) {
+    FPV Z1Z1, Z2Z2, U1, U2, S1, S2, H, I, J, R, V, Z3;
+    fpv_mul(&Z1Z1, &P->Z, &P->Z);
+    fpv_mul(&Z2Z2, &Q->Z, &Q->Z);
+    fpv_mul(&U1, &P->X, &Z2Z2);
+    fpv_mul(&U2, &Q->X, &Z1Z1);
+    fpv_mul(&S1, &P->Y, &Q->Z);
+    fpv_mul(&S1, &S1, &Z2Z2);
+    fpv_mul(&S2, &Q->Y, &P->Z);
+    fpv_mul(&S2, &S2, &Z1Z1);
+    fpv_sub(&H, &U2, &U1);
+    fpv_sub(&R, &S2, &S1);
+    __mmask8 bad = active & (fpv_is_zero(&H) | fpv_is_zero(&P->Z) | fpv_is_zero(&Q->Z));
+
+    fpv_add(&I, &H, &H);
+    fpv_mul(&I, &I, &I);
+    fpv_mul(&J, &H, &I);
+    fpv_add(&R, &R, &R);
+    fpv_mul(&V, &U1, &I);
+
+    fpv_add(&Z3, &P->Z, &Q->Z);
+    fpv_mul(&Z3, &Z3, &Z3);
+    fpv_sub(&Z3, &Z3, &Z1Z1);
+    fpv_sub(&Z3, &Z3, &Z2Z2);
+    fpv_mul(&r->Z, &Z3, &H);
+
+    fpv_mul(&r->X, &R, &R);
+    fpv_sub(&r->X, &r->X, &J);
+    fpv_sub(&r->X, &r->X, &V);
+    fpv_sub(&r->X, &r->X, &V);
+
+    fpv_sub(&V, &V, &r->X);
+    fpv_mul(&V, &R, &V);
+    fpv_mul(&S1, &S1, &J);
+    fpv_add(&S1, &S1, &S1);
+    fpv_sub(&r->Y, &V, &S1);
+    return bad;
+}
+
+// Per-lane table lookup: lane i takes table[digits[i]]
+static inline void fpv_point_gather(FPVPOINT *r, const FPVPOINT *table, __m512i digits) {
+    const long long stride = sizeof(FPVPOINT) / sizeof(uint64_t);
+    __m512i index = _mm512_add_epi64(_mm512_mul_epu32(digits, _mm512_set1_epi64(stride)),
+                                     _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        r->X.l[j] = _mm512_i64gather_epi64(index, (const void *) &table[0].X.l[j], 8);
+        r->Y.l[j] = _mm512_i64gather_epi64(index, (const void *) &table[0].Y.l[j], 8);
+        r->Z.l[j] = _mm512_i64gather_epi64(index, (const void *) &table[0].Z.l[j], 8);
+    }
+}
+
+
+// Scalar Montgomery values (R = 2^512) into lanes (R = 2^520); lanes past n repeat src[0]
+static inline void fpv_load(FPV *r, const uint64_t **src, int n) {
+    uint64_t limbs[FPV_LIMBS][FP512_LANES];
+    for (int i = 0; i < FP512_LANES; i++) {
+        fp512 plain;
+        uint64_t l[FPV_LIMBS];
+        fp512_mul(plain, src[i < n ? i : 0], fp512_plain_one);
+        fpv_split(l, plain);
+        for (int j = 0; j < FPV_LIMBS; j++) {
+            limbs[j][i] = l[j];
+        }
+    }
+    FPV r2;
+    fpv_broadcast(&r2, fpv_field.r2);
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        r->l[j] = _mm512_loadu_si512((const void *) limbs[j]);
+    }
+    fpv_mul(r, r, &r2);
+}
+
+// Lanes back to scalar Montgomery values, for the first n lanes
+static inline void fpv_store(uint64_t **dst, const FPV *v, int n) {
+    uint64_t limbs[FPV_LIMBS][FP512_LANES], plain_one[FPV_LIMBS] = {1};
+    FPV one, t;
+    fpv_broadcast(&one, plain_one);
+    fpv_mul(&t, v, &one);
+    for (int j = 0; j < FPV_LIMBS; j++) {
+        _mm512_storeu_si512((void *) limbs[j], t.l[j]);
+    }
+    for (int i = 0; i < n; i++) {
+        uint64_t l[FPV_LIMBS];
+        for (int j = 0; j < FPV_LIMBS; j++) {
+            l[j] = limbs[j][i];
+        }
+        fpv_join(dst[i], l);
+        fp512_mul(dst[i], dst[i], fp512_field.r2);
+    }
+}
+
+// Lane-wise twin of fp512_pow(), with one exponent for all lanes
+void fpv_pow(FPV *r, const FPV *a, mpz_srcptr e) {
+    FPV *table = (FPV *) _mm_malloc(FP512_TABLE * sizeof(FPV), 64);
+    FPV r2, acc;
+    uint64_t plain_one[FPV_LIMBS] = {1};
+    fpv_broadcast(&table[0], plain_one);
+    fpv_broadcast(&r2, fpv_field.r2);
+    fpv_mul(&table[0], &table[0], &r2);
+    for (int i = 1; i < FP512_TABLE; i++) {
+        fpv_mul(&table[i], &table[i - 1], a);
+    }
+    acc = table[0];
+    for (size_t w = fp512_windows(e); w-- > 0; ) {
+        for (int b = 0; b < FP512_WINDOW; b++) {
+            fpv_mul(&acc, &acc, &acc);
+        }
+        fpv_mul(&acc, &acc, &table[fp512_digit(e, w)]);
+    }
+    *r = acc;
+    _mm_free(table);
+}
+
+// Up to 8 point exponentiations in lockstep; r must not alias P
+void fpv_point_pow_lanes(FP512POINT *r, const FP512POINT *P, mpz_srcptr *e, int n) {
+    FPVPOINT *table = (FPVPOINT *) _mm_malloc(FP512_TABLE * sizeof(FPVPOINT), 64);
+    FPVPOINT acc, G, S;
+    const uint64_t *src[3][FP512_LANES];
+    uint64_t *dst[3][FP512_LANES];
+    size_t windows = 0;
+
+    for (int i = 0; i < n; i++) {
+        src[0][i] = P[i].X;
+        src[1][i] = P[i].Y;
+        src[2][i] = P[i].Z;
+        dst[0][i] = r[i].X;
+        dst[1][i] = r[i].Y;
+        dst[2][i] = r[i].Z;
+        if (fp512_windows(e[i]) > windows) {
+            windows = fp512_windows(e[i]);
+        }
+    }
+    memset(table, 0, FP512_TABLE * sizeof(FPVPOINT));
+    fpv_load(&table[1].X, src[0], n);
+    fpv_load(&table[1].Y, src[1], n);
+    fpv_load(&table[1].Z, src[2], n);
+
+    __mmask8 bad = 0;
+    fpv_point_dbl(&table[2], &table[1]);
+    for (int i = 3; i < FP512_TABLE; i++) {
+        bad |= fpv_point_add(&table[i], &table[i - 1], &table[1], 0xff);
+    }
+
+    memset(&acc, 0, sizeof(acc));
+    __mmask8 started = 0;
+    for (size_t w = windows; w-- > 0; ) {
+        for (int b = 0; b < FP512_WINDOW; b++) {
+            fpv_point_dbl(&acc, &acc);
+        }
+        uint64_t d[FP512_LANES];
+        for (int i = 0; i < FP512_LANES; i++) {
+            d[i] = i < n ? fp512_digit(e[i], w) : 0;
+        }
+        __m512i digits = _mm512_loadu_si512((const void *) d);
+        __mmask8 nonzero = _mm512_test_epi64_mask(digits, digits);
+        __mmask8 add = started & nonzero, start = ~started & nonzero;
+
+        fpv_point_gather(&G, table, digits);
+        bad |= fpv_point_add(&S, &acc, &G, add);
+        fpv_point_blend(&acc, add, &acc, &S);
+        fpv_point_blend(&acc, start, &acc, &G);
+        started |= start;
+    }
+    _mm_free(table);
+
+    fpv_store(dst[0], &acc.X, n);
+    fpv_store(dst[1], &acc.Y, n);
+    fpv_store(dst[2], &acc.Z, n);
+    for (int i = 0; i < n; i++) {
+        if (bad & (1 << i)) {
+            fp512_point_pow(&r[i], &P[i], e[i]);
+        }
+        else if (mpz_sgn(e[i]) < 0) {
+            fp512_sub(r[i].Y, fp512_zero, r[i].Y);
+        }
+    }
+}
+
+#endif
+
+// r[i] = a[i]^e in the field, 8 lanes at a time where IFMA is available
+void fp512_pows(fp512 *r, const fp512 *a, mpz_srcptr e, int n) {
+#ifdef FP512_IFMA
+    for (int i = 0; i < n; i += FP512_LANES) {
+        int m = n - i < FP512_LANES ? n - i : FP512_LANES;
+        const uint64_t *src[FP512_LANES];
+        uint64_t *dst[FP512_LANES];
+        for (int k = 0; k < m; k++) {
+            src[k] = a[i + k];
+            dst[k] = r[i + k];
+        }
+        FPV v;
+        fpv_load(&v, src, m);
+        fpv_pow(&v, &v, e);
+        fpv_store(dst, &v, m);
+    }
+#else
+    for (int i = 0; i < n; i++) {
+        fp512_pow(r[i], a[i], e);
+    }
+#endif
+}
+
+// r[i] = e[i] * P[i]; r must not alias P
+void fp512_points_pow(FP512POINT *r, const FP512POINT *P, mpz_srcptr *e, int n) {
+#ifdef FP512_IFMA
+    for (int i = 0; i < n; i += FP512_LANES) {
+        fpv_point_pow_lanes(r + i, P + i, e + i, n - i < FP512_LANES ? n - i : FP512_LANES);
+    }
+#else
+    for (int i = 0; i < n; i++) {
+        fp512_point_pow(&r[i], &P[i], e[i]);
+    }
+#endif
+}
+
+// Finishes PBC's type A hash-to-G1 from the hashed x coordinates: while x^3 + x is not a square,
+// x = x^2 + 1; y is the odd square root; the point is then multiplied by the cofactor. The square
+// roots t^((q+1)/4) of all pending candidates run as one batch per retry round.
+void fp512_points_from_x(FP512POINT *r, const fp512 *x, int n) {
+    FP512POINT *P = (FP512POINT *) malloc((n > 0 ? n : 1) * sizeof(FP512POINT));
+    fp512 *t = (fp512 *) malloc((n > 0 ? n : 1) * sizeof(fp512));
+    fp512 *s = (fp512 *) malloc((n > 0 ? n : 1) * sizeof(fp512));
+    int *pending = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+    mpz_srcptr *cofactor = (mpz_srcptr *) malloc((n > 0 ? n : 1) * sizeof(mpz_srcptr));
+
+    for (int i = 0; i < n; i++) {
+        fp512_mul(P[i].X, x[i], fp512_field.r2);
+        memcpy(P[i].Z, fp512_field.one, sizeof(fp512));
+        pending[i] = i;
+        cofactor[i] = fp512_field.cofactor;
+    }
+    for (int m = n; m > 0; ) {
+        for (int k = 0; k < m; k++) {
+            fp512 *X = &P[pending[k]].X;
+            fp512_sqr(t[k], *X);
+            fp512_add(t[k], t[k], fp512_field.one);
+            fp512_mul(t[k], t[k], *X);
+        }
+        fp512_pows(s, t, fp512_field.sqrt_exp, m);
+
+        int next = 0;
+        for (int k = 0; k < m; k++) {
+            FP512POINT *Q = &P[pending[k]];
+            fp512 check;
+            fp512_sqr(check, s[k]);
+            if (memcmp(check, t[k], sizeof(fp512)) == 0) {
+                fp512 plain;
+                fp512_mul(plain, s[k], fp512_plain_one);
+                if (plain[0] & 1) {
+                    memcpy(Q->Y, s[k], sizeof(fp512));
+                }
+                else {
+                    fp512_sub(Q->Y, fp512_zero, s[k]);
+                }
+            }
+            else {
+                fp512_sqr(Q->X, Q->X);
+                fp512_add(Q->X, Q->X, fp512_field.one);
+                pending[next++] = pending[k];
+            }
+        }
+        m = next;
+    }
+    fp512_points_pow(r, P, cofactor, n);
+
+    free(P);
+    free(t);
+    free(s);
+    free(pending);
+    free(cofactor);
+}
+
+// Derives the Montgomery constants for q; returns 0 when q is not an odd prime of at most 512 bits
+int fp512_init(const mpz_t q, size_t bytes) {
+    if (mpz_sgn(q) <= 0 || mpz_even_p(q) || mpz_sizeinbase(q, 2) > 512 || bytes > 64) {
+        return 0;
+    }
+    static int initialized = 0;
+    if (!initialized) {
+        mpz_inits(fp512_field.q, fp512_field.cofactor, fp512_field.sqrt_exp, NULL);
+        initialized = 1;
+    }
+    mpz_set(fp512_field.q, q);
+    fp512_field.bytes = bytes;
+    fp512_from_mpz(fp512_field.p, q);
+
+    // n0 = -q^-1 mod 2^64 by Newton iteration
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; i++) {
+        inv *= 2 - fp512_field.p[0] * inv;
+    }
+    fp512_field.n0 = -inv;
+
+    mpz_t t;
+    mpz_init(t);
+    mpz_setbit(t, 512);
+    mpz_mod(t, t, q);
+    fp512_from_mpz(fp512_field.one, t);
+    mpz_set_ui(t, 0);
+    mpz_setbit(t, 1024);
+    mpz_mod(t, t, q);
+    fp512_from_mpz(fp512_field.r2, t);
+    mpz_add_ui(fp512_field.sqrt_exp, q, 1);
+    mpz_fdiv_q_2exp(fp512_field.sqrt_exp, fp512_field.sqrt_exp, 2);
+
+#ifdef FP512_IFMA
+    fp512 limbs;
+    fpv_split(fpv_field.p, fp512_field.p);
+    mpz_set_ui(t, 0);
+    mpz_setbit(t, 1040);
+    mpz_mod(t, t, q);
+    fp512_from_mpz(limbs, t);
+    fpv_split(fpv_field.r2, limbs);
+    fpv_field.n0 = fp512_field.n0 & FPV_MASK;
+#endif
+    mpz_clear(t);
+    fp512_field.ready = 1;
+    return 1;
+}
+
+// PBC wrappers: out[i] = base[i]^e[i] in G1, on PBC itself when the backend is off
+void fp512_element_pow_batch(element_ptr *out, element_ptr *base, mpz_t *e, int n) {
+    if (!fp512_field.ready) {
+        for (int i = 0; i < n; i++) {
+            element_pow_mpz(out[i], base[i], e[i]);
+        }
+        return;
+    }
+    FP512POINT *P = (FP512POINT *) malloc((n > 0 ? n : 1) * sizeof(FP512POINT));
+    FP512POINT *R = (FP512POINT *) calloc(n > 0 ? n : 1, sizeof(FP512POINT));
+    unsigned char *bytes = (unsigned char *) malloc((n > 0 ? n : 1) * 2 * fp512_field.bytes);
+    unsigned char **res = (unsigned char **) malloc((n > 0 ? n : 1) * sizeof(unsigned char *));
+    mpz_srcptr *exps = (mpz_srcptr *) malloc((n > 0 ? n : 1) * sizeof(mpz_srcptr));
+    int *lane = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+    int *finite = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        if (element_is0(base[i])) {
+            element_set0(out[i]);
+            continue;
+        }
+        res[k] = bytes + (size_t) k * 2 * fp512_field.bytes;
+        element_to_bytes(res[k], base[i]);
+        fp512_point_load(&P[k], res[k]);
+        exps[k] = e[i];
+        lane[k++] = i;
+    }
+    fp512_points_pow(R, P, exps, k);
+    fp512_points_store(res, R, finite, k);
+    for (int j = 0; j < k; j++) {
+        if (finite[j]) {
+            element_from_bytes(out[lane[j]], res[j]);
+        }
+        else {
+            element_set0(out[lane[j]]);
+        }
+    }
+
+    free(P);
+    free(R);
+    free(bytes);
+    free(res);
+    free(exps);
+    free(lane);
+    free(finite);
+}
+
+void fp512_element_pow_mpz(element_t out, element_t base, mpz_t e) {
+    element_ptr o = out, b = base;
+    fp512_element_pow_batch(&o, &b, (mpz_t *) e, 1);
+}
+
+// out[i] = element_from_hash(data[i], len[i]) in G1 for n messages. PBC still hashes each message
+// to its x coordinate; the square roots, cofactor multiplications and inversions are batched.
+void fp512_element_from_hash_batch(element_ptr *out, char **data, int *len, int n) {
+    if (!fp512_field.hash_ready || n == 0) {
+        for (int i = 0; i < n; i++) {
+            element_from_hash(out[i], data[i], len[i]);
+        }
+        return;
+    }
+    fp512 *x = (fp512 *) malloc(n * sizeof(fp512));
+    FP512POINT *R = (FP512POINT *) malloc(n * sizeof(FP512POINT));
+    unsigned char *bytes = (unsigned char *) malloc((size_t) n * 2 * fp512_field.bytes);
+    unsigned char **res = (unsigned char **) malloc(n * sizeof(unsigned char *));
+    int *finite = (int *) malloc(n * sizeof(int));
+
+    element_t xe;
+    element_init_same_as(xe, element_x(out[0]));
+    for (int i = 0; i < n; i++) {
+        res[i] = bytes + (size_t) i * 2 * fp512_field.bytes;
+        element_from_hash(xe, data[i], len[i]);
+        element_to_bytes(res[i], xe);
+        fp512_from_bytes(x[i], res[i]);
+    }
+    element_clear(xe);
+
+    fp512_points_from_x(R, x, n);
+    fp512_points_store(res, R, finite, n);
+    for (int i = 0; i < n; i++) {
+        if (finite[i]) {
+            element_from_bytes(out[i], res[i]);
+        }
+        else {
+            element_set0(out[i]);
+        }
+    }
+
+    free(x);
+    free(R);
+    free(bytes);
+    free(res);
+    free(finite);
+}
+
+#define FP512_PROBE_POINTS 3
+#define FP512_PROBE_EXPS 10
+
+// Known-answer test of the exponentiation paths against element_pow_mpz(): exponents at the edges of
+// the window loop (0, 1, r - 1, r, an all-ones value as wide as r) and some in between, on a few
+// points. All of them go through one batch, which covers full IFMA lane groups and a tail, and the
+// first point also through the single-exponent path.
+int fp512_probe_pow(pairing_t pairing) {
+    element_t probe[FP512_PROBE_POINTS], expect[FP512_PROBE_POINTS * FP512_PROBE_EXPS];
+    element_t got[FP512_PROBE_POINTS * FP512_PROBE_EXPS];
+    element_ptr base[FP512_PROBE_POINTS * FP512_PROBE_EXPS], out[FP512_PROBE_POINTS * FP512_PROBE_EXPS];
+    mpz_t e[FP512_PROBE_POINTS * FP512_PROBE_EXPS];
+    int n = FP512_PROBE_POINTS * FP512_PROBE_EXPS;
+
+    for (int p = 0; p < FP512_PROBE_POINTS; p++) {
+        char message[32];
+        snprintf(message, sizeof(message), "fp512 probe %d", p);
+        element_init_G1(probe[p], pairing);
+        element_from_hash(probe[p], message, strlen(message));
+    }
+    for (int i = 0; i < n; i++) {
+        mpz_init(e[i]);
+        switch (i % FP512_PROBE_EXPS) {
+            case 0: mpz_set_ui(e[i], 0); break;
+            case 1: mpz_set_ui(e[i], 1); break;
+            case 2: mpz_set_ui(e[i], 2); break;
+            case 3: mpz_set_si(e[i], -1); break;
+            case 4: mpz_set_ui(e[i], 0xfedcba987UL); break;
+            case 5: mpz_fdiv_q_2exp(e[i], pairing->r, 1); break;
+            case 6: mpz_sub_ui(e[i], pairing->r, 2); break;
+            case 7: mpz_sub_ui(e[i], pairing->r, 1); break;
+            case 8: mpz_set(e[i], pairing->r); break;
+            default:
+                mpz_setbit(e[i], mpz_sizeinbase(pairing->r, 2));
+                mpz_sub_ui(e[i], e[i], 1);
+        }
+        base[i] = probe[i / FP512_PROBE_EXPS];
+        element_init_G1(expect[i], pairing);
+        element_init_G1(got[i], pairing);
+        out[i] = got[i];
+        element_pow_mpz(expect[i], base[i], e[i]);
+    }
+
+    int ok = 1;
+    fp512_element_pow_batch(out, base, e, n);
+    for (int i = 0; i < n; i++) {
+        ok &= !element_cmp(expect[i], got[i]);
+    }
+    for (int i = 0; i < FP512_PROBE_EXPS; i++) {
+        fp512_element_pow_mpz(got[i], probe[0], e[i]);
+        ok &= !element_cmp(expect[i], got[i]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        mpz_clear(e[i]);
+        element_clear(expect[i]);
+        element_clear(got[i]);
+    }
+    for (int p = 0; p < FP512_PROBE_POINTS; p++) {
+        element_clear(probe[p]);
+    }
+    return ok;
+}
+
+#define FP512_PROBE_MESSAGES 8
+#define FP512_PROBE_SEARCH 256
+
+// Known-answer test of fp512_element_from_hash_batch() against element_from_hash(). The x coordinates
+// PBC hashes the candidate messages to are classified with GMP, and messages are taken until the set
+// holds one that goes through the x = x^2 + 1 retry and square roots t^((q+1)/4) of both parities,
+// so both branches of the odd-y selection run. Fails if no such set turns up.
+int fp512_probe_hash(pairing_t pairing) {
+    static char messages[FP512_PROBE_SEARCH][32];
+    char *data[FP512_PROBE_SEARCH];
+    int len[FP512_PROBE_SEARCH];
+    int n = 0, retried = 0, odd = 0, even = 0;
+    unsigned char bytes[64];
+    mpz_t x, t;
+    mpz_inits(x, t, NULL);
+    element_t point, xe;
+    element_init_G1(point, pairing);
+    element_init_same_as(xe, element_x(point));
+
+    for (int i = 0; i < FP512_PROBE_SEARCH && (n < FP512_PROBE_MESSAGES || !retried || !odd || !even); i++) {
+        snprintf(messages[i], sizeof(messages[i]), "fp512 hash probe %d", i);
+        element_from_hash(xe, messages[i], strlen(messages[i]));
+        element_to_bytes(bytes, xe);
+        mpz_import(x, fp512_field.bytes, 1, 1, 1, 0, bytes);
+
+        int retries = 0;
+        for (;;) {
+            mpz_mul(t, x, x);
+            mpz_add_ui(t, t, 1);
+            mpz_mul(t, t, x);
+            mpz_mod(t, t, fp512_field.q);
+            if (mpz_legendre(t, fp512_field.q) >= 0) {
+                break;
+            }
+            mpz_mul(x, x, x);
+            mpz_add_ui(x, x, 1);
+            mpz_mod(x, x, fp512_field.q);
+            retries++;
+        }
+        mpz_powm(t, t, fp512_field.sqrt_exp, fp512_field.q);
+        int root_odd = mpz_odd_p(t);
+
+        // Past the minimum, only messages that fill a missing case are worth a slot
+        if (n < FP512_PROBE_MESSAGES || (retries && !retried) || (root_odd && !odd) || (!root_odd && !even)) {
+            retried |= retries > 0;
+            odd |= root_odd;
+            even |= !root_odd;
+            data[n] = messages[i];
+            len[n++] = strlen(messages[i]);
+        }
+    }
+    mpz_clears(x, t, NULL);
+    element_clear(xe);
+    element_clear(point);
+    if (!retried || !odd || !even) {
+        return 0;
+    }
+
+    element_t expect[FP512_PROBE_SEARCH], got[FP512_PROBE_SEARCH];
+    element_ptr out[FP512_PROBE_SEARCH];
+    for (int i = 0; i < n; i++) {
+        element_init_G1(expect[i], pairing);
+        element_init_G1(got[i], pairing);
+        out[i] = got[i];
+        element_from_hash(expect[i], data[i], len[i]);
+    }
+    fp512_element_from_hash_batch(out, data, len, n);
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        ok &= !element_cmp(expect[i], got[i]);
+        element_clear(expect[i]);
+        element_clear(got[i]);
+    }
+    return ok;
+}
+
+// Enables the backend for "type a" parameter text when G1 elements are the expected x || y encoding.
+// Known-answer probes against PBC switch off any path whose output would differ from PBC's.
+int fp512_init_param(const char *param, size_t size, pairing_t pairing) {
+    char *text = (char *) malloc(size + 1);
+    memcpy(text, param, size);
+    text[size] = '\0';
+
+    int type_a = 0, have_q = 0, have_h = 0;
+    mpz_t q, h;
+    mpz_inits(q, h, NULL);
+    fp512_field.ready = 0;
+    fp512_field.hash_ready = 0;
+    for (char *line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        if (strncmp(line, "type", 4) == 0) {
+            type_a = strstr(line + 4, "a") != NULL && strstr(line + 4, "a1") == NULL;
+        }
+        else if (strncmp(line, "q ", 2) == 0) {
+            have_q = mpz_set_str(q, line + 2, 10) == 0;
+        }
+        else if (strncmp(line, "h ", 2) == 0) {
+            have_h = mpz_set_str(h, line + 2, 10) == 0;
+        }
+    }
+    free(text);
+
+    int bytes = pairing_length_in_bytes_G1(pairing);
+    if (!type_a || !have_q || bytes % 2 != 0 || (size_t) bytes / 2 != (mpz_sizeinbase(q, 2) + 7) / 8 || !fp512_init(q, bytes / 2)) {
+        mpz_clears(q, h, NULL);
+        return 0;
+    }
+
+    fp512_field.ready = fp512_probe_pow(pairing);
+
+    mpz_set(fp512_field.cofactor, h);
+    fp512_field.hash_ready = fp512_field.ready && have_h && mpz_fdiv_ui(q, 4) == 3;
+    if (fp512_field.hash_ready) {
+        fp512_field.hash_ready = fp512_probe_hash(pairing);
+    }
+
+    mpz_clears(q, h, NULL);
+    return fp512_field.ready;
+}
@@ -0,0 +1,16 @@
+#include <stdint.h>
+#include <stddef.h>
+
+// FNV-1a, the one non-cryptographic hash used for fingerprints and lookups: checkpoint records,
+// context files, keystore slots and challenge and setup fingerprints all fold their bytes with it.
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+uint64_t fnv1a_update(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+// Reads of the stored data and tags by tagGen and the proof commands. On a live storage node an
+// audit should not push the tenants' working set out of the page cache or saturate the disk, so
+// the environment selects how these reads are done:
+//   AUDIT_IO_MODE  buffered  stdio, as before (default)
+//                  dontneed  pread, then posix_fadvise(DONTNEED) drops the pages just read
+//                  direct    O_DIRECT through an aligned bounce buffer; the page cache is bypassed
+//                            (falls back to dontneed for files whose file system refuses O_DIRECT,
+//                            at open or on the first read)
+//   AUDIT_IO_BPS   read rate cap in bytes/s, K, M or G suffix allowed (default: none)
+//   AUDIT_IO_IOPS  read request cap per second (default: none)
+// The caps share one token bucket per process. Streams served from an audit context or keystore
+// have no file descriptor and are always read buffered. A failed read is reported and ends the command.
+
+#define IO_ALIGN 4096               // O_DIRECT offset, length and buffer alignment
+#define IO_BOUNCE_SIZE (1 << 16)    // largest aligned window read at once
+#define IO_BURST_SECONDS 0.1        // bucket depth, as a fraction of a second at the capped rate
+#define IO_MAX_FILES 8
+
+enum { IO_BUFFERED, IO_DONTNEED, IO_DIRECT };
+
+const char *io_mode_names[] = { "buffered", "dontneed", "direct" };
+
+typedef struct {
+    int loaded;
+    int mode;
+    double bps;             // 0 = unlimited
+    double iops;
+    double byte_tokens;
+    double op_tokens;
+    uint64_t last_ns;
+    uint64_t first_ns;      // first and last read, for the achieved rate
+    uint64_t end_ns;
+    uint64_t throttled_ns;  // time slept by the rate limiter
+    long long bytes;
+    long long ops;
+    unsigned char *bounce;
+    // O_DIRECT descriptors, keyed by the file they were opened for; -1 where O_DIRECT was refused
+    struct { dev_t dev; ino_t ino; int fd; } direct[IO_MAX_FILES];
+    int num_direct;
+} IOSTATE;
+
+IOSTATE io_state;
+
+// Parses a rate such as 250, 40M or 1.5G; returns 0 when unset
+double io_parse_rate(const char *name) {
+    const char *value = getenv(name);
+    if (value == NULL || *value == '\0') {
+        return 0.0;
+    }
+    char *end;
+    double rate = strtod(value, &end);
+    switch (*end) {
+        case 'k': case 'K': rate *= 1e3; end++; break;
+        case 'm': case 'M': rate *= 1e6; end++; break;
+        case 'g': case 'G': rate *= 1e9; end++; break;
+    }
+    if (*end != '\0' || rate < 0) {
+        printf("Error: %s must be a non-negative rate such as 500, 40M or 1G, got %s\n", name, value);
+        exit(EXIT_FAILURE);
+    }
+    return rate;
+}
+
+void io_load_config() {
+    if (io_state.loaded) {
+        return;
+    }
+    io_state.loaded = 1;
+    io_state.mode = IO_BUFFERED;
+    const char *mode = getenv("AUDIT_IO_MODE");
+    if (mode != NULL && *mode != '\0') {
+        int m;
+        for (m = 0; m <= IO_DIRECT && strcmp(mode, io_mode_names[m]) != 0; m++);
+        if (m > IO_DIRECT) {
+            printf("Error: AUDIT_IO_MODE must be buffered, dontneed or direct, got %s\n", mode);
+            exit(EXIT_FAILURE);
+        }
+        io_state.mode = m;
+    }
+    io_state.bps = io_parse_rate("AUDIT_IO_BPS");
+    io_state.iops = io_parse_rate("AUDIT_IO_IOPS");
+    io_state.byte_tokens = io_state.bps * IO_BURST_SECONDS;
+    io_state.op_tokens = io_state.iops * IO_BURST_SECONDS;
+    io_state.last_ns = trace_now_ns();
+}
+
+// Takes one request of len bytes from the bucket, sleeping until the caps allow it
+void io_throttle(size_t len) {
+    uint64_t now = trace_now_ns();
+    double elapsed = (now - io_state.last_ns) / 1e9;
+    double wait = 0.0;
+    io_state.last_ns = now;
+    if (io_state.first_ns == 0) {
+        io_state.first_ns = now;
+    }
+
+    // Requests larger than the bucket drive it negative, and the deficit is slept off
+    if (io_state.bps > 0) {
+        double cap = io_state.bps * IO_BURST_SECONDS;
+        io_state.byte_tokens += elapsed * io_state.bps;
+        io_state.byte_tokens = (io_state.byte_tokens < cap ? io_state.byte_tokens : cap) - len;
+        if (io_state.byte_tokens < 0 && -io_state.byte_tokens / io_state.bps > wait) {
+            wait = -io_state.byte_tokens / io_state.bps;
+        }
+    }
+    if (io_state.iops > 0) {
+        double cap = io_state.iops * IO_BURST_SECONDS > 1 ? io_state.iops * IO_BURST_SECONDS : 1;
+        io_state.op_tokens += elapsed * io_state.iops;
+        io_state.op_tokens = (io_state.op_tokens < cap ? io_state.op_tokens : cap) - 1;
+        if (io_state.op_tokens < 0 && -io_state.op_tokens / io_state.iops > wait) {
+            wait = -io_state.op_tokens / io_state.iops;
+        }
+    }
+    if (wait > 0) {
+        struct timespec ts = { (time_t) wait, (long) ((wait - (time_t) wait) * 1e9) };
+        nanosleep(&ts, NULL);
+        io_state.throttled_ns += (uint64_t) (wait * 1e9);
+    }
+}
+
+// O_DIRECT descriptor for the file behind fd, or -1 where O_DIRECT is unavailable
+int io_direct_fd(int fd) {
+#ifdef O_DIRECT
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < io_state.num_direct; i++) {
+        if (io_state.direct[i].dev == st.st_dev && io_state.direct[i].ino == st.st_ino) {
+            return io_state.direct[i].fd;
+        }
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    int direct_fd = open(path, O_RDONLY | O_DIRECT);
+    if (io_state.num_direct < IO_MAX_FILES) {
+        io_state.direct[io_state.num_direct].dev = st.st_dev;
+        io_state.direct[io_state.num_direct].ino = st.st_ino;
+        io_state.direct[io_state.num_direct++].fd = direct_fd;
+        return direct_fd;
+    }
+    if (direct_fd >= 0) {
+        close(direct_fd);
+    }
+#endif
+    return -1;
+}
+
+// Closes the O_DIRECT descriptor of a file whose file system refused a direct read, and remembers
+// that its reads go through the dontneed path
+void io_refuse_direct(int direct_fd) {
+    for (int i = 0; i < io_state.num_direct; i++) {
+        if (io_state.direct[i].fd == direct_fd) {
+            close(direct_fd);
+            io_state.direct[i].fd = -1;
+            return;
+        }
+    }
+}
+
+// Closes the O_DIRECT descriptor opened for the file behind file, if any, freeing its slot
+void io_close(FILE *file) {
+    struct stat st;
+    int fd = fileno(file);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return;
+    }
+    for (int i = 0; i < io_state.num_direct; i++) {
+        if (io_state.direct[i].dev == st.st_dev && io_state.direct[i].ino == st.st_ino) {
+            if (io_state.direct[i].fd >= 0) {
+                close(io_state.direct[i].fd);
+            }
+            io_state.direct[i] = io_state.direct[--io_state.num_direct];
+            break;
+        }
+    }
+    if (io_state.num_direct == 0) {
+        free(io_state.bounce);
+        io_state.bounce = NULL;
+    }
+}
+
+// Reads through the aligned window(s) covering [offset, offset + len)
+ssize_t io_pread_direct(int direct_fd, unsigned char *buf, size_t len, off_t offset) {
+    if (io_state.bounce == NULL && posix_memalign((void **) &io_state.bounce, IO_ALIGN, IO_BOUNCE_SIZE) != 0) {
+        perror("Failed to allocate I/O buffer");
+        exit(EXIT_FAILURE);
+    }
+    size_t done = 0;
+    while (done < len) {
+        off_t pos = offset + done;
+        off_t start = pos & ~(off_t) (IO_ALIGN - 1);
+        size_t want = (pos - start) + (len - done);
+        want = (want + IO_ALIGN - 1) & ~(size_t) (IO_ALIGN - 1);
+        want = want < IO_BOUNCE_SIZE ? want : IO_BOUNCE_SIZE;
+        ssize_t got = pread(direct_fd, io_state.bounce, want, start);
+        if (got < 0) {
+            return -1;
+        }
+        if (got <= pos - start) {
+            break;
+        }
+        size_t avail = got - (pos - start);
+        size_t take = avail < len - done ? avail : len - done;
+        memcpy(buf + done, io_state.bounce + (pos - start), take);
+        done += take;
+    }
+    return done;
+}
+
+// Reads up to len bytes at offset of file as AUDIT_IO_MODE says; returns the bytes read
+size_t io_read_at(FILE *file, void *buf, size_t len, off_t offset) {
+    io_load_config();
+    if (io_state.bps > 0 || io_state.iops > 0) {
+        io_throttle(len);
+    }
+
+    ssize_t n = -1;
+    int fd = fileno(file);
+    int direct_fd = io_state.mode == IO_DIRECT && fd >= 0 ? io_direct_fd(fd) : -1;
+    if (direct_fd >= 0) {
+        n = io_pread_direct(direct_fd, (unsigned char *) buf, len, offset);
+        if (n < 0 && errno == EINVAL) {
+            io_refuse_direct(direct_fd);
+            direct_fd = -1;
+        }
+    }
+    if (direct_fd < 0 && io_state.mode != IO_BUFFERED && fd >= 0) {
+        n = pread(fd, buf, len, offset);
+        // Page-granular, so a block sharing a page with the next is dropped when that one is read
+        if (n > 0) {
+            posix_fadvise(fd, offset, n, POSIX_FADV_DONTNEED);
+        }
+    }
+    else if (direct_fd < 0) {
+        if (ftello(file) != offset) {
+            fseeko(file, offset, SEEK_SET);
+        }
+        n = fread(buf, 1, len, file);
+        if (ferror(file)) {
+            n = -1;
+        }
+    }
+    if (n < 0) {
+        perror("Error reading stored data");
+        exit(EXIT_FAILURE);
+    }
+    size_t got = n;
+
+    io_state.bytes += got;
+    io_state.ops++;
+    io_state.end_ns = trace_now_ns();
+    if (io_state.first_ns == 0) {
+        io_state.first_ns = io_state.end_ns;
+    }
+    return got;
+}
+
+// Appends the I/O settings and achieved read rate to the statistics file, when not the defaults
+void io_report(FILE *stat_file) {
+    io_load_config();
+    if (io_state.mode == IO_BUFFERED && io_state.bps == 0 && io_state.iops == 0) {
+        return;
+    }
+    double seconds = io_state.end_ns > io_state.first_ns ? (io_state.end_ns - io_state.first_ns) / 1e9 : 0.0;
+    fprintf(stat_file, "I/O (%s, limits %.2f MB/s %.0f IOPS, 0 = none) = %lld reads, %.2f MB at %.2f MB/s, %.0f IOPS, %.2f ms throttled\n",
+            io_mode_names[io_state.mode], io_state.bps / 1e6, io_state.iops, io_state.ops, io_state.bytes / 1e6,
+            seconds > 0 ? io_state.bytes / 1e6 / seconds : 0.0, seconds > 0 ? io_state.ops / seconds : 0.0,
+            io_state.throttled_ns / 1e6);
+}
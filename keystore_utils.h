@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Indexed keystore: one file holding the partial, full and public keys of many IDs in fixed-size
+// records, placed by open addressing on a hash of the full ID. Lookups map the file and probe
+// a few records; nothing is parsed. Anywhere a key file name is expected, "<store>::<ID>:<kind>"
+// (kind = partial, full or public) reads that key from the store instead.
+
+#define KEYSTORE_MAGIC "DCAKEYS1"
+#define KEYSTORE_ID_LEN 128
+#define KEYSTORE_SLOT_LEN 512
+#define KEYSTORE_MIN_CAPACITY 64
+#define KEYSTORE_SEPARATOR "::"
+
+enum { KEY_PARTIAL, KEY_FULL, KEY_PUBLIC, KEY_KINDS };
+
+const char *key_kind_names[KEY_KINDS] = { "partial", "full", "public" };
+// File name suffixes of the one-file-per-key layout that create_and_open_file() writes
+const char *key_kind_suffixes[KEY_KINDS] = { "_partial_private_key.bin", "_full_private_key.bin", "_public_key.bin" };
+
+// Per-ID key file name: the ID up to its '@', then the suffix. Returns 0 if it does not fit in len bytes.
+int key_file_name(char *filename, size_t len, const char *id, const char *suffix) {
+    int n = snprintf(filename, len, "%.*s%s", (int) strcspn(id, "@"), id, suffix);
+    return n >= 0 && (size_t) n < len;
+}
+
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t capacity;      // power of two
+    uint32_t count;
+    uint32_t reserved;
+} KEYSTOREHEADER;
+
+typedef struct {
+    uint64_t hash;
+    char id[KEYSTORE_ID_LEN];
+    uint32_t lengths[KEY_KINDS];    // 0 when that key is absent
+    uint32_t used;
+    unsigned char slots[KEY_KINDS][KEYSTORE_SLOT_LEN];
+} KEYRECORD;
+
+// An open store; map is MAP_SHARED for writers and MAP_PRIVATE for readers
+typedef struct {
+    char *path;
+    int fd;
+    int writable;
+    unsigned char *map;
+    size_t size;
+} KEYSTORE;
+
+// Read-only store kept mapped across lookups, so bulk readers map it once
+KEYSTORE keystore_cache;
+
+uint64_t keystore_hash(const char *id) {
+    uint64_t hash = fnv1a_update(FNV_OFFSET, id, strlen(id));
+    return hash ? hash : 1;
+}
+
+int key_kind(const char *name) {
+    for (int kind = 0; kind < KEY_KINDS; kind++) {
+        if (strcmp(name, key_kind_names[kind]) == 0) {
+            return kind;
+        }
+    }
+    printf("Error: Unknown key kind %s (expected partial, full or public)\n", name);
+    exit(EXIT_FAILURE);
+}
+
+static inline KEYSTOREHEADER *keystore_header(KEYSTORE *store) {
+    return (KEYSTOREHEADER *) store->map;
+}
+
+static inline KEYRECORD *keystore_records(KEYSTORE *store) {
+    return (KEYRECORD *) (store->map + sizeof(KEYSTOREHEADER));
+}
+
+// Record holding id, or the empty record where it would be inserted (NULL if the table is full)
+KEYRECORD *keystore_slot(KEYSTORE *store, const char *id) {
+    KEYSTOREHEADER *header = keystore_header(store);
+    KEYRECORD *records = keystore_records(store);
+    uint64_t hash = keystore_hash(id);
+    uint32_t mask = header->capacity - 1;
+
+    for (uint32_t probe = 0; probe < header->capacity; probe++) {
+        KEYRECORD *record = &records[(hash + probe) & mask];
+        if (!record->used || (record->hash == hash && strcmp(record->id, id) == 0)) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+KEYRECORD *keystore_find(KEYSTORE *store, const char *id) {
+    KEYRECORD *record = keystore_slot(store, id);
+    return record && record->used ? record : NULL;
+}
+
+void keystore_map(KEYSTORE *store) {
+    struct stat st;
+    if (fstat(store->fd, &st) != 0 || (size_t) st.st_size < sizeof(KEYSTOREHEADER)) {
+        printf("Error: %s is not a keystore\n", store->path);
+        exit(EXIT_FAILURE);
+    }
+    store->size = st.st_size;
+    void *map = mmap(NULL, store->size, store->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     store->writable ? MAP_SHARED : MAP_PRIVATE, store->fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    store->map = (unsigned char *) map;
+
+    KEYSTOREHEADER *header = keystore_header(store);
+    if (memcmp(header->magic, KEYSTORE_MAGIC, sizeof(header->magic)) != 0 || header->record_size != sizeof(KEYRECORD) ||
+        store->size < sizeof(KEYSTOREHEADER) + (size_t) header->capacity * sizeof(KEYRECORD)) {
+        printf("Error: %s is not a keystore\n", store->path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Writes an empty table of the given capacity to fd
+void keystore_format(int fd, uint32_t capacity) {
+    KEYSTOREHEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KEYSTORE_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(KEYRECORD);
+    header.capacity = capacity;
+
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(header) + (off_t) capacity * sizeof(KEYRECORD)) != 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+        perror("Error formatting keystore");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Opens a store for writing under an exclusive lock, creating it when missing
+void keystore_open_rw(KEYSTORE *store, const char *path) {
+    store->path = strdup(path);
+    store->writable = 1;
+    // A writer that grew the store renames a new file over path, so the lock we waited for may be on
+    // a file that is no longer the store; retry until the locked file is the one path names
+    for (;;) {
+        store->fd = open(path, O_RDWR | O_CREAT, 0600);
+        if (store->fd < 0 || flock(store->fd, LOCK_EX) != 0) {
+            printf("Error opening file: %s\n", path);
+            exit(EXIT_FAILURE);
+        }
+        struct stat locked, named;
+        if (fstat(store->fd, &locked) == 0 && stat(path, &named) == 0 && locked.st_dev == named.st_dev &&
+            locked.st_ino == named.st_ino) {
+            if (locked.st_size == 0) {
+                keystore_format(store->fd, KEYSTORE_MIN_CAPACITY);
+            }
+            break;
+        }
+        close(store->fd);
+    }
+    keystore_map(store);
+}
+
+// Opens a store for lookups; readers take no lock, as writers only ever replace the file whole or
+// fill records in place
+void keystore_open_ro(KEYSTORE *store, const char *path) {
+    store->path = strdup(path);
+    store->writable = 0;
+    store->fd = open(path, O_RDONLY);
+    if (store->fd < 0) {
+        printf("Error opening file: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    keystore_map(store);
+}
+
+// Flushes a writable store to disk
+void keystore_sync(KEYSTORE *store) {
+    if (msync(store->map, store->size, MS_SYNC) != 0 || fsync(store->fd) != 0) {
+        perror("Error syncing keystore");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Closes a store, syncing it first when open for writing so nothing is lost once the lock is released
+void keystore_close(KEYSTORE *store) {
+    if (store->map && store->writable) {
+        keystore_sync(store);
+    }
+    if (store->map) {
+        munmap(store->map, store->size);
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    free(store->path);
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+}
+
+// Doubles the table into a fresh file and swaps it in, keeping the lock on the new file. Writers
+// waiting on the old file notice the swap in keystore_open_rw() and reopen.
+void keystore_grow(KEYSTORE *store) {
+    KEYSTOREHEADER *old_header = keystore_header(store);
+    KEYRECORD *old_records = keystore_records(store);
+    uint32_t old_capacity = old_header->capacity;
+
+    size_t len = strlen(store->path) + 8;
+    char *tmp_path = (char *) malloc(len);
+    snprintf(tmp_path, len, "%s.tmp", store->path);
+
+    KEYSTORE grown;
+    grown.path = strdup(store->path);
+    grown.writable = 1;
+    grown.fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (grown.fd < 0 || flock(grown.fd, LOCK_EX) != 0) {
+        printf("Error opening file: %s\n", tmp_path);
+        exit(EXIT_FAILURE);
+    }
+    keystore_format(grown.fd, old_capacity * 2);
+    keystore_map(&grown);
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_records[i].used) {
+            *keystore_slot(&grown, old_records[i].id) = old_records[i];
+            keystore_header(&grown)->count++;
+        }
+    }
+    // The new table must be on disk before it replaces the old one
+    keystore_sync(&grown);
+    if (rename(tmp_path, store->path) != 0) {
+        perror("Error replacing keystore");
+        exit(EXIT_FAILURE);
+    }
+    free(tmp_path);
+    keystore_close(store);
+    *store = grown;
+}
+
+// Stores one key of id; the store must be open for writing
+void keystore_put(KEYSTORE *store, const char *id, int kind, const void *data, size_t len) {
+    if (strlen(id) >= KEYSTORE_ID_LEN || len > KEYSTORE_SLOT_LEN) {
+        printf("Error: ID %s or its %s key (%zu bytes) does not fit a keystore record\n", id, key_kind_names[kind], len);
+        exit(EXIT_FAILURE);
+    }
+    // Keep the load factor at or below 3/4 so probe sequences stay short
+    if (!keystore_find(store, id) && (keystore_header(store)->count + 1) * 4 > keystore_header(store)->capacity * 3) {
+        keystore_grow(store);
+    }
+
+    KEYRECORD *record = keystore_slot(store, id);
+    if (!record->used) {
+        memset(record, 0, sizeof(*record));
+        record->hash = keystore_hash(id);
+        strcpy(record->id, id);
+        record->used = 1;
+        keystore_header(store)->count++;
+    }
+    memcpy(record->slots[kind], data, len);
+    record->lengths[kind] = len;
+}
+
+// Splits "<store>::<ID>:<kind>"; returns 0 if spec is a plain file name
+int keystore_parse(const char *spec, char *path, size_t path_len, char *id, int *kind) {
+    const char *sep = strstr(spec, KEYSTORE_SEPARATOR);
+    if (sep == NULL) {
+        return 0;
+    }
+    const char *key = sep + strlen(KEYSTORE_SEPARATOR);
+    const char *colon = strrchr(key, ':');
+    if (colon == NULL || (size_t)(sep - spec) >= path_len || (size_t)(colon - key) >= KEYSTORE_ID_LEN) {
+        printf("Error: Expected <keystore>::<ID>:<partial|full|public>, got %s\n", spec);
+        exit(EXIT_FAILURE);
+    }
+    snprintf(path, path_len, "%.*s", (int)(sep - spec), spec);
+    snprintf(id, KEYSTORE_ID_LEN, "%.*s", (int)(colon - key), key);
+    *kind = key_kind(colon + 1);
+    return 1;
+}
+
+// Returns an in-memory stream over the key named by a "<store>::<ID>:<kind>" spec, or NULL for plain file names
+FILE *keystore_open_key(const char *spec) {
+    char path[4096], id[KEYSTORE_ID_LEN];
+    int kind;
+    if (!keystore_parse(spec, path, sizeof(path), id, &kind)) {
+        return NULL;
+    }
+
+    if (keystore_cache.map == NULL || strcmp(keystore_cache.path, path) != 0) {
+        if (keystore_cache.map) {
+            keystore_close(&keystore_cache);
+        }
+        keystore_open_ro(&keystore_cache, path);
+    }
+
+    KEYRECORD *record = keystore_find(&keystore_cache, id);
+    if (record == NULL || record->lengths[kind] == 0) {
+        printf("Error: No %s key for %s in %s\n", key_kind_names[kind], id, path);
+        exit(EXIT_FAILURE);
+    }
+    // The stream gets its own copy of the key, so it stays valid when the cache moves to another store
+    FILE *file = fmemopen(NULL, record->lengths[kind], "r+b");
+    if (file == NULL || fwrite(record->slots[kind], 1, record->lengths[kind], file) != record->lengths[kind]) {
+        perror("Error reading key from keystore");
+        exit(EXIT_FAILURE);
+    }
+    rewind(file);
+    return file;
+}
@@ -0,0 +1,4 @@
+// The libaudit.h API as a library ("make libaudit.a"); the code is shared with dataAudit.c
+#define _GNU_SOURCE     // O_DIRECT for AUDIT_IO_MODE=direct (io_utils.h)
+#include "audit_utils.h"
+#include "audit_lib.h"
@@ -0,0 +1,89 @@
+#ifndef LIBAUDIT_H
+#define LIBAUDIT_H
+
+#include <stddef.h>
+
+// libaudit: tagging, proving and verifying on in-memory buffers, for linking the protocol into a
+// storage service instead of running dataAudit once per step ("make libaudit.a", then link with
+// -lpbc -lgmp -lm -lpthread). Keys, parameters, tags and proofs use the byte encodings of the
+// files the CLI writes, so the contents of soumyadev_full_private_key.bin can be passed as a key
+// here, and a proof made here verifies with "dataAudit verifyProof" and the other way round.
+// Nothing is printed, nothing touches the working directory, and errors are returned as codes.
+//
+// Threads: every call may be made from any thread. audit_open and audit_close serialize on an
+// internal lock, and a context may be shared by threads proving, verifying and tagging at once,
+// as long as it is not closed while they run. A tagger is used by one thread at a time. These
+// calls touch no process-wide state besides the pairing and the trace counters, which are safe
+// to share; the I/O, keystore and context-file state of the dataAudit commands is not used by
+// the library and is not synchronized.
+
+// libaudit.a is compiled with -fvisibility=hidden and its hidden symbols are made local, so only the
+// functions marked AUDIT_API are visible to the program linking it
+#define AUDIT_API __attribute__((visibility("default")))
+
+#define AUDIT_BLOCK_SIZE 1000
+#define AUDIT_SEED_SIZE 32
+
+enum {
+    AUDIT_OK = 0,
+    AUDIT_EPARAM = -1,      // unusable pairing parameters, or a second parameter set
+    AUDIT_EKEY = -2,        // a key, parameter or proof buffer is too short
+    AUDIT_EIO = -3,         // a block reader or tag sink reported failure
+    AUDIT_EINVAL = -4,      // other invalid argument
+    AUDIT_ENOMEM = -5       // out of memory
+};
+
+typedef struct AUDITCTX AUDITCTX;
+typedef struct AUDITTAGGER AUDITTAGGER;
+
+// A buffer handed to the library, e.g. the contents of a key file
+typedef struct {
+    const void *data;
+    size_t len;
+} AUDITBYTES;
+
+// Same contents as a challenge file: the seed and either a ratio of blocks or a block count
+typedef struct {
+    unsigned char seed[AUDIT_SEED_SIZE];
+    float ratio;
+    long long count;    // 0 when the challenge is a ratio
+} AUDITCHALLENGE;
+
+// Receives the tag of each block in order; blocks are numbered from 1. Returns 0 to continue.
+typedef int (*audit_tag_sink)(void *arg, long long block, const unsigned char *tag, size_t tag_len);
+
+// Reads block `block` (from 1) into data, which holds AUDIT_BLOCK_SIZE bytes, and its tag into tag.
+// Returns the length of the block (only the last one may be short), or 0 on failure.
+typedef size_t (*audit_block_reader)(void *arg, long long block, unsigned char *data, unsigned char *tag,
+                                     size_t tag_len);
+
+// Opens a context on pairing parameters in the text format of a.param. The parameters are
+// process-wide: contexts may be opened repeatedly, but only on one parameter set at a time.
+AUDIT_API int audit_open(AUDITCTX **ctx, const char *params, size_t len);
+AUDIT_API void audit_close(AUDITCTX *ctx);
+
+AUDIT_API size_t audit_tag_size(AUDITCTX *ctx);
+AUDIT_API size_t audit_proof_size(AUDITCTX *ctx);
+
+// Streams a file through the tagger. file_id is the identifier recorded for the file (the name
+// given to tagGen); the tags must later be verified against the same identifier and block count.
+AUDIT_API int audit_tagger_new(AUDITCTX *ctx, AUDITTAGGER **tagger, const char *file_id, AUDITBYTES csp_full_private_key,
+                     AUDITBYTES auditee_public_key, audit_tag_sink sink, void *arg);
+AUDIT_API int audit_tagger_update(AUDITTAGGER *tagger, const void *data, size_t len);
+// Tags what is left, frees the tagger and stores the number of blocks in *num_blocks
+AUDIT_API int audit_tagger_finish(AUDITTAGGER *tagger, long long *num_blocks);
+
+// A fresh random challenge of a ratio of blocks, or of count blocks when count > 0
+AUDIT_API int audit_challenge_new(AUDITCHALLENGE *chal, double ratio, long long count);
+
+// Answers chal over a file of num_blocks blocks; proof receives audit_proof_size() bytes
+AUDIT_API int audit_prove(AUDITCTX *ctx, AUDITBYTES auditee_full_private_key, AUDITBYTES csp_public_key,
+                const AUDITCHALLENGE *chal, long long num_blocks, audit_block_reader read, void *arg,
+                unsigned char *proof);
+
+// Returns 1 if proof answers chal for file_id, 0 if it does not, or an error code
+AUDIT_API int audit_verify(AUDITCTX *ctx, AUDITBYTES csp_public_key, AUDITBYTES auditee_public_key, const char *csp_id,
+                 AUDITBYTES local_params, const AUDITCHALLENGE *chal, const char *file_id, long long num_blocks,
+                 AUDITBYTES proof);
+
+#endif
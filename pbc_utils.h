@@ -3,6 +3,10 @@
 #include <stdbool.h>
 #include <time.h>
 #include "file_utils.h"
+#include "arena_utils.h"
+#ifdef AUDIT_FP512
+#include "fp512_utils.h"
+#endif
 
 bool debug = 0;
 bool lastDebug = 1;
@@ -10,103 +14,339 @@ bool lastDebug = 1;
 // Global pairing parameters
 pairing_t global_params;
 
-// Data structures for setup and key generation
+// Scoped elements: initialized at declaration and cleared when the enclosing block exits
+static inline void element_auto_clear(element_t *e) {
+    element_clear(*e);
+}
+#define SCOPED __attribute__((cleanup(element_auto_clear)))
+#define G1_ELEMENT(x) element_t x SCOPED; element_init_G1(x, global_params)
+#define G2_ELEMENT(x) element_t x SCOPED; element_init_G2(x, global_params)
+#define GT_ELEMENT(x) element_t x SCOPED; element_init_GT(x, global_params)
+#define ZR_ELEMENT(x) element_t x SCOPED; element_init_Zr(x, global_params)
+
+// Scoped arrays: n elements of one group, x.e[0] .. x.e[n - 1], cleared and freed when the enclosing block exits
+typedef struct {
+    element_t *e;
+    int n;
+} ELEMENTS;
+
+static inline ELEMENTS elements_new(int n, void (*init)(element_t, pairing_t)) {
+    ELEMENTS a = {malloc((n > 0 ? n : 1) * sizeof(element_t)), n};
+    if (!a.e) {
+        perror("Failed to allocate memory for elements");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        init(a.e[i], global_params);
+    }
+    return a;
+}
+
+static inline void elements_auto_clear(ELEMENTS *a) {
+    for (int i = 0; i < a->n; i++) {
+        element_clear(a->e[i]);
+    }
+    free(a->e);
+}
+#define SCOPED_ELEMENTS __attribute__((cleanup(elements_auto_clear)))
+#define G1_ELEMENTS(x, n) ELEMENTS x SCOPED_ELEMENTS = elements_new(n, element_init_G1)
+
+// G1 exponentiations of the per-block loops. Built with FP512=1 they run on the fixed 512-bit
+// backend of fp512_utils.h when the parameters are type A, and on PBC's generic code otherwise.
+#define G1_BATCH 8
+
+void g1_pow_zn(element_t out, element_t base, element_t exp) {
+#ifdef AUDIT_FP512
+    if (fp512_field.ready) {
+        mpz_t e;
+        mpz_init(e);
+        element_to_mpz(e, exp);
+        fp512_element_pow_mpz(out, base, e);
+        mpz_clear(e);
+        return;
+    }
+#endif
+    element_pow_zn(out, base, exp);
+}
+
+// out[i] = base[i]^exp[i] for n independent exponentiations, G1_BATCH at a time on the backend
+void g1_pow_zn_batch(element_ptr *out, element_ptr *base, element_ptr *exp, int n) {
+#ifdef AUDIT_FP512
+    if (fp512_field.ready) {
+        mpz_t e[G1_BATCH];
+        for (int i = 0; i < G1_BATCH; i++) {
+            mpz_init(e[i]);
+        }
+        for (int i = 0; i < n; i += G1_BATCH) {
+            int m = n - i < G1_BATCH ? n - i : G1_BATCH;
+            for (int j = 0; j < m; j++) {
+                element_to_mpz(e[j], exp[i + j]);
+            }
+            fp512_element_pow_batch(out + i, base + i, e, m);
+        }
+        for (int i = 0; i < G1_BATCH; i++) {
+            mpz_clear(e[i]);
+        }
+        return;
+    }
+#endif
+    for (int i = 0; i < n; i++) {
+        element_pow_zn(out[i], base[i], exp[i]);
+    }
+}
+
+// Messages hashed to G1 per call by the H2 loops; the backend shares one inversion across them
+#define H2_BATCH 64
+
+// out[i] = element_from_hash(data[i]) for n messages, with the same points as PBC
+void g1_from_hash_batch(element_ptr *out, char **data, int *len, int n) {
+#ifdef AUDIT_FP512
+    fp512_element_from_hash_batch(out, data, len, n);
+#else
+    for (int i = 0; i < n; i++) {
+        element_from_hash(out[i], data[i], len[i]);
+    }
+#endif
+    TRACE_COUNT(CNT_HASH_G1, n);
+}
+
+// Running product of base^exp terms, queued so they are exponentiated G1_BATCH at a time
+typedef struct {
+    element_t base[G1_BATCH];
+    element_t exp[G1_BATCH];
+    element_t term[G1_BATCH];
+    int count;
+} G1PRODUCT;
+
+void g1_product_init(G1PRODUCT *prod) {
+    for (int i = 0; i < G1_BATCH; i++) {
+        element_init_G1(prod->base[i], global_params);
+        element_init_Zr(prod->exp[i], global_params);
+        element_init_G1(prod->term[i], global_params);
+    }
+    prod->count = 0;
+}
+
+// Multiplies the queued terms into product
+void g1_product_flush(G1PRODUCT *prod, element_t product) {
+    element_ptr base[G1_BATCH], exp[G1_BATCH], term[G1_BATCH];
+    for (int i = 0; i < prod->count; i++) {
+        base[i] = prod->base[i];
+        exp[i] = prod->exp[i];
+        term[i] = prod->term[i];
+    }
+    g1_pow_zn_batch(term, base, exp, prod->count);
+    for (int i = 0; i < prod->count; i++) {
+        element_mul(product, product, prod->term[i]);
+    }
+    prod->count = 0;
+}
+
+// product *= base^exp, possibly deferred until the queue fills or g1_product_flush()
+void g1_product_add(G1PRODUCT *prod, element_t product, element_t base, element_t exp) {
+    element_set(prod->base[prod->count], base);
+    element_set(prod->exp[prod->count], exp);
+    if (++prod->count == G1_BATCH) {
+        g1_product_flush(prod, product);
+    }
+}
+
+void g1_product_clear(G1PRODUCT *prod) {
+    for (int i = 0; i < G1_BATCH; i++) {
+        element_clear(prod->base[i]);
+        element_clear(prod->exp[i]);
+        element_clear(prod->term[i]);
+    }
+}
+
+// Data structures for setup and key generation.
+// g and g0 live in G2; g1 generates G1 and equals g for symmetric pairings.
 typedef struct {
     element_t g;
     element_t g0;
+    element_t g1;
 } IBEPARAMS;
 typedef struct {
     element_t alpha;
     IBEPARAMS params;
 } SETUPVALS;
+// P = g1^beta is used for tags and proofs, P2 = g^beta in G2 is used for pairings
 typedef struct {
     element_t beta;
     element_t P;
+    element_t P2;
 } PUKEYVALS;
 
 // Hash function for ID
 void H1(element_t Q, char *str) {
     element_from_hash(Q, str, strlen(str));
+    TRACE_COUNT(CNT_HASH_G1, 1);
+}
+
+// Folds the serialized element into an FNV-1a fingerprint
+uint64_t fnv1a_element(uint64_t hash, element_t e) {
+    size_t size = element_length_in_bytes(e);
+    unsigned char *bin = (unsigned char *) malloc(size);
+    element_to_bytes(bin, e);
+    hash = fnv1a_update(hash, bin, size);
+    free(bin);
+    return hash;
 }
 
-float measure_time(clock_t start, clock_t end) {
-    return (float)(end - start) / CLOCKS_PER_SEC * 1000;
+// Elapsed wall-clock time in ms between two trace_now_ns() readings
+double measure_time(uint64_t start, uint64_t end) {
+    return (end - start) / 1e6;
 }
 
-// Setup function
-SETUPVALS setup(float *totalTimeTaken) {
+// Setup function; initializes the elements of setup_vals, release them with clear_setup()
+void setup(SETUPVALS *setup_vals, double *totalTimeTaken) {
     if(debug) {
     printf("SETUP ALGO INVOKED...\n");
     }
     
-    SETUPVALS setup_vals;
-    element_init_G1(setup_vals.params.g, global_params);
-    element_init_G1(setup_vals.params.g0, global_params);
-    element_init_Zr(setup_vals.alpha, global_params);
+    element_init_G2(setup_vals->params.g, global_params);
+    element_init_G2(setup_vals->params.g0, global_params);
+    element_init_G1(setup_vals->params.g1, global_params);
+    element_init_Zr(setup_vals->alpha, global_params);
     
-    clock_t startTime, endTime;
+    uint64_t startTime, endTime;
     
-    startTime = clock();
-    element_random(setup_vals.params.g);
-    element_random(setup_vals.alpha);
-    element_pow_zn(setup_vals.params.g0, setup_vals.params.g, setup_vals.alpha);
-    endTime = clock();
+    startTime = trace_now_ns();
+    element_random(setup_vals->params.g);
+    if (pairing_is_symmetric(global_params)) {
+        element_set(setup_vals->params.g1, setup_vals->params.g);
+    }
+    else {
+        element_random(setup_vals->params.g1);
+    }
+    element_random(setup_vals->alpha);
+    element_pow_zn(setup_vals->params.g0, setup_vals->params.g, setup_vals->alpha);
+    endTime = trace_now_ns();
+    TRACE_COUNT(CNT_G2_EXP, 1);
     
     *totalTimeTaken = measure_time(startTime, endTime);
-    
-    return setup_vals;
 }
 
 // Key generation function 1
-void keygen1(element_t D, element_t alpha, char *ID, float *totalTimeTaken) {
+void keygen1(element_t D, element_t alpha, char *ID, double *totalTimeTaken) {
     if(debug) {
     printf("KEYGEN-1 ALGO INVOKED for %s...\n", ID);
     }
     
-    element_t Q;  
-    element_init_G1(Q, global_params);
+    G1_ELEMENT(Q);
     
-    clock_t startTime, endTime;
+    uint64_t startTime, endTime;
     
-    startTime = clock();
+    startTime = trace_now_ns();
     H1(Q, ID);
     element_pow_zn(D, Q, alpha);
-    endTime = clock();
+    endTime = trace_now_ns();
+    TRACE_COUNT(CNT_G1_EXP, 1);
     
     *totalTimeTaken = measure_time(startTime, endTime);
-    
-    element_clear(Q);
 }
 
-// Key generation function 2
-PUKEYVALS keygen2(element_t g, char *ID, float *totalTimeTaken) {
+// Key generation function 2; initializes the elements of keyvals, release them with clear_keyvals()
+void keygen2(PUKEYVALS *keyvals, element_t g1, element_t g, char *ID, double *totalTimeTaken) {
     if(debug) {
     printf("KEYGEN-2 ALGO INVOKED for %s...\n", ID);
     }
     
-    PUKEYVALS keyvals;
-    element_init_G1(keyvals.P, global_params);
-    element_init_Zr(keyvals.beta, global_params);
+    element_init_G1(keyvals->P, global_params);
+    element_init_G2(keyvals->P2, global_params);
+    element_init_Zr(keyvals->beta, global_params);
     
-    clock_t startTime, endTime;
+    uint64_t startTime, endTime;
     
-    startTime = clock();
-    element_random(keyvals.beta);
-    element_pow_zn(keyvals.P, g, keyvals.beta);
-    endTime = clock();
+    startTime = trace_now_ns();
+    element_random(keyvals->beta);
+    element_pow_zn(keyvals->P, g1, keyvals->beta);
+    if (pairing_is_symmetric(global_params)) {
+        element_set(keyvals->P2, keyvals->P);
+    }
+    else {
+        element_pow_zn(keyvals->P2, g, keyvals->beta);
+        TRACE_COUNT(CNT_G2_EXP, 1);
+    }
+    endTime = trace_now_ns();
+    TRACE_COUNT(CNT_G1_EXP, 1);
     
     *totalTimeTaken = measure_time(startTime, endTime);
-    
-    return keyvals;
 }
 
-// Initialize PBC library with parameters from file
+void clear_keyvals(PUKEYVALS *keyvals) {
+    element_clear(keyvals->beta);
+    element_clear(keyvals->P);
+    element_clear(keyvals->P2);
+}
+
+// Read g, g0 and the G1 generator from the local params file.
+// Asymmetric pairings store g1 after g0; symmetric ones reuse g.
+void read_params(IBEPARAMS *params, FILE *fptr) {
+    element_init_G2(params->g, global_params);
+    element_init_G2(params->g0, global_params);
+    element_init_G1(params->g1, global_params);
+    read_element_from_file(params->g, fptr);
+    read_element_from_file(params->g0, fptr);
+    if (pairing_is_symmetric(global_params)) {
+        element_set(params->g1, params->g);
+    }
+    else {
+        read_element_from_file(params->g1, fptr);
+    }
+}
+
+void clear_params(IBEPARAMS *params) {
+    element_clear(params->g);
+    element_clear(params->g0);
+    element_clear(params->g1);
+}
+
+void clear_setup(SETUPVALS *setup_vals) {
+    element_clear(setup_vals->alpha);
+    clear_params(&setup_vals->params);
+}
+
+// Save a public key: P in G1, followed by P2 in G2 for asymmetric pairings
+void save_public_key(PUKEYVALS *keyvals, FILE *fptr) {
+    save_element_to_file(keyvals->P, fptr);
+    if (!pairing_is_symmetric(global_params)) {
+        save_element_to_file(keyvals->P2, fptr);
+    }
+}
+
+// Read the G2 half of a public key file (the only half for symmetric pairings)
+void read_public_key_G2(element_t P2, FILE *fptr) {
+    if (!pairing_is_symmetric(global_params)) {
+        fseek(fptr, pairing_length_in_bytes_G1(global_params), SEEK_CUR);
+    }
+    read_element_from_file(P2, fptr);
+}
+
+// Initialize PBC library from a text parameter file or a binary context file (see contextGen).
+// Either is mapped once; a context stays mapped so open_file() can serve the files packed in it.
 void myPBC_Initialize(char *arg1) {   
-    FILE *param_file = open_file(arg1, "r");
+    size_t size;
+    unsigned char *map = map_file(arg1, &size);
     
-    // Initialize PBC parameters using command line
-    char *arr[2] = {" ", arg1};
-    pbc_demo_pairing_init(global_params, 2, arr);
+    if (is_context(map, size)) {
+        load_context(map, size);
+        if (pairing_init_set_buf(global_params, audit_context.param, audit_context.param_size)) {
+            printf("Error: Invalid pairing parameters in %s\n", arg1);
+            exit(EXIT_FAILURE);
+        }
+#ifdef AUDIT_FP512
+        fp512_init_param(audit_context.param, audit_context.param_size, global_params);
+#endif
+        return;
+    }
     
-    fclose(param_file);
+    if (pairing_init_set_buf(global_params, (const char *) map, size)) {
+        printf("Error: Invalid pairing parameters in %s\n", arg1);
+        exit(EXIT_FAILURE);
+    }
+#ifdef AUDIT_FP512
+    fp512_init_param((const char *) map, size, global_params);
+#endif
+    munmap(map, size);
 }
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Tag shard: the tags of blocks first..last of one input, written by "tagGen --range first:last"
+// behind a header recording the range. Shards of the same input and keys carry the same
+// setup_hash, and tagMerge stitches a set that covers every block into a plain tag file.
+
+#define TAGSHARD_MAGIC "DCATAGS1"
+#define TAGSHARD_NAME_LEN 256
+
+typedef struct {
+    char magic[8];
+    uint64_t first_block;   // 1-based, inclusive
+    uint64_t last_block;
+    uint64_t num_blocks;    // blocks in the whole input
+    uint64_t input_size;
+    uint64_t setup_hash;    // fingerprint of the file identifier and the tagging keys
+    uint32_t tag_size;
+    uint32_t reserved;
+    char input[TAGSHARD_NAME_LEN];  // file identifier the tags were made for
+} TAGSHARDHEADER;
+
+// Partial proof of one shard holder over the challenged blocks it stores: followed by
+// sum(bl*v) in Zr, prod(sigma^v) in G1 and sum(v) in Zr. proofCombine folds a set of them into POP.bin.
+#define PARTIALPROOF_MAGIC "DCAPART1"
+
+typedef struct {
+    char magic[8];
+    uint64_t first_block;   // blocks of the shard, as in its TAGSHARDHEADER
+    uint64_t last_block;
+    uint64_t num_blocks;
+    uint64_t setup_hash;
+    uint64_t chal_hash;     // fingerprint of the challenge answered
+    uint64_t challenged;    // challenged blocks inside the shard
+} PARTIALPROOFHEADER;
+
+// Blocks first..last (1-based, inclusive) of a sharded tagGen run
+typedef struct {
+    long long first;
+    long long last;
+} TAGRANGE;
+
+// Parses "start:end"
+TAGRANGE parse_tag_range(const char *spec) {
+    TAGRANGE range;
+    char tail;
+    if (sscanf(spec, "%lld:%lld%c", &range.first, &range.last, &tail) != 2 || range.first < 1 || range.last < range.first) {
+        printf("Error: Expected a block range start:end with 1 <= start <= end, got %s\n", spec);
+        exit(EXIT_FAILURE);
+    }
+    return range;
+}
+
+// Reads and checks the header of a shard; the file must hold exactly the tags it announces
+void read_shard_header(const char *filename, TAGSHARDHEADER *header) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    ssize_t got = read(fd, header, sizeof(*header));
+    close(fd);
+    if (got != (ssize_t) sizeof(*header) || memcmp(header->magic, TAGSHARD_MAGIC, sizeof(header->magic)) != 0) {
+        printf("Error: %s is not a tag shard\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t count = header->last_block - header->first_block + 1;
+    if ((uint64_t) st.st_size != sizeof(*header) + count * header->tag_size) {
+        printf("Error: Tag shard %s is incomplete (%lld of %llu bytes)\n", filename, (long long) st.st_size,
+               (unsigned long long) (sizeof(*header) + count * header->tag_size));
+        exit(EXIT_FAILURE);
+    }
+    header->input[TAGSHARD_NAME_LEN - 1] = '\0';
+}
+
+// Appends the tags of a shard to out
+void copy_shard_tags(const char *filename, FILE *out) {
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL || fseeko(in, sizeof(TAGSHARDHEADER), SEEK_SET) != 0) {
+        printf("Error opening file: %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    unsigned char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        if (fwrite(chunk, 1, got, out) != got) {
+            perror("Error writing tag file");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fclose(in);
+}
+
+// Checks that a span handed over in order of first block continues exactly at *next (1 at the start)
+void check_block_span(uint64_t *next, uint64_t first, uint64_t last, const char *name) {
+    if (first > *next) {
+        printf("Error: Blocks %llu to %llu are missing (next shard: %s)\n", (unsigned long long) *next,
+               (unsigned long long) first - 1, name);
+        exit(EXIT_FAILURE);
+    }
+    if (first < *next) {
+        printf("Error: Blocks %llu to %llu are covered twice (shard: %s)\n", (unsigned long long) first,
+               (unsigned long long) (last < *next ? last : *next - 1), name);
+        exit(EXIT_FAILURE);
+    }
+    *next = last + 1;
+}
+
+// Checks that the spans seen by check_block_span() reached the last block of input
+void check_block_coverage(uint64_t next, uint64_t num_blocks, const char *input) {
+    if (next != num_blocks + 1) {
+        printf("Error: Blocks %llu to %llu of %s are missing\n", (unsigned long long) next,
+               (unsigned long long) num_blocks, input);
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// Where the stored data and tags are read from. Anywhere tagGen and the proof commands take an
+// input or tag file, the name may be
+//   http://host[:port]/path   an object in a blob store or web server that honours Range requests
+//   mmap:<path>               a local file mapped into memory
+//   anything else             a file opened with open_file(), read as AUDIT_IO_MODE says (io_utils.h)
+// Provers announce the blocks they will read with storage_prefetch(); adjacent ranges are coalesced
+// and a remote object fetches them with concurrent ranged GETs, so a proof costs a few small reads
+// rather than a download. Remote sequential reads (tagGen) go through a read-ahead window.
+// HTTP is plain HTTP/1.1 with keep-alive and no chunked bodies; put a TLS proxy in front if needed.
+
+#define STORAGE_FETCH_THREADS 8         // concurrent connections of one prefetch
+#define STORAGE_MAX_EXTENT (1 << 20)    // largest coalesced range fetched by one request
+#define STORAGE_READAHEAD (1 << 20)     // window of sequential remote reads
+#define STORAGE_HTTP_BUF 4096
+
+enum { STORAGE_FILE, STORAGE_MMAP, STORAGE_HTTP };
+
+// One keep-alive connection with its receive buffer
+typedef struct {
+    int fd;
+    size_t start, end;
+    unsigned char buf[STORAGE_HTTP_BUF];
+} HTTPCONN;
+
+typedef struct {
+    off_t offset;
+    size_t len;
+    unsigned char *data;
+} STORAGEEXTENT;
+
+typedef struct {
+    int kind;
+    char *name;
+    off_t size;
+    FILE *file;                 // STORAGE_FILE
+    unsigned char *map;         // STORAGE_MMAP
+    char host[256];             // STORAGE_HTTP
+    char port[16];
+    char *path;
+    HTTPCONN conn;
+    STORAGEEXTENT *extents;     // prefetched ranges, sorted by offset
+    int num_extents;
+    STORAGEEXTENT window;       // read-ahead of sequential reads
+    off_t next_offset;          // where a sequential read would continue
+} STORAGE;
+
+// Ranged requests and bytes fetched from remote objects by this process
+long long storage_requests, storage_bytes;
+pthread_mutex_t storage_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int http_connect(STORAGE *st) {
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(st->host, st->port, &hints, &res) != 0) {
+        printf("Error: Could not resolve %s\n", st->host);
+        exit(EXIT_FAILURE);
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai != NULL && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        printf("Error: Could not connect to %s:%s\n", st->host, st->port);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+void http_close(HTTPCONN *conn) {
+    if (conn->fd >= 0) {
+        close(conn->fd);
+    }
+    conn->fd = -1;
+    conn->start = conn->end = 0;
+}
+
+// Reads up to len bytes, from the buffer first; returns 0 when the peer closed
+size_t http_recv(HTTPCONN *conn, unsigned char *out, size_t len) {
+    if (conn->start == conn->end) {
+        ssize_t got = recv(conn->fd, conn->buf, sizeof(conn->buf), 0);
+        if (got <= 0) {
+            return 0;
+        }
+        conn->start = 0;
+        conn->end = got;
+    }
+    size_t take = conn->end - conn->start < len ? conn->end - conn->start : len;
+    memcpy(out, conn->buf + conn->start, take);
+    conn->start += take;
+    return take;
+}
+
+// Reads one header line without its CRLF; returns 0 when the peer closed
+int http_line(HTTPCONN *conn, char *line, size_t size) {
+    size_t n = 0;
+    unsigned char c;
+    while (http_recv(conn, &c, 1) == 1) {
+        if (c == '\n') {
+            if (n > 0 && line[n - 1] == '\r') {
+                n--;
+            }
+            line[n] = '\0';
+            return 1;
+        }
+        if (n + 1 < size) {
+            line[n++] = c;
+        }
+    }
+    return 0;
+}
+
+// Sends one request (HEAD when out is NULL, else GET of [offset, offset + len)) and reads the reply.
+// Returns the bytes stored in out, or -1 if the connection dropped before a reply; *total gets
+// the object size when the server reports it.
+long long http_request(STORAGE *st, HTTPCONN *conn, off_t offset, size_t len, unsigned char *out, off_t *total) {
+    char request[4096], line[1024];
+    int n = out ? snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\nRange: bytes=%lld-%lld\r\n\r\n",
+                           st->path, st->host, (long long) offset, (long long) (offset + len - 1))
+                : snprintf(request, sizeof(request), "HEAD %s HTTP/1.1\r\nHost: %s\r\n\r\n", st->path, st->host);
+    if (conn->fd < 0) {
+        conn->fd = http_connect(st);
+    }
+    if (send(conn->fd, request, n, MSG_NOSIGNAL) != n || !http_line(conn, line, sizeof(line))) {
+        http_close(conn);
+        return -1;
+    }
+
+    int status = 0;
+    long long length = -1, range_start = 0, range_total = -1;
+    int keep_alive = 1;
+    sscanf(line, "HTTP/%*s %d", &status);
+    while (http_line(conn, line, sizeof(line)) && line[0] != '\0') {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            length = atoll(line + 15);
+        }
+        else if (strncasecmp(line, "Content-Range:", 14) == 0) {
+            sscanf(line + 14, " bytes %lld-%*[0-9]/%lld", &range_start, &range_total);
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+            keep_alive = 0;
+        }
+    }
+    if (status != 200 && status != 206 && status != 416) {
+        printf("Error: %s answered %d\n", st->name, status);
+        exit(EXIT_FAILURE);
+    }
+    if (length < 0) {
+        printf("Error: %s sent no Content-Length\n", st->name);
+        exit(EXIT_FAILURE);
+    }
+    if (total) {
+        *total = status == 206 && range_total >= 0 ? range_total : length;
+    }
+
+    // Body bytes [skip, skip + keep) are the ones asked for; a server that ignores Range sends the
+    // whole object, and a 416 (range past the end) only an error page
+    long long body = out ? length : 0, pos = 0, stored = 0;
+    long long skip = status == 200 ? offset : offset - range_start;
+    long long keep = status == 416 ? 0 : (long long) len;
+    unsigned char chunk[STORAGE_HTTP_BUF];
+    while (pos < body) {
+        size_t got = http_recv(conn, chunk, (size_t) (body - pos < (long long) sizeof(chunk) ? body - pos : (long long) sizeof(chunk)));
+        if (got == 0) {
+            printf("Error: Connection to %s closed mid-reply\n", st->name);
+            exit(EXIT_FAILURE);
+        }
+        long long from = pos > skip ? pos : skip;
+        long long to = pos + (long long) got < skip + keep ? pos + (long long) got : skip + keep;
+        if (from < to) {
+            memcpy(out + (from - skip), chunk + (from - pos), to - from);
+            stored = to - skip;
+        }
+        pos += got;
+    }
+    if (!keep_alive) {
+        http_close(conn);
+    }
+
+    if (out) {
+        pthread_mutex_lock(&storage_lock);
+        storage_requests++;
+        storage_bytes += stored;
+        pthread_mutex_unlock(&storage_lock);
+    }
+    return stored;
+}
+
+// GET [offset, offset + len) into out, reconnecting once if a kept-alive connection went stale
+size_t http_get_range(STORAGE *st, HTTPCONN *conn, off_t offset, size_t len, unsigned char *out) {
+    long long got = http_request(st, conn, offset, len, out, NULL);
+    if (got < 0) {
+        got = http_request(st, conn, offset, len, out, NULL);
+    }
+    if (got < 0) {
+        printf("Error: Could not read %s\n", st->name);
+        exit(EXIT_FAILURE);
+    }
+    return got;
+}
+
+STORAGE *storage_open(char *spec) {
+    STORAGE *st = (STORAGE *) calloc(1, sizeof(STORAGE));
+    st->name = strdup(spec);
+    st->conn.fd = -1;
+
+    if (strncmp(spec, "http://", 7) == 0) {
+        st->kind = STORAGE_HTTP;
+        const char *hostport = spec + 7;
+        const char *slash = strchr(hostport, '/');
+        const char *colon = memchr(hostport, ':', slash ? (size_t)(slash - hostport) : strlen(hostport));
+        const char *host_end = colon ? colon : slash ? slash : hostport + strlen(hostport);
+        if (host_end == hostport || (size_t)(host_end - hostport) >= sizeof(st->host)) {
+            printf("Error: Expected http://host[:port]/path, got %s\n", spec);
+            exit(EXIT_FAILURE);
+        }
+        snprintf(st->host, sizeof(st->host), "%.*s", (int)(host_end - hostport), hostport);
+        if (colon) {
+            snprintf(st->port, sizeof(st->port), "%.*s", (int)((slash ? slash : colon + strlen(colon)) - colon - 1), colon + 1);
+        }
+        else {
+            strcpy(st->port, "80");
+        }
+        st->path = strdup(slash ? slash : "/");
+        off_t total = -1;
+        if (http_request(st, &st->conn, 0, 0, NULL, &total) < 0 || total < 0) {
+            printf("Error: Could not get the size of %s\n", spec);
+            exit(EXIT_FAILURE);
+        }
+        st->size = total;
+    }
+    else if (strncmp(spec, "mmap:", 5) == 0) {
+        st->kind = STORAGE_MMAP;
+        size_t size;
+        st->map = map_file(spec + 5, &size);
+        st->size = size;
+    }
+    else {
+        st->kind = STORAGE_FILE;
+        st->file = open_file(spec, "rb");
+        struct stat fst;
+        if (fileno(st->file) >= 0 && fstat(fileno(st->file), &fst) == 0) {
+            st->size = fst.st_size;
+        }
+        else {
+            fseeko(st->file, 0, SEEK_END);
+            st->size = ftello(st->file);
+        }
+    }
+    return st;
+}
+
+off_t storage_size(STORAGE *st) {
+    return st->size;
+}
+
+typedef struct {
+    STORAGE *st;
+    int first;
+    int stride;
+} FETCHJOB;
+
+// Fetches extents first, first + stride, ... over one connection
+void *storage_fetch_worker(void *arg) {
+    FETCHJOB *job = (FETCHJOB *) arg;
+    HTTPCONN *conn = (HTTPCONN *) malloc(sizeof(HTTPCONN));
+    conn->fd = -1;
+    conn->start = conn->end = 0;
+    for (int i = job->first; i < job->st->num_extents; i += job->stride) {
+        STORAGEEXTENT *ext = &job->st->extents[i];
+        ext->len = http_get_range(job->st, conn, ext->offset, ext->len, ext->data);
+    }
+    http_close(conn);
+    free(conn);
+    return NULL;
+}
+
+void storage_drop_extents(STORAGE *st) {
+    for (int i = 0; i < st->num_extents; i++) {
+        free(st->extents[i].data);
+    }
+    free(st->extents);
+    st->extents = NULL;
+    st->num_extents = 0;
+}
+
+// Announces reads of len bytes at each of the n ascending offsets. Remote objects fetch them now,
+// as coalesced ranges over concurrent connections; mapped files are advised; plain files read
+// them on demand. Replaces what an earlier prefetch fetched.
+void storage_prefetch(STORAGE *st, off_t *offsets, int n, size_t len) {
+    if (st->kind == STORAGE_FILE) {
+        return;
+    }
+    if (st->kind == STORAGE_MMAP) {
+        long page = sysconf(_SC_PAGESIZE);
+        for (int i = 0; i < n && offsets[i] < st->size; i++) {
+            off_t start = offsets[i] & ~(off_t)(page - 1);
+            off_t end = offsets[i] + (off_t) len < st->size ? offsets[i] + (off_t) len : st->size;
+            madvise(st->map + start, end - start, MADV_WILLNEED);
+        }
+        return;
+    }
+
+    storage_drop_extents(st);
+    st->extents = (STORAGEEXTENT *) malloc((n > 0 ? n : 1) * sizeof(STORAGEEXTENT));
+    for (int i = 0; i < n && offsets[i] < st->size; i++) {
+        off_t end = offsets[i] + (off_t) len < st->size ? offsets[i] + (off_t) len : st->size;
+        STORAGEEXTENT *last = st->num_extents ? &st->extents[st->num_extents - 1] : NULL;
+        if (last && offsets[i] <= last->offset + (off_t) last->len && end - last->offset <= STORAGE_MAX_EXTENT) {
+            if (end > last->offset + (off_t) last->len) {
+                last->len = end - last->offset;
+            }
+            continue;
+        }
+        st->extents[st->num_extents++] = (STORAGEEXTENT){offsets[i], (size_t)(end - offsets[i]), NULL};
+    }
+    for (int i = 0; i < st->num_extents; i++) {
+        st->extents[i].data = (unsigned char *) malloc(st->extents[i].len);
+    }
+
+    int threads = st->num_extents < STORAGE_FETCH_THREADS ? st->num_extents : STORAGE_FETCH_THREADS;
+    pthread_t workers[STORAGE_FETCH_THREADS];
+    FETCHJOB jobs[STORAGE_FETCH_THREADS];
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (FETCHJOB){st, t, threads};
+        if (pthread_create(&workers[t], NULL, storage_fetch_worker, &jobs[t]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+}
+
+// Copies [offset, offset + len) out of ext if it holds the start of it; returns the bytes copied
+static size_t storage_from_extent(STORAGEEXTENT *ext, void *buf, size_t len, off_t offset) {
+    if (ext->data == NULL || offset < ext->offset || offset >= ext->offset + (off_t) ext->len) {
+        return 0;
+    }
+    size_t avail = ext->offset + ext->len - offset;
+    size_t take = avail < len ? avail : len;
+    memcpy(buf, ext->data + (offset - ext->offset), take);
+    return take;
+}
+
+// Reads up to len bytes at offset; returns the bytes read (short only at the end of the object)
+size_t storage_read_at(STORAGE *st, void *buf, size_t len, off_t offset) {
+    if (st->kind == STORAGE_FILE) {
+        return io_read_at(st->file, buf, len, offset);
+    }
+    if (offset >= st->size) {
+        return 0;
+    }
+    if (st->kind == STORAGE_MMAP) {
+        size_t take = st->size - offset < (off_t) len ? (size_t)(st->size - offset) : len;
+        memcpy(buf, st->map + offset, take);
+        return take;
+    }
+
+    // Prefetched extents, by binary search on their starts
+    int lo = 0, hi = st->num_extents;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (st->extents[mid].offset <= offset) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    size_t got = st->num_extents ? storage_from_extent(&st->extents[lo], buf, len, offset) : 0;
+    if (got == 0) {
+        got = storage_from_extent(&st->window, buf, len, offset);
+    }
+    if (got == 0) {
+        // A sequential reader gets a read-ahead window, anything else exactly what it asked for
+        size_t want = offset == st->next_offset && len < STORAGE_READAHEAD ? STORAGE_READAHEAD : len;
+        st->window.data = (unsigned char *) realloc(st->window.data, want);
+        st->window.offset = offset;
+        st->window.len = http_get_range(st, &st->conn, offset, want, st->window.data);
+        got = storage_from_extent(&st->window, buf, len, offset);
+    }
+    // Reads spanning two extents continue in the next one
+    if (got > 0 && got < len && offset + (off_t) got < st->size) {
+        got += storage_read_at(st, (unsigned char *) buf + got, len - got, offset + got);
+    }
+    st->next_offset = offset + got;
+    return got;
+}
+
+// Folds bytes [from, to) of st into an FNV-1a hash; returns 0 if the object is shorter than to
+int storage_fnv1a_range(STORAGE *st, uint64_t *hash, uint64_t from, uint64_t to) {
+    if (st->kind == STORAGE_FILE && fileno(st->file) >= 0) {
+        return fnv1a_file_range(fileno(st->file), hash, from, to);
+    }
+    unsigned char chunk[1 << 16];
+    while (from < to) {
+        size_t want = to - from < sizeof(chunk) ? (size_t)(to - from) : sizeof(chunk);
+        size_t got = storage_read_at(st, chunk, want, (off_t) from);
+        if (got == 0) {
+            return 0;
+        }
+        *hash = fnv1a_update(*hash, chunk, got);
+        from += got;
+    }
+    return 1;
+}
+
+void storage_close(STORAGE *st) {
+    if (st->file) {
+        io_close(st->file);
+        fclose(st->file);
+    }
+    if (st->map) {
+        munmap(st->map, st->size);
+    }
+    http_close(&st->conn);
+    storage_drop_extents(st);
+    free(st->window.data);
+    free(st->path);
+    free(st->name);
+    free(st);
+}
+
+// Appends the remote reads of this run to the statistics file, when there were any
+void storage_report(FILE *stat_file) {
+    if (storage_requests > 0) {
+        fprintf(stat_file, "Remote storage reads = %lld ranged requests, %.2f MB\n", storage_requests, storage_bytes / 1e6);
+    }
+}
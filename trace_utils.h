@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Lightweight instrumentation: monotonic spans, event counters and per-block
+// latency histograms. Nothing is written unless AUDIT_TRACE names a file, which the
+// command then appends them to as JSON lines when it finishes; the library never writes one.
+// Spans, counters and histograms may be recorded from several threads at once.
+
+#define TRACE_MAX_SPANS 256
+#define TRACE_MAX_HISTS 16
+#define TRACE_HIST_BUCKETS 48
+
+typedef enum {
+    CNT_PAIRING,
+    CNT_G1_EXP,
+    CNT_G2_EXP,
+    CNT_GT_EXP,
+    CNT_HASH_G1,
+    CNT_HASH_ZR,
+    CNT_BYTES_READ,
+    CNT_BYTES_WRITTEN,
+    CNT_IO_CALLS,
+    CNT_ALLOCS,
+    NUM_COUNTERS
+} TRACECOUNTER;
+
+const char *trace_counter_names[NUM_COUNTERS] = {
+    "pairings", "g1_exp", "g2_exp", "gt_exp", "hash_to_g1", "hash_to_zr", "bytes_read", "bytes_written",
+    "io_calls", "allocs"
+};
+
+typedef struct {
+    const char *phase;
+    const char *stage;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} TRACESPAN;
+
+// Log2 histogram of latencies in ns: bucket b holds values in [2^b, 2^(b+1))
+typedef struct {
+    const char *name;
+    long long count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    long long buckets[TRACE_HIST_BUCKETS];
+} TRACEHIST;
+
+long long trace_counters[NUM_COUNTERS];
+TRACESPAN trace_spans[TRACE_MAX_SPANS];
+int trace_num_spans = 0;
+TRACEHIST trace_hists[TRACE_MAX_HISTS];
+int trace_num_hists = 0;
+const char *trace_command = "";
+pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;    // guards histogram registration
+
+// Relaxed atomic add, so worker threads can count without a lock
+#define TRACE_COUNT(counter, n) __atomic_fetch_add(&trace_counters[counter], (n), __ATOMIC_RELAXED)
+
+// Monotonic wall clock in ns
+static inline uint64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Opens a span; close it with trace_end()
+int trace_begin(const char *phase, const char *stage) {
+    int slot = __atomic_fetch_add(&trace_num_spans, 1, __ATOMIC_RELAXED);
+    if (slot >= TRACE_MAX_SPANS) {
+        return -1;
+    }
+    TRACESPAN *span = &trace_spans[slot];
+    span->phase = phase;
+    span->stage = stage;
+    span->start_ns = trace_now_ns();
+    span->end_ns = 0;
+    return slot;
+}
+
+void trace_end(int span) {
+    if (span >= 0) {
+        trace_spans[span].end_ns = trace_now_ns();
+    }
+}
+
+// Finds or registers the histogram called name
+TRACEHIST *trace_histogram(const char *name) {
+    TRACEHIST *hist = NULL;
+    pthread_mutex_lock(&trace_lock);
+    for (int i = 0; i < trace_num_hists && hist == NULL; i++) {
+        if (strcmp(trace_hists[i].name, name) == 0) {
+            hist = &trace_hists[i];
+        }
+    }
+    if (hist == NULL && trace_num_hists < TRACE_MAX_HISTS) {
+        hist = &trace_hists[trace_num_hists++];
+        memset(hist, 0, sizeof(*hist));
+        hist->name = name;
+    }
+    pthread_mutex_unlock(&trace_lock);
+    return hist;
+}
+
+static inline void trace_hist_add(TRACEHIST *hist, uint64_t ns) {
+    if (!hist) {
+        return;
+    }
+    int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+    if (bucket >= TRACE_HIST_BUCKETS) {
+        bucket = TRACE_HIST_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&hist->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum_ns, ns, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&hist->max_ns, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// Upper bound (ns) of the bucket holding quantile q
+uint64_t trace_hist_quantile(TRACEHIST *hist, double q) {
+    long long target = (long long)(q * hist->count + 0.999999);
+    long long seen = 0;
+    for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= target && seen > 0) {
+            uint64_t upper = 2ULL << b;
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+void trace_set_command(const char *command) {
+    trace_command = command;
+}
+
+// Appends all spans, counters and histograms of this run as JSON lines to the file named by AUDIT_TRACE
+void trace_flush() {
+    const char *path = getenv("AUDIT_TRACE");
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+
+    FILE *file = fopen(path, "a");
+    if (file == NULL) {
+        return;
+    }
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    long long ts = (long long)wall.tv_sec * 1000 + wall.tv_nsec / 1000000;
+    int pid = (int)getpid();
+
+    int num_spans = trace_num_spans < TRACE_MAX_SPANS ? trace_num_spans : TRACE_MAX_SPANS;
+    for (int i = 0; i < num_spans; i++) {
+        TRACESPAN *span = &trace_spans[i];
+        uint64_t end = span->end_ns ? span->end_ns : trace_now_ns();
+        fprintf(file, "{\"ts\":%lld,\"pid\":%d,\"cmd\":\"%s\",\"type\":\"span\",\"phase\":\"%s\",\"stage\":\"%s\",\"wall_ms\":%.6f}\n",
+                ts, pid, trace_command, span->phase, span->stage, (end - span->start_ns) / 1e6);
+    }
+
+    fprintf(file, "{\"ts\":%lld,\"pid\":%d,\"cmd\":\"%s\",\"type\":\"counters\"", ts, pid, trace_command);
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        fprintf(file, ",\"%s\":%lld", trace_counter_names[c], trace_counters[c]);
+    }
+    fprintf(file, "}\n");
+
+    for (int i = 0; i < trace_num_hists; i++) {
+        TRACEHIST *hist = &trace_hists[i];
+        if (hist->count == 0) {
+            continue;
+        }
+        fprintf(file, "{\"ts\":%lld,\"pid\":%d,\"cmd\":\"%s\",\"type\":\"histogram\",\"name\":\"%s\",\"count\":%lld,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"buckets\":[",
+                ts, pid, trace_command, hist->name, hist->count, hist->sum_ns / 1e3 / hist->count,
+                trace_hist_quantile(hist, 0.5) / 1e3, trace_hist_quantile(hist, 0.9) / 1e3,
+                trace_hist_quantile(hist, 0.99) / 1e3, hist->max_ns / 1e3);
+        int first = 1;
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            if (hist->buckets[b]) {
+                fprintf(file, "%s[%llu,%lld]", first ? "" : ",", (unsigned long long)(1ULL << b), hist->buckets[b]);
+                first = 0;
+            }
+        }
+        fprintf(file, "]}\n");
+    }
+
+    fclose(file);
+}